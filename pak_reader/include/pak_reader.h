@@ -1,6 +1,8 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <span>
 #include <vector>
 #include <memory>
 #include <cstdint>
@@ -8,6 +10,7 @@
 #include <unordered_map>
 #include <optional>
 #include <array>
+#include <chrono>
 #include <stdexcept>
 
 // Define uint128_t since it's not standard
@@ -112,7 +115,8 @@ struct Footer {
     std::vector<std::optional<Compression>> compression;
 };
 
-// Class for reading .pak files
+// Class for reading .pak files. Frozen (V9) indexes are walked in place in
+// the mapped file, and their entries decoded on first lookup.
 class PakReader {
 public:
     // Constructor that takes a path to a .pak file
@@ -138,10 +142,96 @@ public:
     
     // Get a list of all directories in the pak
     std::vector<std::string> directories() const;
+    
+    // Check every entry's data against its stored SHA1 and return the paths
+    // that don't match. Encrypted and deleted entries are skipped. Verifier
+    // does the same a batch at a time.
+    std::vector<std::string> verify() const;
+    
+    // Look up an entry by its path, as returned by files(). The pointer
+    // stays valid for the lifetime of the reader; nullptr if not found.
+    const Entry* find(std::string_view path) const;
+    
+    // Look up many paths at once. Cache misses for different paths overlap,
+    // so this is much faster than calling find() in a loop.
+    std::vector<const Entry*> find_many(std::span<const std::string_view> paths) const;
 
 private:
+    friend class IndexParser;
+    friend class Verifier;
+    
     class Impl;
     std::unique_ptr<Impl> impl_;
+    
+    explicit PakReader(std::unique_ptr<Impl> impl);
+};
+
+// Class for parsing a pak's index a slice at a time, so a thread that must
+// stay responsive can open a huge pak without one long blocking call.
+// Construction only reads the footer and the index header.
+class IndexParser {
+public:
+    explicit IndexParser(const std::filesystem::path& path);
+    
+    ~IndexParser();
+    
+    // Parse until `budget` has elapsed or `max_entries` more entries are
+    // done, whichever comes first. Returns true once the index is complete.
+    // Throws PakException once no version can read the index, and again on
+    // every call after that.
+    bool step(std::chrono::nanoseconds budget, size_t max_entries = SIZE_MAX);
+    
+    // Get whether the whole index has been parsed; never true after a
+    // failed parse
+    bool done() const;
+    
+    // Get the number of entries parsed so far, and how many the index holds
+    size_t parsed_count() const;
+    size_t total_count() const;
+    
+    // Get the paths parsed so far, starting at `first`. Passing the previous
+    // parsed_count() returns only the new ones.
+    std::vector<std::string> parsed_files(size_t first = 0) const;
+    
+    // Hand over the finished reader. Throws PakException if not done or
+    // the parse failed.
+    std::unique_ptr<PakReader> finish();
+
+private:
+    std::unique_ptr<PakReader::Impl> impl_;
+};
+
+// Class for checking a pak's entry data a batch at a time, so a long
+// verify can report progress and be stopped or paused between batches.
+// Entries are read in file order and each batch is hashed together. The
+// reader must outlive the verifier.
+class Verifier {
+public:
+    explicit Verifier(const PakReader& reader);
+    
+    ~Verifier();
+    
+    // Read and hash the next batch of entries. Returns true once every
+    // entry has been checked.
+    bool step();
+    
+    // Get whether every entry has been checked
+    bool done() const;
+    
+    // Get the number of entries checked so far, and how many will be
+    size_t checked_count() const;
+    size_t total_count() const;
+    
+    // Get the paths whose data didn't match, so far
+    const std::vector<std::string>& mismatches() const;
+
+private:
+    friend class PakReader::Impl;
+    
+    struct State;
+    
+    const PakReader::Impl& impl_;
+    std::unique_ptr<State> state_;
 };
 
 // Exception class for pak reader errors
@@ -150,4 +240,13 @@ public:
     explicit PakException(const std::string& message);
 };
 
+// Thrown for a pak whose footer was read but whose index can't be used,
+// such as a frozen index whose hash doesn't match or whose memory image
+// isn't the 64-bit 4.25 layout. Unlike other errors, older versions are
+// not tried after it.
+class UnsupportedPakException : public PakException {
+public:
+    explicit UnsupportedPakException(const std::string& message);
+};
+
 } // namespace pak
@@ -1,11 +1,22 @@
 #include "pak_reader.h"
+#include "flat_path_map.h"
+#include "io_throttle.h"
+#include "mapped_file.h"
+#include "parallel.h"
+#include "path_hash.h"
+#include "prefetch.h"
+#include "sha1.h"
 
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <mutex>
 #include <fstream>
-#include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <exception>
 #include <unordered_set>
 #include <filesystem>
-#include <map>
 
 namespace pak {
 
@@ -27,48 +38,216 @@ namespace {
         return guid;
     }
 
-    // Helper function to read a string from a stream
-    std::string read_string(std::ifstream& stream) {
-        int32_t length;
-        stream.read(reinterpret_cast<char*>(&length), sizeof(length));
+    // Helper function to convert a UTF-16 FString to a string
+    std::string utf16_to_string(const uint8_t* data, size_t count) {
+        std::string result;
+        for (size_t i = 0; i < count; ++i) {
+            uint16_t c;
+            std::memcpy(&c, data + i * sizeof(uint16_t), sizeof(c));
+            if (c == 0) {
+                break;
+            }
+            // Simple conversion for ASCII range; non-ASCII gets a placeholder
+            result.push_back(c < 128 ? static_cast<char>(c) : '?');
+        }
+        return result;
+    }
+
+    // Bounds-checked cursor over index bytes in the mapped pak
+    class ByteReader {
+    public:
+        ByteReader() = default;
+        
+        explicit ByteReader(std::span<const uint8_t> data, size_t offset = 0)
+            : data_(data), offset_(offset) {}
         
-        if (length < 0) {
-            // UTF-16 string
-            std::vector<uint16_t> chars(static_cast<size_t>(-length));
-            stream.read(reinterpret_cast<char*>(chars.data()), chars.size() * sizeof(uint16_t));
+        size_t offset() const { return offset_; }
+        
+        std::span<const uint8_t> take(size_t size) {
+            if (offset_ > data_.size() || size > data_.size() - offset_) {
+                throw PakException("Index data out of bounds");
+            }
+            std::span<const uint8_t> result = data_.subspan(offset_, size);
+            offset_ += size;
+            return result;
+        }
+        
+        void skip(size_t size) {
+            take(size);
+        }
+        
+        template<typename T>
+        T read() {
+            T value;
+            std::memcpy(&value, take(sizeof(T)).data(), sizeof(T));
+            return value;
+        }
+        
+        bool read_bool() {
+            uint8_t value = read<uint8_t>();
+            if (value != 0 && value != 1) {
+                throw PakException("Invalid boolean value: " + std::to_string(value));
+            }
+            return value == 1;
+        }
+        
+        std::array<uint8_t, 20> read_guid() {
+            std::array<uint8_t, 20> guid;
+            std::memcpy(guid.data(), take(guid.size()).data(), guid.size());
+            return guid;
+        }
+        
+        // Read an FString. ANSI strings are viewed in place in the index;
+        // UTF-16 strings are converted into `storage` and viewed there.
+        std::string_view read_string(std::deque<std::string>& storage) {
+            int32_t length = read<int32_t>();
+            if (length < 0) {
+                size_t count = static_cast<size_t>(-static_cast<int64_t>(length));
+                storage.push_back(utf16_to_string(take(count * sizeof(uint16_t)).data(), count));
+                return storage.back();
+            }
             
-            // Find null terminator
-            size_t null_pos = 0;
-            while (null_pos < chars.size() && chars[null_pos] != 0) {
-                null_pos++;
+            auto bytes = take(static_cast<size_t>(length));
+            std::string_view view(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+            return view.substr(0, view.find('\0'));
+        }
+        
+        std::string read_string() {
+            std::deque<std::string> storage;
+            return std::string(read_string(storage));
+        }
+        
+        // Skip an FString without decoding it
+        void skip_string() {
+            int32_t length = read<int32_t>();
+            skip(length < 0 ? static_cast<size_t>(-static_cast<int64_t>(length)) * sizeof(uint16_t)
+                            : static_cast<size_t>(length));
+        }
+        
+    private:
+        std::span<const uint8_t> data_;
+        size_t offset_ = 0;
+    };
+
+    // Memory image of a frozen (V9) index: FPakFileData as UE 4.25 lays it
+    // out for 64-bit little-endian platforms. Offsets and sizes in bytes.
+    constexpr size_t FROZEN_MOUNT_POINT = 0;     // FMemoryImageString
+    constexpr size_t FROZEN_FILES = 16;          // TMemoryImageArray<FPakEntry>
+    constexpr size_t FROZEN_DIRECTORIES = 32;    // TMemoryImageMap<FMemoryImageString, FPakDirectory>
+    constexpr size_t FROZEN_DATA_SIZE = 88;
+    constexpr size_t FROZEN_ENTRY_SIZE = 80;     // FPakEntry
+    constexpr size_t FROZEN_DIRECTORY_SIZE = 80; // map element: name, FPakDirectory, hash links
+    constexpr size_t FROZEN_FILE_SIZE = 32;      // map element: name, index into the files, hash links
+    constexpr size_t FROZEN_BLOCK_SIZE = 16;     // FPakCompressedBlock
+    
+    // Bounds-checked view of a frozen index. Frozen pointers hold their
+    // target's offset from the pointer itself in bits 1-40, and set bit 0;
+    // a null pointer is all zeros. Anything that doesn't fit the layout
+    // throws UnsupportedPakException.
+    class FrozenImage {
+    public:
+        explicit FrozenImage(std::span<const uint8_t> bytes) : bytes_(bytes) {
+            if (bytes_.size() < FROZEN_DATA_SIZE) {
+                invalid();
+            }
+        }
+        
+        template<typename T>
+        T read(size_t offset) const {
+            if (offset > bytes_.size() || sizeof(T) > bytes_.size() - offset) {
+                invalid();
+            }
+            T value;
+            std::memcpy(&value, bytes_.data() + offset, sizeof(T));
+            return value;
+        }
+        
+        // Where the pointer at `field` points, checked to hold `size` bytes
+        // aligned to `alignment`; nullopt for a null pointer
+        std::optional<size_t> pointer(size_t field, uint64_t size, size_t alignment) const {
+            uint64_t packed = read<uint64_t>(field);
+            if (packed == 0) {
+                return std::nullopt;
+            }
+            int64_t from_field = static_cast<int64_t>(packed << 23) >> 24;
+            int64_t target = static_cast<int64_t>(field) + from_field;
+            if ((packed & 1) == 0 || target < 0 || static_cast<uint64_t>(target) > bytes_.size() ||
+                size > bytes_.size() - static_cast<uint64_t>(target) || target % static_cast<int64_t>(alignment) != 0) {
+                invalid();
+            }
+            return static_cast<size_t>(target);
+        }
+        
+        // A TMemoryImageArray at `field`: where its elements start and how many
+        // there are
+        std::pair<size_t, uint32_t> array(size_t field, size_t element_size, size_t alignment) const {
+            int32_t count = read<int32_t>(field + 8);
+            int32_t capacity = read<int32_t>(field + 12);
+            if (count < 0 || capacity < count) {
+                invalid();
+            }
+            auto data = pointer(field, static_cast<uint64_t>(count) * element_size, alignment);
+            if (!data && count != 0) {
+                invalid();
             }
+            return {data.value_or(0), static_cast<uint32_t>(count)};
+        }
+        
+        // An FMemoryImageString at `field`: UTF-16 with its terminator counted
+        std::string string(size_t field) const {
+            auto [chars, count] = array(field, sizeof(uint16_t), sizeof(uint16_t));
+            if (count == 0) {
+                return {};
+            }
+            if (read<uint16_t>(chars + (count - 1) * sizeof(uint16_t)) != 0) {
+                invalid();
+            }
+            return utf16_to_string(bytes_.data() + chars, count - 1);
+        }
+        
+        // Call `visit` with the offset of every element of the TSet or TMap
+        // at `field`, skipping the free slots of its sparse array
+        template<typename Visit>
+        void for_each_element(size_t field, size_t element_size, Visit&& visit) const {
+            auto [elements, count] = array(field, element_size, 8);
             
-            // Convert to UTF-8
-            std::string result;
-            for (size_t i = 0; i < null_pos; ++i) {
-                // Simple conversion for ASCII range
-                if (chars[i] < 128) {
-                    result.push_back(static_cast<char>(chars[i]));
-                } else {
-                    // For non-ASCII, just use a placeholder
-                    result.push_back('?');
-                }
+            // Allocation flags: one bit per element, in 32-bit words
+            int32_t bit_count = read<int32_t>(field + 24);
+            int32_t bit_capacity = read<int32_t>(field + 28);
+            if (bit_count != static_cast<int32_t>(count) || bit_capacity < bit_count) {
+                invalid();
+            }
+            auto flags = pointer(field + 16, (static_cast<uint64_t>(count) + 31) / 32 * 4, 4);
+            if (!flags && count != 0) {
+                invalid();
             }
-            return result;
-        } else {
-            // ASCII string
-            std::vector<char> chars(static_cast<size_t>(length));
-            stream.read(chars.data(), chars.size());
             
-            // Find null terminator
-            size_t null_pos = 0;
-            while (null_pos < chars.size() && chars[null_pos] != 0) {
-                null_pos++;
+            int32_t free_count = read<int32_t>(field + 36);
+            int32_t hash_size = read<int32_t>(field + 48);
+            if (free_count < 0 || hash_size < 0 || (hash_size & (hash_size - 1)) != 0) {
+                invalid();
             }
+            pointer(field + 40, static_cast<uint64_t>(hash_size) * 4, 4);
             
-            return std::string(chars.data(), null_pos);
+            uint32_t allocated = 0;
+            for (uint32_t i = 0; i < count; ++i) {
+                if ((read<uint32_t>(*flags + i / 32 * 4) >> (i % 32)) & 1) {
+                    ++allocated;
+                    visit(elements + static_cast<size_t>(i) * element_size);
+                }
+            }
+            if (allocated + static_cast<uint32_t>(free_count) != count) {
+                invalid();
+            }
         }
-    }
+        
+    private:
+        [[noreturn]] static void invalid() {
+            throw UnsupportedPakException("Frozen pak index does not match the 64-bit 4.25 layout");
+        }
+        
+        std::span<const uint8_t> bytes_;
+    };
 
     // Helper function to convert Version to VersionMajor
     VersionMajor version_to_major(Version version) {
@@ -123,11 +302,78 @@ namespace {
         return size;
     }
 
+    // Helper function to get the size of the entry record written in front of each entry's data
+    uint64_t get_entry_header_size(Version version, bool compressed, uint32_t block_count) {
+        // offset, compressed size, uncompressed size: u64
+        uint64_t size = 8 + 8 + 8;
+
+        // compression slot: u8 for V8A, u32 otherwise
+        size += version == Version::V8A ? 1 : 4;
+
+        if (version_to_major(version) == VersionMajor::Initial) {
+            // timestamp: u64
+            size += 8;
+        }
+
+        // hash: [u8; 20]
+        size += 20;
+
+        if (compressed) {
+            // block count: u32 + blocks: [(u64, u64)]
+            size += 4 + (8 + 8) * static_cast<uint64_t>(block_count);
+        }
+
+        if (version_to_major(version) >= VersionMajor::CompressionEncryption) {
+            // flags: u8 + compression block size: u32
+            size += 1 + 4;
+        }
+
+        return size;
+    }
+
+    // Helper function to get the offset of the hash inside an entry record
+    uint64_t get_entry_hash_offset(Version version) {
+        uint64_t offset = 8 + 8 + 8;
+        offset += version == Version::V8A ? 1 : 4;
+        if (version_to_major(version) == VersionMajor::Initial) {
+            offset += 8;
+        }
+        return offset;
+    }
+
+    // Helper function to read a value from an in-memory buffer
+    template<typename T>
+    T read_value(std::span<const uint8_t> data, size_t& offset) {
+        if (offset + sizeof(T) > data.size()) {
+            throw PakException("Encoded entry out of bounds");
+        }
+        T value;
+        std::memcpy(&value, data.data() + offset, sizeof(T));
+        offset += sizeof(T);
+        return value;
+    }
+
+    // How many keys ahead find_many() issues its prefetches
+    constexpr size_t PREFETCH_DISTANCE = 8;
+    
+    // How many entries a resumable index parse handles between clock checks
+    constexpr size_t CLOCK_CHECK_INTERVAL = 64;
+    
+    // Indexes with at least this many entries are parsed on several threads
+    // when opened in one go; below that, starting threads costs more than
+    // it saves. Each thread decodes slices of this many records.
+    constexpr size_t PARALLEL_PARSE_MIN_ENTRIES = 16 * 1024;
+    constexpr size_t PARALLEL_PARSE_SLICE = 2048;
+    
+    // Entries are verified a batch at a time, so many small entries can be
+    // hashed together by the multi-buffer SHA1 kernels
+    constexpr size_t VERIFY_BATCH_SIZE = 16 * 1024 * 1024;
+
     // Helper function to extract the directory part of a path
-    std::string get_directory(const std::string& path) {
+    std::string_view get_directory(std::string_view path) {
         size_t pos = path.find_last_of('/');
-        if (pos == std::string::npos) {
-            return "";
+        if (pos == std::string_view::npos) {
+            return {};
         }
         return path.substr(0, pos);
     }
@@ -137,37 +383,112 @@ namespace {
 PakException::PakException(const std::string& message)
     : std::runtime_error(message) {}
 
+UnsupportedPakException::UnsupportedPakException(const std::string& message)
+    : PakException(message) {}
+
+// A verify in progress
+struct Verifier::State {
+    // Each entry's data is preceded by a copy of its record, which holds
+    // the SHA1 of the stored (possibly compressed) bytes
+    struct Pending {
+        std::string_view path;
+        uint64_t offset;
+        uint64_t header_size;
+        uint64_t data_size;
+    };
+    
+    std::vector<Pending> pending; // in file order
+    size_t next = 0;
+    std::ifstream stream;
+    uint64_t hash_offset = 0;
+    std::vector<std::string> failed;
+    
+    // Reused from batch to batch
+    std::vector<uint8_t> buffer;
+    std::vector<size_t> buffer_offsets;
+    std::vector<file_formats::sha1::Digest> digests;
+    std::vector<file_formats::sha1::Job> jobs;
+};
+
 // Implementation of the PakReader class
 class PakReader::Impl {
 public:
-    explicit Impl(const std::filesystem::path& path)
+    // Open a pak and read its footer and index header. Unless `progressive`,
+    // the whole index is parsed before returning; otherwise the caller drives
+    // the parse with step_index().
+    Impl(const std::filesystem::path& path, bool progressive)
         : path_(path), stream_(path.string(), std::ios::binary) {
-        if (!stream_) {
+        if (!stream_ || !file_.open(path)) {
             throw PakException("Failed to open file: " + path.string());
         }
         
-        std::cout << "File size: " << std::filesystem::file_size(path) << " bytes" << std::endl;
-        
-        // Try to read the pak file with different versions
-        for (int v = static_cast<int>(Version::V11); v >= static_cast<int>(Version::V1); --v) {
-            try {
-                Version version = static_cast<Version>(v);
-                std::cout << "Trying version: " << v << std::endl;
-                read_footer(version);
-                std::cout << "Footer read successfully. Index offset: " << footer_.index_offset 
-                          << ", Index size: " << footer_.index_size << std::endl;
-                read_index();
-                std::cout << "Index read successfully. Found " << entries_.size() << " entries." << std::endl;
-                return;
-            } catch (const std::exception& e) {
-                std::cout << "Failed with version " << v << ": " << e.what() << std::endl;
-                // Try the next version
-                stream_.clear();
-                stream_.seekg(0);
+        next_version_ = static_cast<int>(Version::V11);
+        start_next_version();
+        if (!progressive) {
+            while (!step_index(std::chrono::steady_clock::time_point::max(), SIZE_MAX, true)) {
+            }
+        }
+    }
+    
+    // Parse index entries until the deadline passes or `max_entries` more
+    // entries are done. Returns true once the index is complete. If the
+    // index turns out not to match the version its footer was read as,
+    // parsing starts over with the next older version. With `parallel`, a
+    // large index is parsed in one go on every core instead.
+    bool step_index(std::chrono::steady_clock::time_point deadline, size_t max_entries, bool parallel = false) {
+        if (failed_) {
+            throw PakException("Failed to read pak file: " + path_.string());
+        }
+        if (!parse_) {
+            return true;
+        }
+        try {
+            if (parallel && parse_->records.empty() && parse_->entry_count >= PARALLEL_PARSE_MIN_ENTRIES &&
+                file_formats::worker_count() > 1) {
+                parse_index_parallel();
+            } else if (!advance_index(deadline, max_entries)) {
+                return false;
             }
+        } catch (const std::exception&) {
+            stream_.clear();
+            stream_.seekg(0);
+            start_next_version();
+            return false;
         }
         
-        throw PakException("Failed to read pak file: " + path.string());
+        set_entries(std::move(parse_->records));
+        parse_.reset();
+        return true;
+    }
+    
+    bool index_done() const {
+        return !parse_ && !failed_;
+    }
+    
+    bool index_failed() const {
+        return failed_;
+    }
+    
+    size_t parsed_count() const {
+        return parse_ ? parse_->records.size() : paths_.size();
+    }
+    
+    size_t total_count() const {
+        return parse_ ? parse_->entry_count : paths_.size();
+    }
+    
+    std::vector<std::string> parsed_files(size_t first) const {
+        std::vector<std::string> result;
+        if (parse_) {
+            for (size_t i = first; i < parse_->records.size(); ++i) {
+                result.emplace_back(parse_->records[i].first);
+            }
+        } else {
+            for (size_t i = first; i < paths_.size(); ++i) {
+                result.emplace_back(paths_[i]);
+            }
+        }
+        return result;
     }
     
     Version version() const {
@@ -187,20 +508,14 @@ public:
     }
     
     std::vector<std::string> files() const {
-        std::vector<std::string> result;
-        result.reserve(entries_.size());
-        for (const auto& [path, _] : entries_) {
-            result.push_back(path);
-        }
-        return result;
+        return std::vector<std::string>(paths_.begin(), paths_.end());
     }
     
     std::vector<std::string> directories() const {
-        std::unordered_set<std::string> dirs;
-        for (const auto& [path, _] : entries_) {
-            std::string dir = get_directory(path);
-            while (!dir.empty()) {
-                dirs.insert(dir);
+        std::unordered_set<std::string_view> dirs;
+        for (const auto& path : paths_) {
+            std::string_view dir = get_directory(path);
+            while (!dir.empty() && dirs.insert(dir).second) {
                 dir = get_directory(dir);
             }
         }
@@ -210,12 +525,228 @@ public:
         return result;
     }
     
+    std::vector<std::string> verify() const {
+        Verifier::State state;
+        begin_verify(state);
+        while (!step_verify(state)) {
+        }
+        return std::move(state.failed);
+    }
+    
+    void begin_verify(Verifier::State& state) const {
+        state.pending.reserve(paths_.size());
+        for (size_t i = 0; i < paths_.size(); ++i) {
+            const Entry& entry = entry_at(i);
+            
+            // Encrypted data can't be checked without the key
+            if (entry.is_encrypted() || entry.is_deleted()) {
+                continue;
+            }
+            uint32_t block_count = entry.blocks ? static_cast<uint32_t>(entry.blocks->size()) : 0;
+            uint64_t header_size = get_entry_header_size(footer_.version, entry.compression_slot.has_value(), block_count);
+            state.pending.push_back({paths_[i], entry.offset, header_size, entry.compressed_size});
+        }
+        
+        // Read in file order so the whole pak is one forward sweep
+        std::sort(state.pending.begin(), state.pending.end(), [](const auto& a, const auto& b) {
+            return a.offset < b.offset;
+        });
+        
+        state.stream.open(path_.string(), std::ios::binary);
+        if (!state.stream) {
+            throw PakException("Failed to open file: " + path_.string());
+        }
+        state.hash_offset = get_entry_hash_offset(footer_.version);
+    }
+    
+    // Read and hash one batch; true once every entry is checked
+    bool step_verify(Verifier::State& state) const {
+        // Fill one batch; an entry larger than the batch size gets a batch of its own
+        size_t batch_begin = state.next;
+        state.buffer.clear();
+        state.buffer_offsets.clear();
+        while (state.next < state.pending.size()) {
+            const auto& item = state.pending[state.next];
+            size_t record_size = static_cast<size_t>(item.header_size + item.data_size);
+            if (state.next > batch_begin && state.buffer.size() + record_size > VERIFY_BATCH_SIZE) {
+                break;
+            }
+            
+            state.buffer_offsets.push_back(state.buffer.size());
+            state.buffer.resize(state.buffer.size() + record_size);
+            auto ticket = file_formats::IoThrottle::global().acquire(record_size);
+            state.stream.seekg(static_cast<std::streamoff>(item.offset));
+            state.stream.read(reinterpret_cast<char*>(state.buffer.data() + state.buffer_offsets.back()), record_size);
+            if (!state.stream) {
+                throw PakException("Failed to read entry data: " + std::string(item.path));
+            }
+            ++state.next;
+        }
+        
+        size_t batch_count = state.next - batch_begin;
+        state.digests.assign(batch_count, {});
+        state.jobs.clear();
+        for (size_t i = 0; i < batch_count; ++i) {
+            const auto& item = state.pending[batch_begin + i];
+            state.jobs.push_back({state.buffer.data() + state.buffer_offsets[i] + item.header_size,
+                                  static_cast<size_t>(item.data_size), &state.digests[i]});
+        }
+        file_formats::sha1::hash_many(state.jobs);
+        
+        for (size_t i = 0; i < batch_count; ++i) {
+            const uint8_t* expected = state.buffer.data() + state.buffer_offsets[i] + state.hash_offset;
+            if (std::memcmp(state.digests[i].data(), expected, state.digests[i].size()) != 0) {
+                state.failed.emplace_back(state.pending[batch_begin + i].path);
+            }
+        }
+        
+        return state.next == state.pending.size();
+    }
+    
+    const Entry* find(std::string_view path) const {
+        auto index = index_.find(file_formats::hash_path(path), [&](uint32_t candidate) { return paths_[candidate] == path; });
+        return index ? &entry_at(*index) : nullptr;
+    }
+    
+    std::vector<const Entry*> find_many(std::span<const std::string_view> paths) const {
+        std::vector<const Entry*> result(paths.size(), nullptr);
+        if (index_.empty() || paths.empty()) {
+            return result;
+        }
+        
+        // Hash every key up front so the probe loop below only waits on memory
+        std::vector<uint64_t> hashes(paths.size());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            hashes[i] = file_formats::hash_path(paths[i]);
+        }
+        
+        // Software pipeline over the keys, `distance` keys between stages:
+        // the home group of a key is prefetched, then the path view of the
+        // first slot whose hash matches, then the path bytes the final
+        // compare reads, and finally the key is resolved. Misses for
+        // different keys are in flight at the same time instead of one
+        // after the other.
+        const size_t count = paths.size();
+        constexpr uint32_t NO_CANDIDATE = UINT32_MAX;
+        std::vector<uint32_t> candidates(count, NO_CANDIDATE);
+        auto any = [](uint32_t) { return true; };
+        for (size_t i = 0; i < count + 3 * PREFETCH_DISTANCE; ++i) {
+            if (i < count) {
+                index_.prefetch(hashes[i]);
+            }
+            if (i >= PREFETCH_DISTANCE && i - PREFETCH_DISTANCE < count) {
+                size_t key = i - PREFETCH_DISTANCE;
+                if (auto candidate = index_.find(hashes[key], any)) {
+                    candidates[key] = *candidate;
+                    file_formats::prefetch(&paths_[*candidate]);
+                }
+            }
+            if (i >= 2 * PREFETCH_DISTANCE && i - 2 * PREFETCH_DISTANCE < count) {
+                uint32_t candidate = candidates[i - 2 * PREFETCH_DISTANCE];
+                if (candidate != NO_CANDIDATE) {
+                    file_formats::prefetch(paths_[candidate].data());
+                }
+            }
+            if (i >= 3 * PREFETCH_DISTANCE) {
+                size_t key = i - 3 * PREFETCH_DISTANCE;
+                if (candidates[key] != NO_CANDIDATE) {
+                    auto index = index_.find(hashes[key], [&](uint32_t candidate) { return paths_[candidate] == paths[key]; });
+                    result[key] = index ? &entry_at(*index) : nullptr;
+                }
+            }
+        }
+        
+        return result;
+    }
+    
 private:
     std::filesystem::path path_;
     std::ifstream stream_;
+    file_formats::MappedFile file_;
     Footer footer_;
     std::string mount_point_;
-    std::map<std::string, Entry> entries_;
+    
+    // State of an index parse that is still in progress
+    struct IndexParse {
+        ByteReader reader;       // the primary index
+        ByteReader directories;  // the full directory index (V10+)
+        uint32_t entry_count = 0;
+        uint32_t next_entry = 0; // pre-V10 progress
+        
+        // V10+ progress through the full directory index
+        uint32_t dir_count = 0;
+        uint32_t next_dir = 0;
+        uint32_t file_count = 0;
+        uint32_t next_file = 0;
+        std::string_view dir_name;
+        std::span<const uint8_t> encoded_entries;
+        std::vector<Entry> non_encoded_entries;
+        
+        std::vector<std::pair<std::string_view, Entry>> records;
+    };
+    
+    std::optional<IndexParse> parse_;
+    int next_version_ = 0; // next version to try if the current one fails
+    bool failed_ = false;  // every version failed; the index can't be read
+    
+    // Paths view either the index in the mapped file (plain ANSI names of
+    // pre-V10 indexes, so loading them copies nothing) or path_storage_
+    std::vector<std::string_view> paths_;
+    std::deque<std::string> path_storage_;
+    std::vector<std::deque<std::string>> slice_storage_; // path storage of each parallel slice
+    std::vector<Entry> entries_;
+    file_formats::FlatPathMap<uint32_t> index_; // path hash to position in paths_
+    
+    // Frozen indexes keep their FPakEntry records in the mapped index and
+    // decode an entry the first time it is looked up, instead of filling
+    // entries_. frozen_records_ holds each path's record offset.
+    std::span<const uint8_t> frozen_image_;
+    std::vector<size_t> frozen_records_;
+    mutable std::unique_ptr<std::atomic<const Entry*>[]> frozen_entries_;
+    mutable std::deque<Entry> frozen_storage_;
+    mutable std::mutex frozen_mutex_; // guards frozen_storage_
+    
+    // The entry of paths_[i]
+    const Entry& entry_at(size_t i) const {
+        if (!footer_.frozen) {
+            return entries_[i];
+        }
+        const Entry* entry = frozen_entries_[i].load(std::memory_order_acquire);
+        if (!entry) {
+            std::lock_guard lock(frozen_mutex_);
+            entry = frozen_entries_[i].load(std::memory_order_relaxed);
+            if (!entry) {
+                entry = &frozen_storage_.emplace_back(decode_frozen_entry(FrozenImage(frozen_image_), frozen_records_[i]));
+                frozen_entries_[i].store(entry, std::memory_order_release);
+            }
+        }
+        return *entry;
+    }
+    
+    void set_entries(std::vector<std::pair<std::string_view, Entry>> records) {
+        // Sort by path; a path listed twice keeps its last entry
+        std::stable_sort(records.begin(), records.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        
+        paths_.clear();
+        entries_.clear();
+        paths_.reserve(records.size());
+        entries_.reserve(records.size());
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (i + 1 < records.size() && records[i + 1].first == records[i].first) {
+                continue;
+            }
+            paths_.push_back(records[i].first);
+            entries_.push_back(std::move(records[i].second));
+        }
+        
+        index_ = {};
+        index_.reserve(paths_.size());
+        for (size_t i = 0; i < paths_.size(); ++i) {
+            index_.insert(file_formats::hash_path(paths_[i]), static_cast<uint32_t>(i));
+        }
+    }
     
     void read_footer(Version version) {
         // Seek to the end of the file minus the footer size
@@ -310,158 +841,543 @@ private:
         footer_.version = version;
     }
     
-    void read_index() {
-        // Seek to the index offset
-        stream_.seekg(footer_.index_offset);
+    // The primary index, bounds-checked against the file
+    std::span<const uint8_t> index_bytes() const {
+        std::span<const uint8_t> file = file_.bytes();
+        if (footer_.index_offset > file.size() || footer_.index_size > file.size() - footer_.index_offset) {
+            throw PakException("Index is outside the file");
+        }
+        return file.subspan(footer_.index_offset, footer_.index_size);
+    }
+    
+    // Read the footer of the newest version not yet tried whose index header
+    // parses, and set up the index parse
+    void start_next_version() {
+        for (int v = next_version_; v >= static_cast<int>(Version::V1); --v) {
+            try {
+                Version version = static_cast<Version>(v);
+                read_footer(version);
+                next_version_ = v - 1;
+                begin_index();
+                return;
+            } catch (const UnsupportedPakException&) {
+                parse_.reset();
+                failed_ = true;
+                throw;
+            } catch (const std::exception&) {
+                // Try the next version
+                stream_.clear();
+                stream_.seekg(0);
+            }
+        }
         
+        parse_.reset();
+        failed_ = true;
+        throw PakException("Failed to read pak file: " + path_.string());
+    }
+    
+    void begin_index() {
         // If the index is encrypted, we can't read it without a key
         if (footer_.encrypted) {
             throw PakException("Index is encrypted, decryption not supported");
         }
         
+        if (footer_.frozen) {
+            load_frozen_index();
+            return;
+        }
+        
+        std::span<const uint8_t> index = index_bytes();
+        
+        path_storage_.clear();
+        slice_storage_.clear();
+        parse_.emplace();
+        IndexParse& parse = *parse_;
+        ByteReader& reader = parse.reader;
+        reader = ByteReader(index);
+        
         // Read the mount point
-        mount_point_ = read_string(stream_);
+        mount_point_ = reader.read_string();
         
         // Read the number of entries
-        uint32_t entry_count;
-        stream_.read(reinterpret_cast<char*>(&entry_count), sizeof(entry_count));
-        
-        // Handle different index formats based on version
-        if (footer_.version_major >= VersionMajor::PathHashIndex) {
-            // V10+ format with path hash index
-            uint64_t path_hash_seed;
-            stream_.read(reinterpret_cast<char*>(&path_hash_seed), sizeof(path_hash_seed));
+        parse.entry_count = reader.read<uint32_t>();
+        parse.records.reserve(parse.entry_count);
+        
+        if (footer_.version_major < VersionMajor::PathHashIndex) {
+            // Pre-V10 format with simple index: the entries follow directly
+            return;
+        }
+        
+        // V10+ format with path hash index
+        reader.read<uint64_t>(); // path hash seed
+        
+        // Skip path hash index if present
+        uint32_t has_path_hash_index = reader.read<uint32_t>();
+        if (has_path_hash_index != 0) {
+            reader.skip(8 + 8 + 20); // offset, size and hash
+        }
+        
+        // Locate the full directory index if present
+        uint32_t has_full_directory_index = reader.read<uint32_t>();
+        if (has_full_directory_index != 0) {
+            uint64_t full_directory_index_offset = reader.read<uint64_t>();
+            reader.read<uint64_t>(); // size
+            reader.skip(20);         // hash
             
-            // Skip path hash index if present
-            uint32_t has_path_hash_index;
-            stream_.read(reinterpret_cast<char*>(&has_path_hash_index), sizeof(has_path_hash_index));
-            if (has_path_hash_index != 0) {
-                uint64_t path_hash_index_offset, path_hash_index_size;
-                stream_.read(reinterpret_cast<char*>(&path_hash_index_offset), sizeof(path_hash_index_offset));
-                stream_.read(reinterpret_cast<char*>(&path_hash_index_size), sizeof(path_hash_index_size));
+            parse.directories = ByteReader(file_.bytes(), full_directory_index_offset);
+            parse.dir_count = parse.directories.read<uint32_t>();
+        }
+        
+        // The encoded entries blob is decoded in place
+        uint32_t encoded_entries_size = reader.read<uint32_t>();
+        parse.encoded_entries = reader.take(encoded_entries_size);
+        
+        // Read the entries that could not be encoded
+        uint32_t non_encoded_count = reader.read<uint32_t>();
+        parse.non_encoded_entries.reserve(non_encoded_count);
+        for (uint32_t i = 0; i < non_encoded_count; ++i) {
+            parse.non_encoded_entries.push_back(read_entry(reader));
+        }
+    }
+    
+    // A frozen index is a memory image of the engine's own FPakFileData. It
+    // is checked against the footer's hash and walked in place: every
+    // pointer, count and string is bounds-checked and every record
+    // validated, and only the paths are built. The footer matched exactly,
+    // so a frozen index that doesn't fit is never retried as an older
+    // version.
+    void load_frozen_index() {
+        parse_.reset();
+        path_storage_.clear();
+        slice_storage_.clear();
+        std::span<const uint8_t> image = index_bytes();
+        if (file_formats::sha1::hash(image.data(), image.size()) != footer_.hash) {
+            throw UnsupportedPakException("Frozen index hash mismatch: " + path_.string());
+        }
+        
+        FrozenImage frozen(image);
+        mount_point_ = frozen.string(FROZEN_MOUNT_POINT);
+        auto [files, file_count] = frozen.array(FROZEN_FILES, FROZEN_ENTRY_SIZE, 8);
+        for (uint32_t i = 0; i < file_count; ++i) {
+            validate_frozen_entry(frozen, files + static_cast<size_t>(i) * FROZEN_ENTRY_SIZE);
+        }
+        
+        std::vector<std::pair<std::string_view, size_t>> records;
+        frozen.for_each_element(FROZEN_DIRECTORIES, FROZEN_DIRECTORY_SIZE, [&](size_t directory) {
+            std::string dir_name = frozen.string(directory);
+            frozen.for_each_element(directory + 16, FROZEN_FILE_SIZE, [&](size_t file) {
+                int32_t index = frozen.read<int32_t>(file + 16);
+                if (index < 0 || static_cast<uint32_t>(index) >= file_count) {
+                    throw UnsupportedPakException("Invalid frozen entry index: " + std::to_string(index));
+                }
                 
-                // Skip hash
-                stream_.seekg(20, std::ios::cur);
+                // Construct full path, without a leading slash
+                std::string path = dir_name;
+                if (!path.empty() && path.back() != '/') {
+                    path += '/';
+                }
+                path += frozen.string(file);
+                if (!path.empty() && path.front() == '/') {
+                    path.erase(0, 1);
+                }
+                path_storage_.push_back(std::move(path));
+                records.emplace_back(path_storage_.back(), files + static_cast<size_t>(index) * FROZEN_ENTRY_SIZE);
+            });
+        });
+        
+        // Sort by path; a path listed twice keeps its last entry
+        std::stable_sort(records.begin(), records.end(), [](const auto& a, const auto& b) {
+            return a.first < b.first;
+        });
+        paths_.clear();
+        entries_.clear();
+        frozen_records_.clear();
+        for (size_t i = 0; i < records.size(); ++i) {
+            if (i + 1 < records.size() && records[i + 1].first == records[i].first) {
+                continue;
+            }
+            paths_.push_back(records[i].first);
+            frozen_records_.push_back(records[i].second);
+        }
+        frozen_image_ = image;
+        frozen_entries_ = std::make_unique<std::atomic<const Entry*>[]>(paths_.size());
+        
+        index_ = {};
+        index_.reserve(paths_.size());
+        for (size_t i = 0; i < paths_.size(); ++i) {
+            index_.insert(file_formats::hash_path(paths_[i]), static_cast<uint32_t>(i));
+        }
+    }
+    
+    // Check a frozen FPakEntry, so decoding it later can't fail
+    void validate_frozen_entry(const FrozenImage& frozen, size_t record) const {
+        int64_t offset = frozen.read<int64_t>(record);
+        int64_t size = frozen.read<int64_t>(record + 8);
+        int64_t uncompressed_size = frozen.read<int64_t>(record + 16);
+        uint32_t method = frozen.read<uint32_t>(record + 68);
+        uint8_t flags = frozen.read<uint8_t>(record + 72);
+        if (offset < 0 || size < 0 || uncompressed_size < 0 || method > footer_.compression.size() || flags > 3) {
+            throw UnsupportedPakException("Invalid frozen pak entry");
+        }
+        auto [blocks, block_count] = frozen.array(record + 48, FROZEN_BLOCK_SIZE, 8);
+        for (uint32_t i = 0; i < block_count; ++i) {
+            int64_t start = frozen.read<int64_t>(blocks + static_cast<size_t>(i) * FROZEN_BLOCK_SIZE);
+            int64_t end = frozen.read<int64_t>(blocks + static_cast<size_t>(i) * FROZEN_BLOCK_SIZE + 8);
+            if (start < 0 || end < start) {
+                throw UnsupportedPakException("Invalid frozen compression block");
+            }
+        }
+    }
+    
+    // Decode a frozen FPakEntry that validate_frozen_entry() accepted
+    Entry decode_frozen_entry(const FrozenImage& frozen, size_t record) const {
+        Entry entry;
+        entry.offset = frozen.read<uint64_t>(record);
+        entry.compressed_size = frozen.read<uint64_t>(record + 8);
+        entry.uncompressed_size = frozen.read<uint64_t>(record + 16);
+        uint32_t method = frozen.read<uint32_t>(record + 68);
+        entry.compression_slot = method == 0 ? std::nullopt : std::optional<uint32_t>(method - 1);
+        entry.timestamp = std::nullopt;
+        for (size_t i = 0; i < entry.hash.size(); ++i) {
+            entry.hash[i] = frozen.read<uint8_t>(record + 24 + i);
+        }
+        
+        auto [blocks, block_count] = frozen.array(record + 48, FROZEN_BLOCK_SIZE, 8);
+        if (block_count > 0) {
+            std::vector<Block> decoded(block_count);
+            for (uint32_t i = 0; i < block_count; ++i) {
+                decoded[i].start = frozen.read<uint64_t>(blocks + static_cast<size_t>(i) * FROZEN_BLOCK_SIZE);
+                decoded[i].end = frozen.read<uint64_t>(blocks + static_cast<size_t>(i) * FROZEN_BLOCK_SIZE + 8);
+            }
+            entry.blocks = std::move(decoded);
+        } else {
+            entry.blocks = std::nullopt;
+        }
+        
+        entry.compression_block_size = frozen.read<uint32_t>(record + 64);
+        entry.flags = frozen.read<uint8_t>(record + 72);
+        return entry;
+    }
+    
+    // Parse entries until the budget runs out; true once the index is complete
+    bool advance_index(std::chrono::steady_clock::time_point deadline, size_t max_entries) {
+        IndexParse& parse = *parse_;
+        
+        // Always make some progress; only look at the clock every few entries
+        size_t parsed = 0;
+        auto should_yield = [&]() {
+            if (parsed == 0) {
+                return false;
+            }
+            if (parsed >= max_entries) {
+                return true;
+            }
+            return parsed % CLOCK_CHECK_INTERVAL == 0 && std::chrono::steady_clock::now() >= deadline;
+        };
+        
+        if (footer_.version_major < VersionMajor::PathHashIndex) {
+            // Pre-V10 format; paths are viewed in place
+            while (parse.next_entry < parse.entry_count) {
+                if (should_yield()) {
+                    return false;
+                }
+                std::string_view path = parse.reader.read_string(path_storage_);
+                parse.records.emplace_back(path, read_entry(parse.reader));
+                ++parse.next_entry;
+                ++parsed;
+            }
+            return true;
+        }
+        
+        // V10+: walk the full directory index, resolving each file to its entry
+        ByteReader& directories = parse.directories;
+        while (parse.next_file < parse.file_count || parse.next_dir < parse.dir_count) {
+            if (parse.next_file == parse.file_count) {
+                parse.dir_name = directories.read_string(path_storage_);
+                parse.file_count = directories.read<uint32_t>();
+                parse.next_file = 0;
+                ++parse.next_dir;
+                continue;
+            }
+            if (should_yield()) {
+                return false;
             }
             
-            // Read full directory index if present
-            uint32_t has_full_directory_index;
-            stream_.read(reinterpret_cast<char*>(&has_full_directory_index), sizeof(has_full_directory_index));
-            if (has_full_directory_index != 0) {
-                uint64_t full_directory_index_offset, full_directory_index_size;
-                stream_.read(reinterpret_cast<char*>(&full_directory_index_offset), sizeof(full_directory_index_offset));
-                stream_.read(reinterpret_cast<char*>(&full_directory_index_size), sizeof(full_directory_index_size));
-                
-                // Skip hash
-                stream_.seekg(20, std::ios::cur);
+            std::string_view file_name = directories.read_string(path_storage_);
+            uint32_t encoded_offset = directories.read<uint32_t>();
+            ++parse.next_file;
+            
+            // Skip invalid offsets
+            if (encoded_offset == 0x80000000) {
+                continue;
+            }
+            
+            // Construct full path
+            std::string path(parse.dir_name);
+            if (!path.empty() && path.back() != '/') {
+                path += '/';
+            }
+            path += file_name;
+            
+            // Strip leading slash if present
+            if (!path.empty() && path.front() == '/') {
+                path.erase(0, 1);
+            }
+            path_storage_.push_back(std::move(path));
+            
+            // Negative offsets index the non-encoded entries, everything else
+            // points into the blob
+            int32_t signed_offset = static_cast<int32_t>(encoded_offset);
+            if (signed_offset < 0) {
+                size_t index = static_cast<size_t>(-(signed_offset + 1));
+                if (index >= parse.non_encoded_entries.size()) {
+                    throw PakException("Invalid non-encoded entry index: " + std::to_string(index));
+                }
+                parse.records.emplace_back(path_storage_.back(), parse.non_encoded_entries[index]);
+            } else {
+                parse.records.emplace_back(path_storage_.back(), decode_entry(parse.encoded_entries, encoded_offset));
+            }
+            ++parsed;
+        }
+        return true;
+    }
+    
+    // Parse the whole index on several threads. A quick sequential scan
+    // that skips over the records without decoding them finds where every
+    // slice starts; the slices are then decoded concurrently into their own
+    // ranges of a pre-sized array.
+    void parse_index_parallel() {
+        IndexParse& parse = *parse_;
+        
+        // Where a slice starts: its offset, and for V10+ the directory it
+        // starts in and how many of that directory's files it sees
+        struct SliceStart {
+            size_t offset;
+            std::string_view dir_name;
+            uint32_t dir_files_left;
+        };
+        std::vector<SliceStart> starts;
+        size_t record_count = 0;
+        
+        const bool directory_index = footer_.version_major >= VersionMajor::PathHashIndex;
+        if (!directory_index) {
+            ByteReader scan = parse.reader;
+            for (; record_count < parse.entry_count; ++record_count) {
+                if (record_count % PARALLEL_PARSE_SLICE == 0) {
+                    starts.push_back({scan.offset(), {}, 0});
+                }
+                scan.skip_string();
+                skip_entry(scan);
+            }
+        } else {
+            ByteReader scan = parse.directories;
+            for (uint32_t dir = 0; dir < parse.dir_count; ++dir) {
+                std::string_view dir_name = scan.read_string(path_storage_);
+                uint32_t file_count = scan.read<uint32_t>();
+                for (uint32_t file = 0; file < file_count; ++file, ++record_count) {
+                    if (record_count % PARALLEL_PARSE_SLICE == 0) {
+                        starts.push_back({scan.offset(), dir_name, file_count - file});
+                    }
+                    scan.skip_string();
+                    scan.skip(sizeof(uint32_t));
+                }
+            }
+        }
+        
+        // Records skipped in the directory index leave an empty path behind
+        std::vector<std::pair<std::string_view, Entry>> records(record_count);
+        std::vector<uint8_t> present(record_count, 0);
+        slice_storage_.resize(starts.size());
+        
+        file_formats::parallel_for(starts.size(), [&](size_t slice) {
+            const size_t first = slice * PARALLEL_PARSE_SLICE;
+            const size_t last = std::min(first + PARALLEL_PARSE_SLICE, record_count);
+            std::deque<std::string>& storage = slice_storage_[slice];
+            
+            if (!directory_index) {
+                ByteReader reader(parse.reader);
+                reader.skip(starts[slice].offset - reader.offset());
+                for (size_t i = first; i < last; ++i) {
+                    records[i].first = reader.read_string(storage);
+                    records[i].second = read_entry(reader);
+                    present[i] = 1;
+                }
+                return;
+            }
+            
+            ByteReader reader(parse.directories);
+            reader.skip(starts[slice].offset - reader.offset());
+            std::string_view dir_name = starts[slice].dir_name;
+            uint32_t files_left = starts[slice].dir_files_left;
+            for (size_t i = first; i < last; ++i, --files_left) {
+                // Move on to the next directory that has files
+                while (files_left == 0) {
+                    dir_name = reader.read_string(storage);
+                    files_left = reader.read<uint32_t>();
+                }
                 
-                // Save current position
-                auto current_pos = stream_.tellg();
+                std::string_view file_name = reader.read_string(storage);
+                uint32_t encoded_offset = reader.read<uint32_t>();
                 
-                // Seek to full directory index
-                stream_.seekg(full_directory_index_offset);
+                // Skip invalid offsets
+                if (encoded_offset == 0x80000000) {
+                    continue;
+                }
                 
-                // Read directory count
-                uint32_t dir_count;
-                stream_.read(reinterpret_cast<char*>(&dir_count), sizeof(dir_count));
+                // Construct full path, without a leading slash
+                std::string path(dir_name);
+                if (!path.empty() && path.back() != '/') {
+                    path += '/';
+                }
+                path += file_name;
+                if (!path.empty() && path.front() == '/') {
+                    path.erase(0, 1);
+                }
+                storage.push_back(std::move(path));
                 
-                // Read directories and files
-                for (uint32_t i = 0; i < dir_count; ++i) {
-                    std::string dir_name = read_string(stream_);
-                    
-                    uint32_t file_count;
-                    stream_.read(reinterpret_cast<char*>(&file_count), sizeof(file_count));
-                    
-                    for (uint32_t j = 0; j < file_count; ++j) {
-                        std::string file_name = read_string(stream_);
-                        uint32_t encoded_offset;
-                        stream_.read(reinterpret_cast<char*>(&encoded_offset), sizeof(encoded_offset));
-                        
-                        // Skip invalid offsets
-                        if (encoded_offset == 0x80000000) {
-                            continue;
-                        }
-                        
-                        // Construct full path
-                        std::string path = dir_name;
-                        if (!path.empty() && path.back() != '/') {
-                            path += '/';
-                        }
-                        path += file_name;
-                        
-                        // Strip leading slash if present
-                        if (!path.empty() && path.front() == '/') {
-                            path = path.substr(1);
-                        }
-                        
-                        // Create a dummy entry for now
-                        Entry entry;
-                        entry.offset = 0;
-                        entry.compressed_size = 0;
-                        entry.uncompressed_size = 0;
-                        entry.flags = 0;
-                        entry.compression_block_size = 0;
-                        
-                        entries_[path] = entry;
+                int32_t signed_offset = static_cast<int32_t>(encoded_offset);
+                if (signed_offset < 0) {
+                    size_t index = static_cast<size_t>(-(signed_offset + 1));
+                    if (index >= parse.non_encoded_entries.size()) {
+                        throw PakException("Invalid non-encoded entry index: " + std::to_string(index));
                     }
+                    records[i] = {storage.back(), parse.non_encoded_entries[index]};
+                } else {
+                    records[i] = {storage.back(), decode_entry(parse.encoded_entries, encoded_offset)};
                 }
-                
-                // Restore position
-                stream_.seekg(current_pos);
+                present[i] = 1;
+            }
+        });
+        
+        // Drop the holes, keeping index order so duplicates resolve as before
+        size_t kept = 0;
+        for (size_t i = 0; i < record_count; ++i) {
+            if (present[i]) {
+                if (kept != i) {
+                    records[kept] = std::move(records[i]);
+                }
+                ++kept;
             }
+        }
+        records.resize(kept);
+        parse.records = std::move(records);
+    }
+    
+    // Skip over a serialized entry; mirrors read_entry()
+    void skip_entry(ByteReader& reader) const {
+        reader.skip(3 * sizeof(uint64_t));
+        uint32_t compression = footer_.version == Version::V8A ? reader.read<uint8_t>() : reader.read<uint32_t>();
+        if (footer_.version_major == VersionMajor::Initial) {
+            reader.skip(sizeof(uint64_t));
+        }
+        reader.skip(20);
+        if (footer_.version_major >= VersionMajor::CompressionEncryption) {
+            if (compression != 0) {
+                uint32_t block_count = reader.read<uint32_t>();
+                reader.skip(static_cast<size_t>(block_count) * 2 * sizeof(uint64_t));
+            }
+            reader.skip(sizeof(uint8_t) + sizeof(uint32_t));
+        }
+    }
+    
+    Entry decode_entry(std::span<const uint8_t> data, size_t offset) const {
+        Entry entry;
+        
+        // Bit layout of the leading u32:
+        //   31: offset fits in u32, 30: uncompressed size fits in u32, 29: compressed size fits in u32
+        //   28-23: compression slot + 1, 22: encrypted, 21-6: block count, 5-0: block size >> 11
+        uint32_t bits = read_value<uint32_t>(data, offset);
+        
+        uint32_t compression = (bits >> 23) & 0x3f;
+        entry.compression_slot = compression == 0 ? std::nullopt : std::optional<uint32_t>(compression - 1);
+        
+        bool encrypted = (bits & (1u << 22)) != 0;
+        uint32_t block_count = (bits >> 6) & 0xffff;
+        
+        entry.compression_block_size = bits & 0x3f;
+        if (entry.compression_block_size == 0x3f) {
+            entry.compression_block_size = read_value<uint32_t>(data, offset);
         } else {
-            // Pre-V10 format with simple index
-            for (uint32_t i = 0; i < entry_count; ++i) {
-                std::string path = read_string(stream_);
-                Entry entry = read_entry();
-                entries_[path] = entry;
+            entry.compression_block_size <<= 11;
+        }
+        
+        auto read_var_int = [&](int bit) -> uint64_t {
+            if ((bits & (1u << bit)) != 0) {
+                return read_value<uint32_t>(data, offset);
             }
+            return read_value<uint64_t>(data, offset);
+        };
+        
+        entry.offset = read_var_int(31);
+        entry.uncompressed_size = read_var_int(30);
+        entry.compressed_size = entry.compression_slot.has_value() ? read_var_int(29) : entry.uncompressed_size;
+        
+        // Block offsets are relative to the entry and start after its header
+        uint64_t header_size = get_entry_header_size(footer_.version, entry.compression_slot.has_value(), block_count);
+        if (block_count == 1 && !encrypted) {
+            entry.blocks = std::vector<Block>{{header_size, header_size + entry.compressed_size}};
+        } else if (block_count > 0) {
+            std::vector<Block> blocks;
+            blocks.reserve(block_count);
+            
+            uint64_t start = header_size;
+            for (uint32_t i = 0; i < block_count; ++i) {
+                uint64_t block_size = read_value<uint32_t>(data, offset);
+                blocks.push_back({start, start + block_size});
+                
+                // Encrypted blocks are padded to the AES block size
+                if (encrypted) {
+                    block_size = (block_size + 15) & ~uint64_t(15);
+                }
+                start += block_size;
+            }
+            
+            entry.blocks = blocks;
+        } else {
+            entry.blocks = std::nullopt;
         }
+        
+        // The hash is only stored in the record in front of the entry's data
+        entry.timestamp = std::nullopt;
+        entry.hash = {};
+        entry.flags = encrypted ? 1 : 0;
+        
+        return entry;
     }
     
-    Entry read_entry() {
+    Entry read_entry(ByteReader& reader) const {
         Entry entry;
         
         // Read basic fields
-        stream_.read(reinterpret_cast<char*>(&entry.offset), sizeof(entry.offset));
-        stream_.read(reinterpret_cast<char*>(&entry.compressed_size), sizeof(entry.compressed_size));
-        stream_.read(reinterpret_cast<char*>(&entry.uncompressed_size), sizeof(entry.uncompressed_size));
+        entry.offset = reader.read<uint64_t>();
+        entry.compressed_size = reader.read<uint64_t>();
+        entry.uncompressed_size = reader.read<uint64_t>();
         
         // Read compression slot
-        if (footer_.version == Version::V8A) {
-            uint8_t compression = 0;
-            stream_.read(reinterpret_cast<char*>(&compression), sizeof(compression));
-            entry.compression_slot = compression == 0 ? std::nullopt : std::optional<uint32_t>(compression - 1);
-        } else {
-            uint32_t compression = 0;
-            stream_.read(reinterpret_cast<char*>(&compression), sizeof(compression));
-            entry.compression_slot = compression == 0 ? std::nullopt : std::optional<uint32_t>(compression - 1);
-        }
+        uint32_t compression = footer_.version == Version::V8A ? reader.read<uint8_t>() : reader.read<uint32_t>();
+        entry.compression_slot = compression == 0 ? std::nullopt : std::optional<uint32_t>(compression - 1);
         
         // Read timestamp if present
         if (footer_.version_major == VersionMajor::Initial) {
-            uint64_t timestamp;
-            stream_.read(reinterpret_cast<char*>(&timestamp), sizeof(timestamp));
-            entry.timestamp = timestamp;
+            entry.timestamp = reader.read<uint64_t>();
         } else {
             entry.timestamp = std::nullopt;
         }
         
         // Read hash
-        entry.hash = read_guid(stream_);
+        entry.hash = reader.read_guid();
         
         // Read blocks if present
         if (footer_.version_major >= VersionMajor::CompressionEncryption && entry.compression_slot.has_value()) {
-            uint32_t block_count;
-            stream_.read(reinterpret_cast<char*>(&block_count), sizeof(block_count));
+            uint32_t block_count = reader.read<uint32_t>();
             
             std::vector<Block> blocks;
             blocks.reserve(block_count);
             
             for (uint32_t i = 0; i < block_count; ++i) {
                 Block block;
-                stream_.read(reinterpret_cast<char*>(&block.start), sizeof(block.start));
-                stream_.read(reinterpret_cast<char*>(&block.end), sizeof(block.end));
+                block.start = reader.read<uint64_t>();
+                block.end = reader.read<uint64_t>();
                 blocks.push_back(block);
             }
             
@@ -472,8 +1388,8 @@ private:
         
         // Read flags and compression block size if present
         if (footer_.version_major >= VersionMajor::CompressionEncryption) {
-            stream_.read(reinterpret_cast<char*>(&entry.flags), sizeof(entry.flags));
-            stream_.read(reinterpret_cast<char*>(&entry.compression_block_size), sizeof(entry.compression_block_size));
+            entry.flags = reader.read<uint8_t>();
+            entry.compression_block_size = reader.read<uint32_t>();
         } else {
             entry.flags = 0;
             entry.compression_block_size = 0;
@@ -485,7 +1401,10 @@ private:
 
 // Implementation of the PakReader class methods
 PakReader::PakReader(const std::filesystem::path& path)
-    : impl_(std::make_unique<Impl>(path)) {}
+    : impl_(std::make_unique<Impl>(path, false)) {}
+
+PakReader::PakReader(std::unique_ptr<Impl> impl)
+    : impl_(std::move(impl)) {}
 
 PakReader::~PakReader() = default;
 
@@ -513,4 +1432,83 @@ std::vector<std::string> PakReader::directories() const {
     return impl_->directories();
 }
 
+std::vector<std::string> PakReader::verify() const {
+    return impl_->verify();
+}
+
+const Entry* PakReader::find(std::string_view path) const {
+    return impl_->find(path);
+}
+
+std::vector<const Entry*> PakReader::find_many(std::span<const std::string_view> paths) const {
+    return impl_->find_many(paths);
+}
+
+// Implementation of the IndexParser class methods
+IndexParser::IndexParser(const std::filesystem::path& path)
+    : impl_(std::make_unique<PakReader::Impl>(path, true)) {}
+
+IndexParser::~IndexParser() = default;
+
+bool IndexParser::step(std::chrono::nanoseconds budget, size_t max_entries) {
+    if (!impl_) {
+        throw PakException("Index parser has already finished");
+    }
+    return impl_->step_index(std::chrono::steady_clock::now() + budget, max_entries);
+}
+
+bool IndexParser::done() const {
+    return impl_ && impl_->index_done();
+}
+
+size_t IndexParser::parsed_count() const {
+    return impl_ ? impl_->parsed_count() : 0;
+}
+
+size_t IndexParser::total_count() const {
+    return impl_ ? impl_->total_count() : 0;
+}
+
+std::vector<std::string> IndexParser::parsed_files(size_t first) const {
+    return impl_ ? impl_->parsed_files(first) : std::vector<std::string>();
+}
+
+std::unique_ptr<PakReader> IndexParser::finish() {
+    if (impl_ && impl_->index_failed()) {
+        throw PakException("Index parse failed");
+    }
+    if (!done()) {
+        throw PakException("Index parse is not complete");
+    }
+    return std::unique_ptr<PakReader>(new PakReader(std::move(impl_)));
+}
+
+// Implementation of the Verifier class methods
+Verifier::Verifier(const PakReader& reader)
+    : impl_(*reader.impl_), state_(std::make_unique<State>()) {
+    impl_.begin_verify(*state_);
+}
+
+Verifier::~Verifier() = default;
+
+bool Verifier::step() {
+    return done() || impl_.step_verify(*state_);
+}
+
+bool Verifier::done() const {
+    return state_->next == state_->pending.size();
+}
+
+size_t Verifier::checked_count() const {
+    return state_->next;
+}
+
+size_t Verifier::total_count() const {
+    return state_->pending.size();
+}
+
+const std::vector<std::string>& Verifier::mismatches() const {
+    return state_->failed;
+}
+
 } // namespace pak
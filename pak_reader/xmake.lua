@@ -2,3 +2,4 @@ target("pak_reader_prototype")
     set_kind("static")
     add_files("src/*.cpp")
     add_includedirs("include", { public = true })
+    add_deps("unreal_modding_file_formats")
@@ -0,0 +1,93 @@
+#include "test_support.h"
+
+#include <city_hash.h>
+#include <package_id.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace file_formats;
+
+namespace {
+    // Bytes (i * 131 + 7) mod 256, so every length class reads distinct words
+    std::vector<uint8_t> pattern(size_t size) {
+        std::vector<uint8_t> data(size);
+        for (size_t i = 0; i < size; ++i) {
+            data[i] = static_cast<uint8_t>(i * 131 + 7);
+        }
+        return data;
+    }
+
+    // Computed with the reference CityHash64 v1.1
+    struct KnownAnswer {
+        size_t size;
+        uint64_t hash;
+    };
+
+    constexpr KnownAnswer CITY_HASH_ANSWERS[] = {
+        {0, 0x9ae16a3b2f90404fULL},    {1, 0x57821efdee1b7472ULL},    {2, 0xb09f4e41bd9664ddULL},
+        {3, 0xbeedf37b20babe01ULL},    {4, 0x78e5c39592d63067ULL},    {7, 0x04dd505220c44e7eULL},
+        {8, 0xc19f34cbc54f4865ULL},    {9, 0x80aee4d0d63a7ecaULL},    {15, 0x390ab3fd476b7830ULL},
+        {16, 0x08b48f7ec30e084eULL},   {17, 0xe8255d05f537d5f5ULL},   {31, 0x27c23ea18dbddfc4ULL},
+        {32, 0xeff8e4a51615d6dfULL},   {33, 0xae01ad7aafc8f9d0ULL},   {63, 0x815e60fd3a645a96ULL},
+        {64, 0x4bc22968f81c207eULL},   {65, 0xa85db1d278c7ac66ULL},   {127, 0x92754ecffe772377ULL},
+        {128, 0xaad7cf44dc004b0cULL},  {129, 0x9e58deaaa50a6a1aULL},  {200, 0x88b41254c3e9901aULL},
+        {1000, 0x984a7e937a0d04f5ULL},
+    };
+
+    // CityHash64 of the lowercased UTF-16LE name
+    struct KnownId {
+        std::string_view name;
+        uint64_t id;
+    };
+
+    constexpr KnownId PACKAGE_ID_ANSWERS[] = {
+        {"/Game/Maps/Foo", 0x9d2fc8b1192c6764ULL},
+        {"/Script/Engine", 0xd1acced3dc7c0922ULL},
+        {"/Engine/EngineMaterials/DefaultMaterial", 0xc04e95a76b12d3b4ULL},
+        {"/Game/ThirdPersonBP/Blueprints/ThirdPersonCharacter", 0xc9ebb1453c2a8f62ULL},
+        {"/Game/Characters/Heroes/\xc3\xa9lise_\xcf\x89", 0x81c1ce32902f5030ULL},
+        {"/Game/Emoji/\xf0\x9f\x98\x80", 0x68b9d2e4c048ac43ULL},
+    };
+}
+
+TEST_CASE(city_hash_known_answers) {
+    for (const auto& answer : CITY_HASH_ANSWERS) {
+        auto data = pattern(answer.size);
+        CHECK(city_hash::hash64(data.data(), data.size()) == answer.hash);
+    }
+}
+
+TEST_CASE(package_id_known_answers) {
+    for (const auto& answer : PACKAGE_ID_ANSWERS) {
+        CHECK(package_id::from_name(answer.name) == answer.id);
+    }
+}
+
+TEST_CASE(package_id_ignores_ascii_case) {
+    CHECK(package_id::from_name("/GAME/MAPS/FOO") == package_id::from_name("/game/maps/foo"));
+    CHECK(package_id::from_name("/Game/ThirdPersonBP/Blueprints/ThirdPersonCharacter") ==
+          package_id::from_name("/game/thirdpersonbp/blueprints/thirdpersoncharacter"));
+}
+
+TEST_CASE(package_id_batch_matches_single) {
+    std::vector<std::string_view> names;
+    for (const auto& answer : PACKAGE_ID_ANSWERS) {
+        names.push_back(answer.name);
+    }
+    std::vector<uint64_t> ids(names.size());
+    package_id::from_names(names, ids);
+    for (size_t i = 0; i < names.size(); ++i) {
+        CHECK(ids[i] == PACKAGE_ID_ANSWERS[i].id);
+    }
+}
+
+TEST_CASE(package_name_from_path_mount_points) {
+    CHECK(package_id::package_name_from_path("../../../MyGame/Content/Maps/Foo.umap") == "/Game/Maps/Foo");
+    CHECK(package_id::package_name_from_path("../../../Engine/Content/X.uasset") == "/Engine/X");
+    CHECK(package_id::package_name_from_path("../../../MyGame/Plugins/Bar/Content/X.uasset") == "/Bar/X");
+    CHECK(package_id::package_name_from_path("/MyGame/Content/Dir.With.Dots/Asset") == "/Game/Dir.With.Dots/Asset");
+    CHECK(!package_id::package_name_from_path("../../../MyGame/Config/DefaultGame.ini"));
+}
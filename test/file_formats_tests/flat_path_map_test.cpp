@@ -0,0 +1,87 @@
+#include "test_support.h"
+
+#include <flat_path_map.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+using file_formats::FlatPathMap;
+
+namespace {
+    // Keys with well-spread top bits, as a path hash has
+    std::vector<uint64_t> random_hashes(size_t count, uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        std::vector<uint64_t> hashes(count);
+        for (auto& hash : hashes) {
+            hash = rng();
+        }
+        return hashes;
+    }
+
+    auto any = [](uint32_t) { return true; };
+}
+
+TEST_CASE(flat_path_map_empty) {
+    FlatPathMap<uint32_t> map;
+    CHECK(map.empty());
+    CHECK(!map.find(42, any));
+    map.prefetch(42);
+}
+
+TEST_CASE(flat_path_map_insert_and_find) {
+    auto hashes = random_hashes(10000, 1);
+    FlatPathMap<uint32_t> map;
+    for (uint32_t i = 0; i < hashes.size(); ++i) {
+        map.insert(hashes[i], i);
+    }
+    CHECK(map.size() == hashes.size());
+    CHECK(map.capacity() * 7 >= map.size() * 8);
+    for (uint32_t i = 0; i < hashes.size(); ++i) {
+        CHECK(map.find(hashes[i], any) == i);
+    }
+    for (uint64_t missing : random_hashes(1000, 2)) {
+        CHECK(!map.find(missing, any));
+    }
+}
+
+TEST_CASE(flat_path_map_build_matches_insert) {
+    auto hashes = random_hashes(5000, 3);
+    std::sort(hashes.begin(), hashes.end());
+    std::vector<uint32_t> values(hashes.size());
+    for (uint32_t i = 0; i < values.size(); ++i) {
+        values[i] = i * 3;
+    }
+    auto map = FlatPathMap<uint32_t>::build(hashes, values);
+    CHECK(map.size() == hashes.size());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        CHECK(map.find(hashes[i], any) == values[i]);
+    }
+}
+
+TEST_CASE(flat_path_map_reserve_keeps_entries) {
+    FlatPathMap<uint32_t> map;
+    map.insert(7, 1);
+    map.insert(9, 2);
+    map.reserve(1000);
+    size_t capacity = map.capacity();
+    for (uint32_t i = 0; i < 998; ++i) {
+        map.insert(1000 + uint64_t(i) * 0x9e3779b97f4a7c15ULL, i);
+    }
+    CHECK(map.capacity() == capacity);
+    CHECK(map.find(7, any) == 1u);
+    CHECK(map.find(9, any) == 2u);
+}
+
+TEST_CASE(flat_path_map_shared_hashes_use_the_predicate) {
+    // Distinct paths with the same hash are told apart by the predicate
+    FlatPathMap<uint32_t> map;
+    for (uint32_t i = 0; i < 40; ++i) {
+        map.insert(0xabcdef, i);
+    }
+    for (uint32_t i = 0; i < 40; ++i) {
+        CHECK(map.find(0xabcdef, [i](uint32_t value) { return value == i; }) == i);
+    }
+    CHECK(!map.find(0xabcdef, [](uint32_t value) { return value == 40; }));
+}
@@ -0,0 +1,5 @@
+#include "test_support.h"
+
+int main() {
+    return test::run_all();
+}
@@ -0,0 +1,103 @@
+#include "test_support.h"
+
+#include <sha1.h>
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace file_formats;
+
+namespace {
+    std::string hex(const sha1::Digest& digest) {
+        std::string text;
+        for (uint8_t byte : digest) {
+            char pair[3];
+            std::snprintf(pair, sizeof(pair), "%02x", byte);
+            text += pair;
+        }
+        return text;
+    }
+
+    std::string hash_hex(std::string_view message) {
+        return hex(sha1::hash(reinterpret_cast<const uint8_t*>(message.data()), message.size()));
+    }
+
+    // FIPS 180 and RFC 3174 test vectors
+    struct KnownAnswer {
+        std::string message;
+        const char* digest;
+    };
+
+    std::vector<KnownAnswer> known_answers() {
+        return {
+            {"", "da39a3ee5e6b4b0d3255bfef95601890afd80709"},
+            {"abc", "a9993e364706816aba3e25717850c26c9cd0d89d"},
+            {"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "84983e441c3bd26ebaae4aa1f95129e5e54670f1"},
+            {"The quick brown fox jumps over the lazy dog", "2fd4e1c67a2d28fced849ee1bb76e7391b93eb12"},
+            {std::string(1000000, 'a'), "34aa973cd4c4daa4f61eeb2bdbad27316534016f"},
+        };
+    }
+
+    std::vector<sha1::Backend> supported_backends() {
+        std::vector<sha1::Backend> backends = {sha1::Backend::Scalar};
+        sha1::Backend best = sha1::best_backend();
+        for (auto backend : {sha1::Backend::Sse2, sha1::Backend::Avx2, sha1::Backend::Avx512}) {
+            if (best != sha1::Backend::Scalar && backend <= best) {
+                backends.push_back(backend);
+            }
+        }
+        return backends;
+    }
+}
+
+TEST_CASE(sha1_known_answers) {
+    for (const auto& answer : known_answers()) {
+        CHECK(hash_hex(answer.message) == answer.digest);
+    }
+}
+
+TEST_CASE(sha1_block_boundaries) {
+    // Padding spills into a second block from 56 bytes on
+    CHECK(hash_hex(std::string(55, 'a')) == "c1c8bbdc22796e28c0e15163d20899b65621d65a");
+    CHECK(hash_hex(std::string(56, 'a')) == "c2db330f6083854c99d4b5bfb6e8f29f201be699");
+    CHECK(hash_hex(std::string(64, 'a')) == "0098ba824b5c16427bd7a1122a5a442a25ec644d");
+}
+
+TEST_CASE(sha1_every_lane_kernel) {
+    // Uneven lengths, so groups mix messages that finish on different blocks
+    std::vector<std::string> messages;
+    for (size_t i = 0; i < 37; ++i) {
+        messages.push_back(std::string(i * 29 % 300, static_cast<char>('a' + i % 26)));
+    }
+    for (const auto& answer : known_answers()) {
+        messages.push_back(answer.message);
+    }
+
+    std::vector<sha1::Digest> expected(messages.size());
+    for (size_t i = 0; i < messages.size(); ++i) {
+        expected[i] = sha1::hash(reinterpret_cast<const uint8_t*>(messages[i].data()), messages[i].size());
+    }
+
+    for (auto backend : supported_backends()) {
+        std::vector<sha1::Digest> digests(messages.size());
+        std::vector<sha1::Job> jobs;
+        for (size_t i = 0; i < messages.size(); ++i) {
+            jobs.push_back({reinterpret_cast<const uint8_t*>(messages[i].data()), messages[i].size(), &digests[i]});
+        }
+        sha1::hash_many(jobs, backend);
+        CHECK(digests == expected);
+    }
+
+    auto answers = known_answers();
+    std::vector<sha1::Digest> digests(answers.size());
+    std::vector<sha1::Job> jobs;
+    for (size_t i = 0; i < answers.size(); ++i) {
+        jobs.push_back({reinterpret_cast<const uint8_t*>(answers[i].message.data()), answers[i].message.size(), &digests[i]});
+    }
+    sha1::hash_many(jobs);
+    for (size_t i = 0; i < answers.size(); ++i) {
+        CHECK(hex(digests[i]) == answers[i].digest);
+    }
+}
@@ -0,0 +1,7 @@
+target("file_formats_tests")
+    set_kind("binary")
+    set_default(false)
+    add_files("*.cpp")
+    add_includedirs("..")
+    add_deps("unreal_modding_file_formats")
+    add_tests("default")
@@ -0,0 +1,102 @@
+#include "test_support.h"
+
+#include <deploy.h>
+
+#include <filesystem>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace mo2;
+using test::ScratchDirectory;
+using test::write_file;
+
+namespace {
+    bool load_throws(const std::filesystem::path& file) {
+        try {
+            DeployManifest::load(file);
+        } catch (const std::runtime_error&) {
+            return true;
+        }
+        return false;
+    }
+
+    bool same_item(const DeployItem& a, const DeployItem& b) {
+        return a.target == b.target && a.source == b.source && a.size == b.size && a.mtime_ns == b.mtime_ns &&
+               a.method == b.method;
+    }
+}
+
+TEST_CASE(deploy_manifest_round_trips) {
+    ScratchDirectory scratch("manifest_round_trip");
+    DeployManifest manifest;
+    manifest.items = {
+        {"Content/Paks/~mods/Mod_P.pak", "/mods/Mod/Mod_P.pak", 123456789012ull, 1700000000123456789ll,
+         DeployMethod::Reflink},
+        {"Binaries/Win64/dxgi.dll", "/mods/Loader/dxgi.dll", 0, -5, DeployMethod::Hardlink},
+        {"Content/Movies/\xc3\xa9t\xc3\xa9 intro.mp4", "/mods/Movies/\xc3\xa9t\xc3\xa9 intro.mp4", 42, 0,
+         DeployMethod::Copy},
+    };
+    manifest.save(scratch.path / "manifest");
+
+    // Items come back sorted by target
+    DeployManifest loaded = DeployManifest::load(scratch.path / "manifest");
+    CHECK(loaded.items.size() == 3);
+    if (loaded.items.size() == 3) {
+        CHECK(same_item(loaded.items[0], manifest.items[1]));
+        CHECK(same_item(loaded.items[1], manifest.items[2]));
+        CHECK(same_item(loaded.items[2], manifest.items[0]));
+    }
+    CHECK(!std::filesystem::exists(scratch.path / "manifest.mo2_deploy_tmp"));
+}
+
+TEST_CASE(deploy_manifest_missing_file_is_empty) {
+    ScratchDirectory scratch("manifest_missing");
+    CHECK(DeployManifest::load(scratch.path / "manifest").items.empty());
+
+    DeployManifest empty;
+    empty.save(scratch.path / "manifest");
+    CHECK(DeployManifest::load(scratch.path / "manifest").items.empty());
+}
+
+TEST_CASE(deploy_manifest_rejects_malformed_files) {
+    ScratchDirectory scratch("manifest_malformed");
+    const std::filesystem::path file = scratch.path / "manifest";
+    const std::string header = "mo2-deploy-manifest 1\n";
+
+    write_file(file, "");
+    CHECK(load_throws(file));
+    write_file(file, "mo2-deploy-manifest 2\n");
+    CHECK(load_throws(file));
+    write_file(file, header + "2\t1\t1\ttarget\n");          // missing a field
+    CHECK(load_throws(file));
+    write_file(file, header + "2\tx\t1\ttarget\tsource\n");  // size isn't a number
+    CHECK(load_throws(file));
+    write_file(file, header + "2\t1 \t1\ttarget\tsource\n"); // trailing characters
+    CHECK(load_throws(file));
+    write_file(file, header + "3\t1\t1\ttarget\tsource\n");  // unknown method
+    CHECK(load_throws(file));
+
+    write_file(file, header + "1\t7\t-1\ttarget\t/mods/source\n");
+    DeployManifest loaded = DeployManifest::load(file);
+    CHECK(loaded.items.size() == 1);
+    if (loaded.items.size() == 1) {
+        CHECK(same_item(loaded.items[0], {"target", "/mods/source", 7, -1, DeployMethod::Hardlink}));
+    }
+}
+
+TEST_CASE(deploy_manifest_refuses_unrecordable_paths) {
+    ScratchDirectory scratch("manifest_unrecordable");
+    for (const char* target : {"with\ttab", "with\nbreak"}) {
+        DeployManifest manifest;
+        manifest.items.push_back({target, "/mods/source", 1, 1, DeployMethod::Copy});
+        bool threw = false;
+        try {
+            manifest.save(scratch.path / "manifest");
+        } catch (const std::runtime_error&) {
+            threw = true;
+        }
+        CHECK(threw);
+        CHECK(!std::filesystem::exists(scratch.path / "manifest"));
+    }
+}
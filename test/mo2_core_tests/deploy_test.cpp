@@ -0,0 +1,157 @@
+#include "test_support.h"
+
+#include <deploy.h>
+#include <loose_files.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace mo2;
+using test::ScratchDirectory;
+using test::write_file;
+
+namespace {
+    // Every file under `root`, relative and with its case, sorted
+    std::vector<std::string> files_under(const std::filesystem::path& root) {
+        std::vector<std::string> files;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator(root)) {
+            if (entry.is_regular_file() && entry.path().filename() != DEPLOY_MANIFEST_NAME) {
+                files.push_back(entry.path().lexically_relative(root).generic_string());
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    std::vector<std::string> targets(const DeployManifest& manifest) {
+        std::vector<std::string> result;
+        for (const auto& item : manifest.items) {
+            result.push_back(item.target);
+        }
+        return result;
+    }
+}
+
+TEST_CASE(deploy_keeps_the_case_on_disk) {
+    ScratchDirectory scratch("deploy_case");
+    const std::filesystem::path mods = scratch.path / "mods";
+    std::filesystem::create_directories(mods / "Movies/Content/Movies");
+    std::filesystem::create_directories(mods / "Override/Content/movies");
+    std::filesystem::create_directories(mods / "Loader/Binaries/Win64");
+    std::filesystem::create_directories(mods / "Archive");
+    write_file(mods / "Movies/Content/Movies/Intro.MP4", "intro");
+    write_file(mods / "Movies/Content/Movies/Credits.mp4", "credits");
+    write_file(mods / "Override/Content/movies/INTRO.mp4", "override");
+    write_file(mods / "Loader/Binaries/Win64/dxgi.DLL", "dll");
+    write_file(mods / "Archive/MyMod_P.pak", "pak");
+    write_file(mods / "Archive/MyMod_P.sig", "sig");
+
+    auto archives = std::make_shared<ArchiveSet>();
+    archives->add(list_archive(scan_loose_tree(mods / "Movies"), "Movies"));
+    archives->add(list_archive(scan_loose_tree(mods / "Loader"), "Loader"));
+    ArchiveListing pak;
+    pak.name = "MyMod_P";
+    pak.source = mods / "Archive/MyMod_P.pak";
+    pak.paths = {"game/content/mymod/asset.uasset"};
+    archives->add(std::move(pak));
+    archives->add(list_archive(scan_loose_tree(mods / "Override"), "Override"));
+    MergedVfs vfs = MergedVfs::build(archives);
+
+    // The override wins its path but keeps its own spelling
+    DeployManifest desired = desired_state(vfs, "Content/Paks/~Mods");
+    CHECK((targets(desired) == std::vector<std::string>{"Binaries/Win64/dxgi.DLL", "Content/Movies/Credits.mp4",
+                                                        "Content/Paks/~Mods/MyMod_P.pak",
+                                                        "Content/Paks/~Mods/MyMod_P.sig",
+                                                        "Content/movies/INTRO.mp4"}));
+    CHECK(desired.items.size() == 5 && desired.items[4].source == mods / "Override/Content/movies/INTRO.mp4");
+
+    const std::filesystem::path game = scratch.path / "game";
+    DeployReport report = deploy(game, desired);
+    CHECK(report.added == 5);
+    CHECK(files_under(game) == targets(desired));
+    CHECK(test::read_file(game / "Content/movies/INTRO.mp4") == "override");
+}
+
+namespace {
+    DeployItem item(std::string target, std::filesystem::path source, uint64_t size, int64_t mtime_ns) {
+        return {std::move(target), std::move(source), size, mtime_ns};
+    }
+
+    // What a single mod's loose files deploy as
+    DeployManifest desired_for(const std::filesystem::path& mod) {
+        auto archives = std::make_shared<ArchiveSet>();
+        archives->add(list_archive(scan_loose_tree(mod), "Mod"));
+        return desired_state(MergedVfs::build(archives), "Content/Paks/~mods");
+    }
+}
+
+TEST_CASE(deploy_plan_sorts_changes) {
+    DeployManifest deployed;
+    deployed.items = {item("a", "/mods/a", 1, 10), item("b", "/mods/b", 2, 20), item("c", "/mods/c", 3, 30),
+                      item("d", "/mods/d", 4, 40), item("e", "/mods/e", 5, 50)};
+    DeployManifest desired;
+    desired.items = {item("a", "/mods/a", 1, 10),     // unchanged
+                     item("b", "/mods/b", 2, 21),     // touched
+                     item("bb", "/mods/bb", 1, 1),    // new
+                     item("c", "/mods/c2", 3, 30),    // another source
+                     item("e", "/mods/e", 6, 50),     // resized
+                     item("f", "/mods/f", 1, 1)};     // new, after the last deployed one
+
+    DeployPlan plan = plan_deployment(desired, deployed);
+    CHECK(plan.unchanged == 1);
+    CHECK((plan.added == std::vector<size_t>{2, 5}));
+    CHECK((plan.replaced == std::vector<std::pair<size_t, size_t>>{{1, 1}, {3, 2}, {4, 4}}));
+    CHECK((plan.removed == std::vector<size_t>{3}));
+    CHECK(!plan.empty());
+
+    CHECK(plan_deployment(desired, desired).empty() && plan_deployment(desired, desired).unchanged == 6);
+    CHECK(plan_deployment({}, deployed).removed.size() == 5);
+    CHECK(plan_deployment(desired, {}).added.size() == 6);
+}
+
+TEST_CASE(deploy_round_trips) {
+    ScratchDirectory scratch("deploy_round_trip");
+    const std::filesystem::path mod = scratch.path / "mod";
+    const std::filesystem::path game = scratch.path / "game";
+    std::filesystem::create_directories(mod / "Content/Maps");
+    std::filesystem::create_directories(mod / "Content/Old/Deep");
+    write_file(mod / "Content/Maps/Level.umap", "level");
+    write_file(mod / "Content/Old/Deep/Gone.uasset", "gone");
+    write_file(mod / "Content/Data", "a file, for now");
+
+    DeployManifest first = desired_for(mod);
+    DeployReport report = deploy(game, first);
+    CHECK(report.added == 3 && report.removed == 0 && report.copied + report.reflinked == 3);
+    CHECK(files_under(game) == targets(first));
+    CHECK(targets(DeployManifest::load(game / DEPLOY_MANIFEST_NAME)) == targets(first));
+
+    // Nothing changed, nothing touched
+    report = deploy(game, desired_for(mod));
+    CHECK(report.unchanged == 3 && report.added == 0 && report.replaced == 0 && report.removed == 0);
+
+    // One source changes, one goes away and a directory takes the place of
+    // a file
+    write_file(mod / "Content/Maps/Level.umap", "level, edited");
+    std::filesystem::remove_all(mod / "Content/Old");
+    std::filesystem::remove(mod / "Content/Data");
+    std::filesystem::create_directories(mod / "Content/Data");
+    write_file(mod / "Content/Data/Table.uasset", "table");
+
+    DeployManifest second = desired_for(mod);
+    report = deploy(game, second);
+    CHECK(report.replaced == 1 && report.removed == 2 && report.added == 1 && report.unchanged == 0);
+    CHECK(files_under(game) == targets(second));
+    CHECK(test::read_file(game / "Content/Maps/Level.umap") == "level, edited");
+    CHECK(!std::filesystem::exists(game / "Content/Old"));
+
+    // And back: the file takes the place of the directory
+    std::filesystem::remove_all(mod / "Content/Data");
+    write_file(mod / "Content/Data", "a file again");
+    report = deploy(game, desired_for(mod));
+    CHECK(report.added == 1 && report.removed == 1 && report.unchanged == 1);
+    CHECK(test::read_file(game / "Content/Data") == "a file again");
+    CHECK(deploy(game, desired_for(mod)).unchanged == 2);
+}
@@ -0,0 +1,56 @@
+#include "test_support.h"
+
+#include <job_scheduler.h>
+#include <loose_files.h>
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+using namespace mo2;
+using test::ScratchDirectory;
+using test::write_file;
+
+namespace {
+    // Three levels of directories, a few files in each
+    void make_tree(const std::filesystem::path& root) {
+        for (const char* directory : {"Content/Paks", "Content/Movies/Intro", "Binaries/Win64", "Empty"}) {
+            std::filesystem::create_directories(root / directory);
+        }
+        write_file(root / "Content/Paks/Mod_P.pak", "pak");
+        write_file(root / "Content/Movies/Intro/Logo.mp4", "movie");
+        write_file(root / "Binaries/Win64/dxgi.dll", "dll!");
+        write_file(root / "ReadMe.txt", "");
+    }
+
+    std::vector<std::string> relative_paths(const LooseTree& tree) {
+        std::vector<std::string> paths;
+        for (const auto& file : tree.files) {
+            paths.push_back(file.relative);
+        }
+        return paths;
+    }
+}
+
+TEST_CASE(loose_tree_lists_every_file) {
+    ScratchDirectory scratch("loose_tree");
+    make_tree(scratch.path);
+
+    LooseTree tree = scan_loose_tree(scratch.path);
+    CHECK((relative_paths(tree) == std::vector<std::string>{"Binaries/Win64/dxgi.dll", "Content/Movies/Intro/Logo.mp4",
+                                                            "Content/Paks/Mod_P.pak", "ReadMe.txt"}));
+    CHECK(tree.files.size() == 4 && tree.files[0].path == "binaries/win64/dxgi.dll" && tree.files[0].size == 4);
+    CHECK(tree.unreadable.empty());
+}
+
+TEST_CASE(loose_tree_scans_from_a_job_on_its_own_scheduler) {
+    ScratchDirectory scratch("loose_tree_nested");
+    make_tree(scratch.path);
+
+    // The only worker is the one scanning; the scan must not wait for it
+    JobScheduler scheduler(1);
+    LooseTree tree;
+    JobHandle job = scheduler.run(JobPriority::Normal, [&](JobContext&) { tree = scan_loose_tree(scratch.path, &scheduler); });
+    job.wait();
+    CHECK(tree.files.size() == 4);
+}
@@ -0,0 +1,93 @@
+#include "test_support.h"
+
+#include <roaring_bitmap.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <set>
+#include <vector>
+
+using namespace mo2;
+
+namespace {
+    std::vector<uint32_t> sorted(const std::set<uint32_t>& values) {
+        return {values.begin(), values.end()};
+    }
+
+    // Values that exercise both container kinds: a sparse array container,
+    // a dense bitmap container and values around 16-bit boundaries
+    std::set<uint32_t> sample(uint32_t seed, uint32_t dense_key) {
+        std::mt19937 random(seed);
+        std::set<uint32_t> values = {0, 65535, 65536, 0xFFFFFFFFu};
+        for (int i = 0; i < 1000; ++i) {
+            values.insert(random() % (1u << 20));
+        }
+        for (int i = 0; i < 20000; ++i) {
+            values.insert((dense_key << 16) | (random() & 0xFFFF));
+        }
+        return values;
+    }
+}
+
+TEST_CASE(roaring_add_and_contains) {
+    RoaringBitmap bitmap;
+    CHECK(bitmap.empty());
+    CHECK(bitmap.cardinality() == 0);
+
+    for (uint32_t value : {5u, 3u, 70000u, 3u, 0xFFFFFFFFu}) {
+        bitmap.add(value);
+    }
+    CHECK(bitmap.cardinality() == 4);
+    CHECK(bitmap.contains(3) && bitmap.contains(5) && bitmap.contains(70000) && bitmap.contains(0xFFFFFFFFu));
+    CHECK(!bitmap.contains(4) && !bitmap.contains(65536 + 3));
+    CHECK(bitmap.minimum() == 3);
+    CHECK(bitmap.maximum() == 0xFFFFFFFFu);
+    CHECK((bitmap.to_vector() == std::vector<uint32_t>{3, 5, 70000, 0xFFFFFFFFu}));
+}
+
+TEST_CASE(roaring_array_to_bitmap_container) {
+    // One more value than the array limit turns the container into a bitmap
+    std::vector<uint32_t> values;
+    for (uint32_t i = 0; i <= 4096; ++i) {
+        values.push_back(i * 2);
+    }
+    RoaringBitmap bitmap = RoaringBitmap::from_sorted(values);
+    CHECK(bitmap.cardinality() == 4097);
+    CHECK(bitmap.to_vector() == values);
+    CHECK(bitmap.contains(8192) && !bitmap.contains(8191));
+
+    std::vector<uint32_t> visited;
+    bitmap.for_each([&](uint32_t value) { visited.push_back(value); });
+    CHECK(visited == values);
+}
+
+TEST_CASE(roaring_set_operations) {
+    auto a_values = sample(1, 3);
+    auto b_values = sample(2, 3);
+    RoaringBitmap a = RoaringBitmap::from_sorted(sorted(a_values));
+    RoaringBitmap b = RoaringBitmap::from_sorted(sorted(b_values));
+
+    std::vector<uint32_t> both;
+    std::vector<uint32_t> either;
+    std::vector<uint32_t> only_a;
+    std::set_intersection(a_values.begin(), a_values.end(), b_values.begin(), b_values.end(), std::back_inserter(both));
+    std::set_union(a_values.begin(), a_values.end(), b_values.begin(), b_values.end(), std::back_inserter(either));
+    std::set_difference(a_values.begin(), a_values.end(), b_values.begin(), b_values.end(), std::back_inserter(only_a));
+
+    CHECK((a & b).to_vector() == both);
+    CHECK((a | b).to_vector() == either);
+    CHECK(a.and_not(b).to_vector() == only_a);
+    CHECK(a.and_cardinality(b) == both.size());
+    CHECK((a & b) == RoaringBitmap::from_sorted(both));
+    CHECK(!(a == b));
+    CHECK((a & RoaringBitmap()).empty());
+    CHECK(a.and_not(a).empty());
+}
+
+TEST_CASE(roaring_from_sorted_with_duplicates) {
+    std::vector<uint32_t> values = {1, 1, 2, 2, 2, 65536, 65536};
+    RoaringBitmap bitmap = RoaringBitmap::from_sorted(values);
+    CHECK((bitmap.to_vector() == std::vector<uint32_t>{1, 2, 65536}));
+    CHECK(bitmap.cardinality() == 3);
+}
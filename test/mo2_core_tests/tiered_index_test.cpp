@@ -0,0 +1,115 @@
+#include "test_support.h"
+
+#include <tiered_index.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace mo2;
+
+namespace {
+    // Same shape for every name, so every archive costs the same per tier
+    ArchiveListing sample_listing(const std::string& name) {
+        ArchiveListing listing;
+        listing.name = name;
+        listing.kind = ArchiveKind::Pak;
+        listing.source = "/mods/" + name + ".pak";
+        for (int i = 0; i < 1000; ++i) {
+            listing.paths.push_back("game/content/" + name + "/asset_" + std::to_string(10000 + i) + ".uasset");
+        }
+        return listing;
+    }
+
+    // Lists archives from sample_listing() and counts the calls
+    struct CountingLoader {
+        std::shared_ptr<size_t> calls = std::make_shared<size_t>(0);
+
+        TieredIndexes::Loader loader() const {
+            return [calls = calls](const ArchiveSource& source) {
+                ++*calls;
+                return sample_listing(source.name);
+            };
+        }
+    };
+
+    constexpr size_t UNLIMITED = ~size_t(0);
+}
+
+TEST_CASE(tiered_index_demotes_least_recently_used) {
+    CountingLoader loads;
+    TieredIndexes indexes({UNLIMITED, UNLIMITED}, loads.loader());
+    ArchiveId a = indexes.add(sample_listing("a"));
+    ArchiveId b = indexes.add(sample_listing("b"));
+    ArchiveId c = indexes.add(sample_listing("c"));
+    const size_t hot = indexes.stats().bytes[0] / 3;
+    CHECK(indexes.stats().archives[0] == 3 && hot > 0);
+
+    // Room for two hot listings: the oldest one is compressed
+    indexes.set_budget({hot * 5 / 2, UNLIMITED});
+    CHECK(indexes.tier(a) == IndexTier::Warm && indexes.tier(b) == IndexTier::Hot && indexes.tier(c) == IndexTier::Hot);
+    ResidencyStats stats = indexes.stats();
+    CHECK(stats.archives[1] == 1 && stats.bytes[1] > 0 && stats.bytes[1] < hot);
+
+    // Using b makes c the least recently used
+    CHECK(indexes.find(b, "game/content/b/asset_10500.uasset") == 500u);
+    ArchiveId d = indexes.add(sample_listing("d"));
+    CHECK(indexes.tier(c) == IndexTier::Warm && indexes.tier(b) == IndexTier::Hot && indexes.tier(d) == IndexTier::Hot);
+
+    // Over the total, compressed listings go cold first, oldest first
+    stats = indexes.stats();
+    indexes.set_budget({hot * 5 / 2, stats.bytes[0] + stats.bytes[1] - 1});
+    CHECK(indexes.tier(a) == IndexTier::Cold && indexes.tier(c) == IndexTier::Warm);
+    indexes.set_budget({hot * 5 / 2, stats.bytes[0] + stats.bytes[1] / 2});
+    CHECK(indexes.tier(c) == IndexTier::Cold && indexes.tier(b) == IndexTier::Hot);
+    stats = indexes.stats();
+    CHECK(stats.archives[0] == 2 && stats.archives[1] == 0 && stats.archives[2] == 2);
+    CHECK(*loads.calls == 0);
+}
+
+TEST_CASE(tiered_index_promotes_on_use) {
+    CountingLoader loads;
+    TieredIndexes indexes({UNLIMITED, UNLIMITED}, loads.loader());
+    ArchiveId a = indexes.add(sample_listing("a"));
+    ArchiveId b = indexes.add(sample_listing("b"));
+    const size_t hot = indexes.stats().bytes[0] / 2;
+
+    // a warm, then cold; listings handed out earlier stay valid
+    auto before = indexes.listing(b);
+    indexes.set_budget({hot * 3 / 2, UNLIMITED});
+    CHECK(indexes.tier(a) == IndexTier::Warm);
+    auto listing = indexes.listing(a);
+    CHECK(indexes.tier(a) == IndexTier::Hot && indexes.tier(b) == IndexTier::Warm);
+    CHECK(listing->paths.size() == 1000 && listing->paths[7] == "game/content/a/asset_10007.uasset");
+    CHECK(before->name == "b" && before->paths.size() == 1000);
+    CHECK(*loads.calls == 0);
+
+    indexes.set_budget({hot * 3 / 2, indexes.stats().bytes[0]});
+    CHECK(indexes.tier(b) == IndexTier::Cold);
+    CHECK(indexes.find(b, "game/content/b/asset_10999.uasset") == 999u);
+    CHECK(*loads.calls == 1 && indexes.tier(b) == IndexTier::Hot);
+    CHECK(indexes.tier(a) == IndexTier::Cold); // b took the room a had
+    CHECK(indexes.find(a, "game/content/a/asset_10000.uasset") == 0u);
+    CHECK(*loads.calls == 2 && !indexes.find(a, "game/content/a/asset_20000.uasset"));
+}
+
+TEST_CASE(tiered_index_bloom_negatives_never_load) {
+    CountingLoader loads;
+    TieredIndexes indexes({0, 0}, loads.loader());
+    ArchiveId a = indexes.add(sample_listing("a"));
+    indexes.set_budget({0, 0});
+    CHECK(indexes.tier(a) == IndexTier::Cold);
+
+    size_t ruled_out = 0;
+    for (int i = 0; i < 1000; ++i) {
+        std::string path = "game/content/other/asset_" + std::to_string(i) + ".uasset";
+        if (!indexes.may_contain(a, path)) {
+            ++ruled_out;
+            CHECK(!indexes.find(a, path));
+        }
+    }
+    CHECK(ruled_out > 900 && *loads.calls == 0 && indexes.tier(a) == IndexTier::Cold);
+    CHECK(indexes.may_contain(a, "game/content/a/asset_10123.uasset"));
+}
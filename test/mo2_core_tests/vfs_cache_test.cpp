@@ -0,0 +1,166 @@
+#include "test_support.h"
+
+#include <vfs_cache.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+using namespace mo2;
+using test::read_file;
+using test::ScratchDirectory;
+using test::write_file;
+
+namespace {
+    std::vector<CachedArchive> sample_archives() {
+        ArchiveListing pak;
+        pak.name = "Mod_P";
+        pak.kind = ArchiveKind::Pak;
+        pak.source = "/mods/Mod/Mod_P.pak";
+        for (int i = 0; i < 500; ++i) {
+            pak.paths.push_back("game/content/mod/asset_" + std::to_string(i) + ".uasset");
+        }
+
+        ArchiveListing loose;
+        loose.name = "Loose";
+        loose.kind = ArchiveKind::Loose;
+        loose.source = "/mods/Loose";
+        loose.paths = {"game/content/mod/asset_7.uasset", "game/binaries/win64/dxgi.dll"};
+        loose.source_paths = {"Content/Mod/Asset_7.uasset", "Binaries/Win64/dxgi.dll"};
+
+        ArchiveListing empty;
+        empty.name = "Empty";
+        empty.kind = ArchiveKind::IoStore;
+        empty.source = "/mods/Empty/Empty.utoc";
+
+        return {
+            {{123456789, 1700000000123456789ll, 0x0123456789abcdefull}, VfsArchive::index(std::move(pak))},
+            {{2, -1, 42}, VfsArchive::index(std::move(loose))},
+            {{0, 0, 0}, VfsArchive::index(std::move(empty))},
+        };
+    }
+
+    template <typename T>
+    bool same_span(std::span<const T> a, std::span<const T> b) {
+        return std::equal(a.begin(), a.end(), b.begin(), b.end());
+    }
+
+    bool same_archive(const CachedArchive& a, const CachedArchive& b) {
+        const VfsArchive::Tables& x = a.archive->tables();
+        const VfsArchive::Tables& y = b.archive->tables();
+        return a.fingerprint == b.fingerprint && a.archive->name() == b.archive->name() &&
+               a.archive->kind() == b.archive->kind() && a.archive->source() == b.archive->source() &&
+               same_span(x.hashes, y.hashes) && same_span(x.entries, y.entries) &&
+               same_span(x.leaf_starts, y.leaf_starts) && same_span(x.path_offsets, y.path_offsets) &&
+               same_span(x.path_chars, y.path_chars) && same_span(x.source_path_offsets, y.source_path_offsets) &&
+               same_span(x.source_path_chars, y.source_path_chars);
+    }
+}
+
+TEST_CASE(vfs_cache_round_trips) {
+    ScratchDirectory scratch("vfs_cache_round_trip");
+    const auto archives = sample_archives();
+    save_vfs_cache(scratch.path / "cache", archives);
+    CHECK(!std::filesystem::exists(scratch.path / "cache.tmp"));
+
+    auto loaded = load_vfs_cache(scratch.path / "cache");
+    CHECK(loaded.size() == archives.size());
+    if (loaded.size() != archives.size()) {
+        return;
+    }
+    for (size_t i = 0; i < archives.size(); ++i) {
+        CHECK(same_archive(loaded[i], archives[i]));
+    }
+    CHECK(loaded[1].archive->source_path(0) == archives[1].archive->source_path(0));
+
+    // The loaded tables resolve lookups like the ones they were saved from
+    auto snapshot = VfsSnapshot::build({loaded[0].archive, loaded[1].archive, loaded[2].archive});
+    CHECK(snapshot->size() == 501);
+    auto overridden = snapshot->find("game/content/mod/asset_7.uasset");
+    CHECK(overridden && overridden->archive == loaded[1].archive.get());
+    auto asset = snapshot->find("game/content/mod/asset_499.uasset");
+    CHECK(asset && snapshot->path(*asset) == "game/content/mod/asset_499.uasset");
+    CHECK(!snapshot->find("game/content/mod/asset_500.uasset"));
+
+    // An empty cache round-trips too
+    save_vfs_cache(scratch.path / "cache", {});
+    CHECK(load_vfs_cache(scratch.path / "cache").empty());
+}
+
+TEST_CASE(vfs_cache_unusable_files_are_empty) {
+    ScratchDirectory scratch("vfs_cache_unusable");
+    const std::filesystem::path file = scratch.path / "cache";
+    CHECK(load_vfs_cache(file).empty());
+
+    write_file(file, "not a cache at all");
+    CHECK(load_vfs_cache(file).empty());
+
+    save_vfs_cache(file, sample_archives());
+    const std::string saved = read_file(file);
+
+    // The version follows the 8-byte magic
+    std::string outdated = saved;
+    ++outdated[8];
+    write_file(file, outdated);
+    CHECK(load_vfs_cache(file).empty());
+
+    // The header promises three archives, so every cut is short of one
+    for (size_t size = 0; size < saved.size(); size += 7) {
+        write_file(file, saved.substr(0, size));
+        CHECK(load_vfs_cache(file).empty());
+    }
+}
+
+TEST_CASE(vfs_cache_survives_damage) {
+    ScratchDirectory scratch("vfs_cache_damage");
+    const std::filesystem::path file = scratch.path / "cache";
+    const auto archives = sample_archives();
+    save_vfs_cache(file, archives);
+    const std::string saved = read_file(file);
+
+    // Flipped bytes may go unnoticed (paths aren't hashed again), but they
+    // must never make an archive point outside its tables
+    std::mt19937_64 rng(99);
+    for (int round = 0; round < 300; ++round) {
+        std::string damaged = saved;
+        for (int flips = 0; flips < 3; ++flips) {
+            damaged[rng() % damaged.size()] ^= static_cast<char>(1 + rng() % 255);
+        }
+        write_file(file, damaged);
+        for (const auto& cached : load_vfs_cache(file)) {
+            const VfsArchive::Tables& tables = cached.archive->tables();
+            size_t path_bytes = 0;
+            for (uint32_t i = 0; i < cached.archive->size(); ++i) {
+                path_bytes += cached.archive->path(i).size();
+            }
+            CHECK(path_bytes == tables.path_chars.size());
+            auto snapshot = VfsSnapshot::build({cached.archive});
+            CHECK(snapshot->size() <= cached.archive->size());
+        }
+    }
+}
+
+TEST_CASE(vfs_cache_loads_one_archive) {
+    ScratchDirectory scratch("vfs_cache_one_archive");
+    const std::filesystem::path file = scratch.path / "cache";
+    const auto archives = sample_archives();
+    save_vfs_cache(file, archives);
+
+    for (const auto& cached : archives) {
+        auto loaded = load_cached_archive(file, {"any", cached.archive->kind(), cached.archive->source()});
+        CHECK(loaded && same_archive(*loaded, cached));
+    }
+    CHECK(!load_cached_archive(file, {"Mod_P", ArchiveKind::IoStore, "/mods/Mod/Mod_P.pak"}));
+    CHECK(!load_cached_archive(file, {"Other", ArchiveKind::Pak, "/mods/Other.pak"}));
+
+    // Cut inside the last archive, the ones before it still load
+    const std::string saved = read_file(file);
+    write_file(file, saved.substr(0, saved.size() - 1));
+    CHECK(load_cached_archive(file, {"Mod_P", ArchiveKind::Pak, "/mods/Mod/Mod_P.pak"}));
+    CHECK(!load_cached_archive(file, {"Empty", ArchiveKind::IoStore, "/mods/Empty/Empty.utoc"}));
+    CHECK(!load_cached_archive(scratch.path / "missing", {"Mod_P", ArchiveKind::Pak, "/mods/Mod/Mod_P.pak"}));
+}
@@ -0,0 +1,7 @@
+target("mo2_core_tests")
+    set_kind("binary")
+    set_default(false)
+    add_files("*.cpp")
+    add_includedirs("..")
+    add_deps("unreal_modding_mo2_core")
+    add_tests("default")
@@ -0,0 +1,260 @@
+#include "test_support.h"
+
+#include <pak_reader.h>
+#include <sha1.h>
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace pak;
+using test::ScratchDirectory;
+using test::write_file;
+
+namespace {
+    // Lays out a frozen index the way the 64-bit 4.25 layout has it: the
+    // FPakFileData at offset 0, everything it points to after it
+    class ImageBuilder {
+    public:
+        size_t allocate(size_t size, size_t alignment = 8) {
+            size_t offset = (bytes.size() + alignment - 1) / alignment * alignment;
+            bytes.resize(offset + size);
+            return offset;
+        }
+
+        template <typename T>
+        void put(size_t at, T value) {
+            std::memcpy(bytes.data() + at, &value, sizeof(T));
+        }
+
+        void pointer(size_t field, size_t target) {
+            uint64_t from_field = static_cast<uint64_t>(static_cast<int64_t>(target) - static_cast<int64_t>(field));
+            put<uint64_t>(field, ((from_field & ((uint64_t(1) << 40) - 1)) << 1) | 1);
+        }
+
+        void array(size_t field, size_t data, int32_t count) {
+            if (count > 0) {
+                pointer(field, data);
+            }
+            put<int32_t>(field + 8, count);
+            put<int32_t>(field + 12, count);
+        }
+
+        void string(size_t field, std::string_view text) {
+            size_t chars = allocate((text.size() + 1) * sizeof(uint16_t), sizeof(uint16_t));
+            for (size_t i = 0; i < text.size(); ++i) {
+                put<uint16_t>(chars + i * sizeof(uint16_t), static_cast<uint8_t>(text[i]));
+            }
+            array(field, chars, static_cast<int32_t>(text.size() + 1));
+        }
+
+        // A TSet at `field` with a slot per entry of `used`; returns the
+        // offsets of the allocated elements
+        std::vector<size_t> set(size_t field, size_t element_size, const std::vector<bool>& used) {
+            size_t elements = allocate(used.size() * element_size);
+            size_t flags = allocate((used.size() + 31) / 32 * 4, 4);
+            size_t buckets = allocate(4, 4);
+            array(field, elements, static_cast<int32_t>(used.size()));
+
+            std::vector<size_t> allocated;
+            int32_t free_count = 0;
+            for (size_t i = 0; i < used.size(); ++i) {
+                if (used[i]) {
+                    uint32_t word;
+                    std::memcpy(&word, bytes.data() + flags + i / 32 * 4, sizeof(word));
+                    put<uint32_t>(flags + i / 32 * 4, word | (1u << (i % 32)));
+                    allocated.push_back(elements + i * element_size);
+                } else {
+                    ++free_count;
+                }
+            }
+            if (!used.empty()) {
+                pointer(field + 16, flags);
+            }
+            put<int32_t>(field + 24, static_cast<int32_t>(used.size()));
+            put<int32_t>(field + 28, static_cast<int32_t>(used.size()));
+            put<int32_t>(field + 32, -1);
+            put<int32_t>(field + 36, free_count);
+            pointer(field + 40, buckets);
+            put<int32_t>(field + 48, 1);
+            return allocated;
+        }
+
+        std::vector<uint8_t> bytes;
+    };
+
+    struct FrozenFile {
+        std::string name;
+        uint32_t entry;
+    };
+
+    struct FrozenDirectory {
+        std::string name;
+        std::vector<FrozenFile> files;
+    };
+
+    // Two entries: a stored one, and a compressed one with two blocks
+    std::vector<uint8_t> sample_image(const std::vector<FrozenDirectory>& directories) {
+        ImageBuilder image;
+        image.allocate(88);
+        image.string(0, "../../../Game/");
+
+        size_t entries = image.allocate(2 * 80);
+        image.array(16, entries, 2);
+        image.put<int64_t>(entries, 0);
+        image.put<int64_t>(entries + 8, 10);
+        image.put<int64_t>(entries + 16, 10);
+        for (uint8_t i = 0; i < 20; ++i) {
+            image.put<uint8_t>(entries + 24 + i, static_cast<uint8_t>(i + 1));
+        }
+
+        size_t compressed = entries + 80;
+        size_t blocks = image.allocate(2 * 16);
+        image.put<int64_t>(compressed, 100);
+        image.put<int64_t>(compressed + 8, 300);
+        image.put<int64_t>(compressed + 16, 131072);
+        image.array(compressed + 48, blocks, 2);
+        image.put<int64_t>(blocks, 73);
+        image.put<int64_t>(blocks + 8, 173);
+        image.put<int64_t>(blocks + 16, 173);
+        image.put<int64_t>(blocks + 24, 373);
+        image.put<uint32_t>(compressed + 64, 65536);
+        image.put<uint32_t>(compressed + 68, 1);
+
+        // The first directory slot is left free, as after a removal
+        std::vector<bool> used(directories.size() + 1, true);
+        used[0] = false;
+        auto directory_elements = image.set(32, 80, used);
+        for (size_t d = 0; d < directories.size(); ++d) {
+            image.string(directory_elements[d], directories[d].name);
+            auto file_elements = image.set(directory_elements[d] + 16, 32,
+                                           std::vector<bool>(directories[d].files.size(), true));
+            for (size_t f = 0; f < directories[d].files.size(); ++f) {
+                image.string(file_elements[f], directories[d].files[f].name);
+                image.put<int32_t>(file_elements[f] + 16, static_cast<int32_t>(directories[d].files[f].entry));
+            }
+        }
+        return image.bytes;
+    }
+
+    std::vector<FrozenDirectory> sample_directories() {
+        return {
+            {"Content/Maps/", {{"Level.umap", 0}}},
+            {"/Content/Data/", {{"Table.uasset", 1}, {"Copy.uasset", 0}}},
+        };
+    }
+
+    // A V9 pak whose index is `image`, frozen; `hash` overrides its SHA1
+    void write_frozen_pak(const std::filesystem::path& file, const std::vector<uint8_t>& image,
+                          const file_formats::sha1::Digest* hash = nullptr) {
+        std::string pak(64, '\0');
+        const uint64_t index_offset = pak.size();
+        pak.append(reinterpret_cast<const char*>(image.data()), image.size());
+
+        auto append = [&](const void* data, size_t size) { pak.append(static_cast<const char*>(data), size); };
+        const uint64_t index_size = image.size();
+        const uint32_t magic = MAGIC;
+        const uint32_t version = 9;
+        const auto digest = hash ? *hash : file_formats::sha1::hash(image.data(), image.size());
+        pak.append(16, '\0'); // encryption key GUID
+        pak.push_back('\0');  // index not encrypted
+        append(&magic, sizeof(magic));
+        append(&version, sizeof(version));
+        append(&index_offset, sizeof(index_offset));
+        append(&index_size, sizeof(index_size));
+        append(digest.data(), digest.size());
+        pak.push_back('\1'); // frozen
+        char names[5][32] = {"Zlib"};
+        append(names, sizeof(names));
+        write_file(file, pak);
+    }
+
+    bool open_throws_unsupported(const std::filesystem::path& file) {
+        try {
+            PakReader reader(file);
+        } catch (const UnsupportedPakException&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+TEST_CASE(frozen_index_serves_lookups) {
+    ScratchDirectory scratch("frozen_index_lookups");
+    write_frozen_pak(scratch.path / "frozen.pak", sample_image(sample_directories()));
+
+    PakReader reader(scratch.path / "frozen.pak");
+    CHECK(reader.version() == Version::V9);
+    CHECK(reader.mount_point() == "../../../Game/");
+    CHECK((reader.files() == std::vector<std::string>{"Content/Data/Copy.uasset", "Content/Data/Table.uasset",
+                                                      "Content/Maps/Level.umap"}));
+    CHECK((reader.directories() == std::vector<std::string>{"Content", "Content/Data", "Content/Maps"}));
+
+    const Entry* level = reader.find("Content/Maps/Level.umap");
+    CHECK(level && level->offset == 0 && level->compressed_size == 10 && level->uncompressed_size == 10);
+    CHECK(level && !level->compression_slot && !level->blocks && level->hash[0] == 1 && level->hash[19] == 20);
+
+    const Entry* table = reader.find("Content/Data/Table.uasset");
+    CHECK(table && table->offset == 100 && table->compressed_size == 300 && table->uncompressed_size == 131072);
+    CHECK(table && table->compression_slot == 0u && table->compression_block_size == 65536);
+    CHECK(table && table->blocks && table->blocks->size() == 2 && (*table->blocks)[1].start == 173 &&
+          (*table->blocks)[1].end == 373);
+
+    // Entries are decoded once, so every lookup of a path gets the same one
+    std::vector<std::string_view> paths = {"Content/Data/Copy.uasset", "Content/Maps/Missing.umap",
+                                           "Content/Maps/Level.umap"};
+    auto found = reader.find_many(paths);
+    CHECK(found.size() == 3 && found[0] && found[0]->offset == 0 && !found[1] && found[2] == level);
+    CHECK(!reader.find("Content/Maps/Level.uexp"));
+}
+
+TEST_CASE(frozen_index_parses_in_one_step) {
+    ScratchDirectory scratch("frozen_index_parser");
+    write_frozen_pak(scratch.path / "frozen.pak", sample_image(sample_directories()));
+
+    IndexParser parser(scratch.path / "frozen.pak");
+    CHECK(parser.done() && parser.parsed_count() == 3 && parser.total_count() == 3);
+    auto reader = parser.finish();
+    CHECK(reader->find("Content/Data/Table.uasset"));
+}
+
+TEST_CASE(frozen_index_rejects_damage) {
+    ScratchDirectory scratch("frozen_index_damage");
+    const std::filesystem::path file = scratch.path / "frozen.pak";
+
+    // Checked against the footer's hash first
+    file_formats::sha1::Digest wrong{};
+    write_frozen_pak(file, sample_image(sample_directories()), &wrong);
+    CHECK(open_throws_unsupported(file));
+
+    // A file naming a record that doesn't exist
+    auto directories = sample_directories();
+    directories[0].files[0].entry = 2;
+    write_frozen_pak(file, sample_image(directories));
+    CHECK(open_throws_unsupported(file));
+
+    // A pointer that isn't frozen, one pointing out of the image, and a
+    // count over the array's capacity
+    auto image = sample_image(sample_directories());
+    image[16] &= 0xfe;
+    write_frozen_pak(file, image);
+    CHECK(open_throws_unsupported(file));
+
+    image = sample_image(sample_directories());
+    uint64_t outside = (uint64_t(image.size()) << 1) | 1;
+    std::memcpy(image.data() + 16, &outside, sizeof(outside));
+    write_frozen_pak(file, image);
+    CHECK(open_throws_unsupported(file));
+
+    image = sample_image(sample_directories());
+    image[28] = 1;
+    write_frozen_pak(file, image);
+    CHECK(open_throws_unsupported(file));
+
+    // Too short for FPakFileData
+    write_frozen_pak(file, std::vector<uint8_t>(40));
+    CHECK(open_throws_unsupported(file));
+}
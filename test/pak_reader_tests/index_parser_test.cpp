@@ -0,0 +1,75 @@
+#include "test_support.h"
+
+#include <pak_reader.h>
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+
+using namespace pak;
+using test::ScratchDirectory;
+using test::write_file;
+
+namespace {
+    // A V8B pak whose index promises `entry_count` entries but holds none
+    void write_truncated_pak(const std::filesystem::path& file, uint32_t entry_count) {
+        std::string pak;
+        auto append = [&](const void* data, size_t size) { pak.append(static_cast<const char*>(data), size); };
+        const std::string mount_point = "../../../";
+        const int32_t mount_length = static_cast<int32_t>(mount_point.size() + 1);
+        append(&mount_length, sizeof(mount_length));
+        pak.append(mount_point);
+        pak.push_back('\0');
+        append(&entry_count, sizeof(entry_count));
+
+        const uint64_t index_offset = 0;
+        const uint64_t index_size = pak.size();
+        const uint32_t magic = MAGIC;
+        const uint32_t version = 8;
+        pak.append(16, '\0'); // encryption key GUID
+        pak.push_back('\0');  // index not encrypted
+        append(&magic, sizeof(magic));
+        append(&version, sizeof(version));
+        append(&index_offset, sizeof(index_offset));
+        append(&index_size, sizeof(index_size));
+        pak.append(20, '\0');     // index hash
+        pak.append(5 * 32, '\0'); // compression names
+        write_file(file, pak);
+    }
+
+    bool throws_pak_exception(auto&& fn) {
+        try {
+            fn();
+        } catch (const PakException&) {
+            return true;
+        }
+        return false;
+    }
+}
+
+TEST_CASE(index_parser_reads_an_empty_index) {
+    ScratchDirectory scratch("index_parser_empty");
+    write_truncated_pak(scratch.path / "empty.pak", 0);
+
+    IndexParser parser(scratch.path / "empty.pak");
+    CHECK(parser.step(std::chrono::milliseconds(10)));
+    CHECK(parser.done() && parser.total_count() == 0);
+    auto reader = parser.finish();
+    CHECK(reader->files().empty() && reader->version() == Version::V8B);
+}
+
+TEST_CASE(index_parser_stays_failed) {
+    ScratchDirectory scratch("index_parser_failed");
+    write_truncated_pak(scratch.path / "truncated.pak", 5);
+
+    // The header parses; the missing entries only show up while stepping
+    IndexParser parser(scratch.path / "truncated.pak");
+    CHECK(!parser.done() && parser.total_count() == 5);
+    CHECK(throws_pak_exception([&] { parser.step(std::chrono::seconds(1)); }));
+    CHECK(!parser.done());
+    CHECK(throws_pak_exception([&] { parser.step(std::chrono::seconds(1)); }));
+    CHECK(throws_pak_exception([&] { parser.finish(); }));
+
+    CHECK(throws_pak_exception([&] { PakReader reader(scratch.path / "truncated.pak"); }));
+}
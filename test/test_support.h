@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <vector>
+
+// Minimal test harness: TEST_CASE registers a function, CHECK records a
+// failure without stopping the case, and run_all() runs every case.
+namespace test {
+
+struct Case {
+    const char* name;
+    void (*fn)();
+};
+
+inline std::vector<Case>& cases() {
+    static std::vector<Case> all;
+    return all;
+}
+
+inline int failures = 0;
+
+struct Register {
+    Register(const char* name, void (*fn)()) { cases().push_back({name, fn}); }
+};
+
+inline int run_all() {
+    for (const auto& c : cases()) {
+        int before = failures;
+        c.fn();
+        std::printf("%s %s\n", failures == before ? "PASS" : "FAIL", c.name);
+    }
+    std::printf("%zu cases, %d failed checks\n", cases().size(), failures);
+    return failures == 0 ? 0 : 1;
+}
+
+// A fresh directory under the system temp directory, removed afterwards
+struct ScratchDirectory {
+    explicit ScratchDirectory(const std::string& name)
+        : path(std::filesystem::temp_directory_path() / ("unreal_modding_tests_" + name)) {
+        std::filesystem::remove_all(path);
+        std::filesystem::create_directories(path);
+    }
+    ~ScratchDirectory() {
+        std::error_code ignored;
+        std::filesystem::remove_all(path, ignored);
+    }
+
+    std::filesystem::path path;
+};
+
+inline std::string read_file(const std::filesystem::path& file) {
+    std::ifstream stream(file, std::ios::binary);
+    return {std::istreambuf_iterator<char>(stream), std::istreambuf_iterator<char>()};
+}
+
+inline void write_file(const std::filesystem::path& file, const std::string& contents) {
+    std::ofstream stream(file, std::ios::binary | std::ios::trunc);
+    stream << contents;
+}
+
+} // namespace test
+
+#define TEST_CASE(name)                                       \
+    static void name();                                       \
+    static const test::Register name##_register(#name, name); \
+    static void name()
+
+#define CHECK(expr)                                                                    \
+    do {                                                                               \
+        if (!(expr)) {                                                                 \
+            std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #expr); \
+            ++test::failures;                                                          \
+        }                                                                              \
+    } while (0)
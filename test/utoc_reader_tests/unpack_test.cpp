@@ -0,0 +1,108 @@
+#include "test_support.h"
+
+#include <utoc_reader.h>
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace utoc;
+
+namespace {
+    std::vector<FIoOffsetAndLength> random_offset_lengths(size_t count, uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        std::vector<FIoOffsetAndLength> records(count);
+        for (auto& record : records) {
+            for (auto& byte : record.data) {
+                byte = static_cast<uint8_t>(rng());
+            }
+        }
+        return records;
+    }
+
+    std::vector<FIoStoreTocCompressedBlockEntry> random_blocks(size_t count, uint64_t seed) {
+        std::mt19937_64 rng(seed);
+        std::vector<FIoStoreTocCompressedBlockEntry> records(count);
+        for (auto& record : records) {
+            for (auto& byte : record.data) {
+                byte = static_cast<uint8_t>(rng());
+            }
+        }
+        return records;
+    }
+}
+
+TEST_CASE(offset_and_length_fields_are_big_endian) {
+    FIoOffsetAndLength record;
+    const uint8_t bytes[10] = {0x01, 0x02, 0x03, 0x04, 0x05, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe};
+    std::memcpy(record.data, bytes, sizeof(bytes));
+    CHECK(record.GetOffset() == 0x0102030405ULL);
+    CHECK(record.GetLength() == 0xfafbfcfdfeULL);
+}
+
+TEST_CASE(compressed_block_fields_are_little_endian) {
+    FIoStoreTocCompressedBlockEntry record;
+    const uint8_t bytes[12] = {0x01, 0x02, 0x03, 0x04, 0xf5, 0x10, 0x20, 0xf0, 0x30, 0x40, 0xe0, 0x02};
+    std::memcpy(record.data, bytes, sizeof(bytes));
+    CHECK(record.GetOffset() == 0xf504030201ULL);
+    CHECK(record.GetCompressedSize() == 0xf02010u);
+    CHECK(record.GetUncompressedSize() == 0xe04030u);
+    CHECK(record.GetCompressionMethodIndex() == 2);
+}
+
+TEST_CASE(unpack_offset_and_lengths_matches_getters) {
+    // Every count up to a few pairs past the last full 16-byte load, so the
+    // scalar tail is covered on both sides of the SIMD loop
+    for (size_t count = 0; count <= 9; ++count) {
+        auto records = random_offset_lengths(count, count + 1);
+        std::vector<uint64_t> offsets(count, ~0ULL);
+        std::vector<uint64_t> lengths(count, ~0ULL);
+        UnpackOffsetAndLengths(records, offsets.data(), lengths.data());
+        for (size_t i = 0; i < count; ++i) {
+            CHECK(offsets[i] == records[i].GetOffset());
+            CHECK(lengths[i] == records[i].GetLength());
+            CHECK(offsets[i] < (1ULL << 40) && lengths[i] < (1ULL << 40));
+        }
+    }
+
+    auto records = random_offset_lengths(1001, 100);
+    std::vector<uint64_t> offsets(records.size());
+    std::vector<uint64_t> lengths(records.size());
+    UnpackOffsetAndLengths(records, offsets.data(), lengths.data());
+    for (size_t i = 0; i < records.size(); ++i) {
+        CHECK(offsets[i] == records[i].GetOffset());
+        CHECK(lengths[i] == records[i].GetLength());
+    }
+}
+
+TEST_CASE(unpack_compressed_blocks_matches_getters) {
+    for (size_t count = 0; count <= 9; ++count) {
+        auto records = random_blocks(count, count + 1);
+        std::vector<uint64_t> offsets(count, ~0ULL);
+        std::vector<uint32_t> compressed(count, ~0u);
+        std::vector<uint32_t> uncompressed(count, ~0u);
+        std::vector<uint8_t> methods(count);
+        UnpackCompressedBlocks(records, offsets.data(), compressed.data(), uncompressed.data(), methods.data());
+        for (size_t i = 0; i < count; ++i) {
+            CHECK(offsets[i] == records[i].GetOffset());
+            CHECK(compressed[i] == records[i].GetCompressedSize());
+            CHECK(uncompressed[i] == records[i].GetUncompressedSize());
+            CHECK(methods[i] == records[i].GetCompressionMethodIndex());
+            CHECK(offsets[i] < (1ULL << 40) && compressed[i] < (1u << 24) && uncompressed[i] < (1u << 24));
+        }
+    }
+
+    auto records = random_blocks(1001, 200);
+    std::vector<uint64_t> offsets(records.size());
+    std::vector<uint32_t> compressed(records.size());
+    std::vector<uint32_t> uncompressed(records.size());
+    std::vector<uint8_t> methods(records.size());
+    UnpackCompressedBlocks(records, offsets.data(), compressed.data(), uncompressed.data(), methods.data());
+    for (size_t i = 0; i < records.size(); ++i) {
+        CHECK(offsets[i] == records[i].GetOffset());
+        CHECK(compressed[i] == records[i].GetCompressedSize());
+        CHECK(uncompressed[i] == records[i].GetUncompressedSize());
+        CHECK(methods[i] == records[i].GetCompressionMethodIndex());
+    }
+}
@@ -0,0 +1,7 @@
+target("utoc_reader_tests")
+    set_kind("binary")
+    set_default(false)
+    add_files("*.cpp")
+    add_includedirs("..")
+    add_deps("utoc_reader_prototype")
+    add_tests("default")
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace file_formats::city_hash {
+
+// CityHash64 (v1.1), the hash Unreal uses for package ids and other
+// 64-bit name hashes
+uint64_t hash64(const uint8_t* data, size_t size);
+
+} // namespace file_formats::city_hash
@@ -0,0 +1,17 @@
+#pragma once
+
+namespace file_formats {
+
+// Instruction sets the SIMD kernels can use. All false on other CPUs.
+struct CpuFeatures {
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool avx2 = false;   // also checks that the OS saves the YMM registers
+    bool avx512 = false; // AVX-512F, also checks that the OS saves the ZMM registers
+    bool sha = false;    // SHA extensions, with the SSSE3 and SSE4.1 they're used with
+};
+
+// Features of the CPU we're running on, detected on first call
+const CpuFeatures& cpu_features();
+
+} // namespace file_formats
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "prefetch.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(__SSE2__)
+#define FILE_FORMATS_FLAT_MAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace file_formats {
+
+// Flat open-addressing map from a 64-bit path hash to a small value (an
+// entry index, say), laid out like a SwissTable. Every slot has a control
+// byte holding 7 bits of its hash (or an empty marker); a lookup compares
+// 16 control bytes at once with SSE2 and only touches the slots whose bits
+// match. Slots are indexed by the top bits of the hash, so inserting keys
+// in hash order fills the table front to back.
+//
+// Distinct paths can share a hash, so lookups take a predicate that checks
+// the candidate's path.
+template <typename Value>
+class FlatPathMap {
+public:
+    FlatPathMap() = default;
+
+    // Build from hashes sorted in ascending order and their values
+    static FlatPathMap build(std::span<const uint64_t> sorted_hashes, std::span<const Value> values) {
+        FlatPathMap map;
+        map.reserve_groups(groups_for(sorted_hashes.size()));
+
+        // Keys arrive in group order, so this walks the table once, front to back
+        for (size_t i = 0; i < sorted_hashes.size(); ++i) {
+            map.place(sorted_hashes[i], values[i]);
+        }
+        map.size_ = sorted_hashes.size();
+        return map;
+    }
+
+    // Make room for `count` keys in total without growing again
+    void reserve(size_t count) {
+        if (groups_for(count) > group_count() || slots_.empty()) {
+            rehash(groups_for(std::max(count, size_)));
+        }
+    }
+
+    void insert(uint64_t hash, Value value) {
+        if (slots_.empty() || (size_ + 1) * 8 > slots_.size() * 7) {
+            rehash(groups_for(std::max<size_t>(size_ + 1, size_ * 2)));
+        }
+        place(hash, value);
+        ++size_;
+    }
+
+    // First value with this hash for which matches(value) is true
+    template <typename Pred>
+    std::optional<Value> find(uint64_t hash, Pred&& matches) const {
+        if (slots_.empty()) {
+            return std::nullopt;
+        }
+        const uint8_t tag = tag_of(hash);
+        for (size_t group = group_of(hash), probes = 0; probes < group_count(); group = (group + 1) & group_mask_, ++probes) {
+            const size_t base = group * GROUP_WIDTH;
+            for (uint32_t bits = match(base, tag); bits != 0; bits &= bits - 1) {
+                const Slot& slot = slots_[base + static_cast<size_t>(std::countr_zero(bits))];
+                if (slot.hash == hash && matches(slot.value)) {
+                    return slot.value;
+                }
+            }
+            if (match_empty(base) != 0) {
+                break;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Hint that `hash` will be looked up soon: fetch its home group's
+    // control bytes and the start of its slots. Batch lookups call this a
+    // few keys ahead so their cache misses overlap.
+    void prefetch(uint64_t hash) const {
+        if (slots_.empty()) {
+            return;
+        }
+        const size_t base = group_of(hash) * GROUP_WIDTH;
+        file_formats::prefetch(control_.data() + base);
+        file_formats::prefetch(slots_.data() + base);
+    }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t capacity() const { return slots_.size(); }
+
+    // Heap usage in bytes
+    size_t memory_usage() const { return control_.capacity() + slots_.capacity() * sizeof(Slot); }
+
+private:
+    static constexpr size_t GROUP_WIDTH = 16;
+    static constexpr uint8_t EMPTY = 0x80;
+
+    struct Slot {
+        uint64_t hash;
+        Value value;
+    };
+
+    // Tables are kept at most 7/8 full, so probe sequences stay short
+    static size_t groups_for(size_t count) {
+        size_t slots = count + count / 7 + 1;
+        return std::bit_ceil((slots + GROUP_WIDTH - 1) / GROUP_WIDTH);
+    }
+
+    // Low 7 bits pick the control byte; the top bits pick the group
+    static uint8_t tag_of(uint64_t hash) { return static_cast<uint8_t>(hash & 0x7f); }
+    size_t group_of(uint64_t hash) const { return group_shift_ == 64 ? 0 : static_cast<size_t>(hash >> group_shift_); }
+    size_t group_count() const { return group_mask_ + 1; }
+
+    // Bit i is set when control byte i of the group equals the tag
+    uint32_t match(size_t base, uint8_t tag) const {
+#ifdef FILE_FORMATS_FLAT_MAP_SSE2
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control_.data() + base));
+        return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(static_cast<char>(tag)))));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+            bits |= static_cast<uint32_t>(control_[base + i] == tag) << i;
+        }
+        return bits;
+#endif
+    }
+
+    // Bit i is set when slot i of the group is empty. Tags are 7-bit, so the
+    // empty marker is the only control byte with its top bit set.
+    uint32_t match_empty(size_t base) const {
+#ifdef FILE_FORMATS_FLAT_MAP_SSE2
+        __m128i group = _mm_loadu_si128(reinterpret_cast<const __m128i*>(control_.data() + base));
+        return static_cast<uint32_t>(_mm_movemask_epi8(group));
+#else
+        uint32_t bits = 0;
+        for (size_t i = 0; i < GROUP_WIDTH; ++i) {
+            bits |= static_cast<uint32_t>(control_[base + i] >> 7) << i;
+        }
+        return bits;
+#endif
+    }
+
+    void reserve_groups(size_t count) {
+        control_.assign(count * GROUP_WIDTH, EMPTY);
+        slots_.assign(count * GROUP_WIDTH, Slot{});
+        group_mask_ = count - 1;
+        group_shift_ = 64 - std::countr_zero(count);
+    }
+
+    // Resize to `count` groups and put the current slots back in
+    void rehash(size_t count) {
+        std::vector<uint8_t> control = std::move(control_);
+        std::vector<Slot> slots = std::move(slots_);
+        reserve_groups(count);
+        for (size_t i = 0; i < slots.size(); ++i) {
+            if (control[i] != EMPTY) {
+                place(slots[i].hash, slots[i].value);
+            }
+        }
+    }
+
+    void place(uint64_t hash, Value value) {
+        for (size_t group = group_of(hash);; group = (group + 1) & group_mask_) {
+            const size_t base = group * GROUP_WIDTH;
+            uint32_t empty = match_empty(base);
+            if (empty != 0) {
+                size_t index = base + static_cast<size_t>(std::countr_zero(empty));
+                control_[index] = tag_of(hash);
+                slots_[index] = {hash, value};
+                return;
+            }
+        }
+    }
+
+    std::vector<uint8_t> control_;
+    std::vector<Slot> slots_;
+    size_t group_mask_ = 0;
+    int group_shift_ = 64;
+    size_t size_ = 0;
+};
+
+} // namespace file_formats
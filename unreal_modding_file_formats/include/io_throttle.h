@@ -0,0 +1,101 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace file_formats {
+
+// Who a read is for, most urgent first. Interactive reads are the ones a
+// user is waiting on; background reads belong to whole-library jobs such as
+// verify or repack.
+enum class IoClass : uint8_t {
+    Interactive,
+    Normal,
+    Background,
+};
+
+constexpr size_t IO_CLASS_COUNT = 3;
+
+// Bandwidth limit of one class
+struct IoLimit {
+    uint64_t bytes_per_second = 0;         // 0 for no limit
+    uint64_t burst_bytes = 4 * 1024 * 1024; // how much may be read at once after a pause
+    bool idle_only = false;                 // wait while interactive reads are in flight
+};
+
+// Token-bucket limiter shared by every archive reader, so limits hold across
+// all the paks and containers a job touches. Readers ask for permission
+// before each bulk read; the class of the read comes from the calling
+// thread (see IoClassScope).
+class IoThrottle {
+public:
+    // Permission for one read. Interactive reads count as in flight until
+    // their ticket is destroyed, which is what idle-only classes wait on.
+    class Ticket {
+    public:
+        Ticket() = default;
+        ~Ticket();
+
+        Ticket(Ticket&& other) noexcept;
+        Ticket& operator=(Ticket&& other) noexcept;
+
+    private:
+        friend class IoThrottle;
+
+        explicit Ticket(IoThrottle* foreground) : foreground_(foreground) {}
+
+        IoThrottle* foreground_ = nullptr; // set while holding an interactive read
+    };
+
+    // The limiter used by the pak and utoc readers
+    static IoThrottle& global();
+
+    void set_limit(IoClass io_class, IoLimit limit);
+    IoLimit limit(IoClass io_class) const;
+
+    // Block until `bytes` may be read at the calling thread's class
+    [[nodiscard]] Ticket acquire(uint64_t bytes);
+
+    // Block until `bytes` may be read at the given class
+    [[nodiscard]] Ticket acquire(IoClass io_class, uint64_t bytes);
+
+    // Number of interactive reads in flight
+    size_t foreground_pending() const;
+
+private:
+    struct Bucket {
+        IoLimit limit;
+        double tokens = 0.0; // bytes; negative while in debt for a large read
+        std::chrono::steady_clock::time_point refilled;
+    };
+
+    void end_foreground();
+
+    mutable std::mutex mutex_;
+    std::condition_variable foreground_idle_;
+    std::array<Bucket, IO_CLASS_COUNT> buckets_{};
+    size_t foreground_pending_ = 0;
+};
+
+// The I/O class of reads made by the current thread; Interactive unless a
+// scope says otherwise
+IoClass current_io_class();
+
+// Sets the I/O class of the current thread for the lifetime of the scope
+class IoClassScope {
+public:
+    explicit IoClassScope(IoClass io_class);
+    ~IoClassScope();
+
+    IoClassScope(const IoClassScope&) = delete;
+    IoClassScope& operator=(const IoClassScope&) = delete;
+
+private:
+    IoClass previous_;
+};
+
+} // namespace file_formats
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace file_formats::package_id {
+
+// FPackageId::InvalidId
+constexpr uint64_t INVALID = 0;
+
+// The package name of a packaged asset path, the form FPackageId is
+// computed from: "../../../MyGame/Content/Maps/Foo.umap" is "/Game/Maps/Foo",
+// ".../Engine/Content/X.uasset" is "/Engine/X" and plugin content
+// ".../Plugins/Bar/Content/X.uasset" is "/Bar/X". Returns nullopt for
+// paths that are not under a Content directory.
+std::optional<std::string> package_name_from_path(std::string_view path);
+
+// FPackageId of a package name: CityHash64 of the lowercased UTF-16 name
+uint64_t from_name(std::string_view package_name);
+
+// FPackageId of many package names. Names are lowercased and widened to
+// UTF-16 16 characters at a time into one reused buffer, so a batch costs
+// little more than the hashing itself. `out` must be as long as `names`.
+void from_names(std::span<const std::string_view> names, std::span<uint64_t> out);
+
+} // namespace file_formats::package_id
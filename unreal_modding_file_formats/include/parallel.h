@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace file_formats {
+
+// Number of threads parallel passes use: one per hardware thread
+inline size_t worker_count() {
+    size_t count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+// Run fn(i) for every i in [0, count) on a pool of short-lived threads.
+// Indices are handed out one at a time, so uneven items balance out. The
+// first exception thrown by fn is rethrown on the calling thread.
+template <typename Fn>
+void parallel_for(size_t count, Fn&& fn) {
+    size_t threads = std::min(worker_count(), count);
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&]() {
+        for (size_t i = next.fetch_add(1); i < count; i = next.fetch_add(1)) {
+            try {
+                fn(i);
+            } catch (...) {
+                std::lock_guard lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next.store(count);
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; ++t) {
+        pool.emplace_back(work);
+    }
+    work();
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+} // namespace file_formats
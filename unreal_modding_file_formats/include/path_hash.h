@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+namespace file_formats {
+
+// Hash of a path for lookup tables (FNV-1a, 64-bit). The readers hash paths
+// as stored in the archive; the core hashes normalized paths.
+inline uint64_t hash_path(std::string_view path) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : path) {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+} // namespace file_formats
@@ -0,0 +1,19 @@
+#pragma once
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+namespace file_formats {
+
+// Hint that memory will be read soon. Batch lookups issue these a few keys
+// ahead so the cache misses of different keys overlap.
+inline void prefetch(const void* address) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    __builtin_prefetch(address);
+#endif
+}
+
+} // namespace file_formats
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace file_formats::sha1 {
+
+// A SHA1 digest, as stored in pak entries and footers
+using Digest = std::array<uint8_t, 20>;
+
+// Kernels that can be used to hash a batch of buffers
+enum class Backend {
+    Scalar, // one buffer at a time, portable C++
+    ShaNi,  // one buffer at a time, SHA extensions
+    Sse2,   // 4 buffers at once
+    Avx2,   // 8 buffers at once
+    Avx512  // 16 buffers at once
+};
+
+// One independent buffer to hash as part of a batch
+struct Job {
+    const uint8_t* data;
+    size_t size;
+    Digest* out;
+};
+
+// Hash a single buffer, using SHA-NI when the CPU has it
+Digest hash(const uint8_t* data, size_t size);
+
+// Hash a batch of independent buffers. Buffers are grouped by size so each
+// group fills every SIMD lane with similar amounts of work; large buffers
+// go through the single-stream kernel instead when SHA-NI is available.
+void hash_many(std::span<Job> jobs);
+
+// Same as above, but forces a specific multi-buffer kernel
+void hash_many(std::span<Job> jobs, Backend backend);
+
+// The widest multi-buffer kernel the CPU and OS support
+Backend best_backend();
+
+// Whether the CPU supports the SHA extensions
+bool has_sha_ni();
+
+// Number of buffers a kernel hashes at once
+size_t lane_count(Backend backend);
+
+} // namespace file_formats::sha1
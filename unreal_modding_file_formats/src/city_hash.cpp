@@ -0,0 +1,157 @@
+#include "city_hash.h"
+
+#include <cstring>
+#include <utility>
+
+namespace file_formats::city_hash {
+
+namespace {
+    constexpr uint64_t K0 = 0xc3a5c85c97cb3127ULL;
+    constexpr uint64_t K1 = 0xb492b66fbe98f273ULL;
+    constexpr uint64_t K2 = 0x9ae16a3b2f90404fULL;
+
+    uint64_t fetch64(const uint8_t* p) {
+        uint64_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint32_t fetch32(const uint8_t* p) {
+        uint32_t value;
+        std::memcpy(&value, p, sizeof(value));
+        return value;
+    }
+
+    uint64_t byte_swap(uint64_t value) {
+        value = ((value & 0x00000000FFFFFFFFULL) << 32) | ((value & 0xFFFFFFFF00000000ULL) >> 32);
+        value = ((value & 0x0000FFFF0000FFFFULL) << 16) | ((value & 0xFFFF0000FFFF0000ULL) >> 16);
+        value = ((value & 0x00FF00FF00FF00FFULL) << 8) | ((value & 0xFF00FF00FF00FF00ULL) >> 8);
+        return value;
+    }
+
+    uint64_t rotate(uint64_t value, int shift) {
+        return shift == 0 ? value : ((value >> shift) | (value << (64 - shift)));
+    }
+
+    uint64_t shift_mix(uint64_t value) {
+        return value ^ (value >> 47);
+    }
+
+    uint64_t hash_len16(uint64_t u, uint64_t v, uint64_t mul) {
+        uint64_t a = (u ^ v) * mul;
+        a ^= (a >> 47);
+        uint64_t b = (v ^ a) * mul;
+        b ^= (b >> 47);
+        b *= mul;
+        return b;
+    }
+
+    uint64_t hash_len16(uint64_t u, uint64_t v) {
+        return hash_len16(u, v, 0x9ddfea08eb382d69ULL);
+    }
+
+    uint64_t hash_len0to16(const uint8_t* s, size_t len) {
+        if (len >= 8) {
+            uint64_t mul = K2 + len * 2;
+            uint64_t a = fetch64(s) + K2;
+            uint64_t b = fetch64(s + len - 8);
+            uint64_t c = rotate(b, 37) * mul + a;
+            uint64_t d = (rotate(a, 25) + b) * mul;
+            return hash_len16(c, d, mul);
+        }
+        if (len >= 4) {
+            uint64_t mul = K2 + len * 2;
+            uint64_t a = fetch32(s);
+            return hash_len16(len + (a << 3), fetch32(s + len - 4), mul);
+        }
+        if (len > 0) {
+            uint8_t a = s[0];
+            uint8_t b = s[len >> 1];
+            uint8_t c = s[len - 1];
+            uint32_t y = static_cast<uint32_t>(a) + (static_cast<uint32_t>(b) << 8);
+            uint32_t z = static_cast<uint32_t>(len) + (static_cast<uint32_t>(c) << 2);
+            return shift_mix(y * K2 ^ z * K0) * K2;
+        }
+        return K2;
+    }
+
+    uint64_t hash_len17to32(const uint8_t* s, size_t len) {
+        uint64_t mul = K2 + len * 2;
+        uint64_t a = fetch64(s) * K1;
+        uint64_t b = fetch64(s + 8);
+        uint64_t c = fetch64(s + len - 8) * mul;
+        uint64_t d = fetch64(s + len - 16) * K2;
+        return hash_len16(rotate(a + b, 43) + rotate(c, 30) + d, a + rotate(b + K2, 18) + c, mul);
+    }
+
+    std::pair<uint64_t, uint64_t> weak_hash_len32_with_seeds(uint64_t w, uint64_t x, uint64_t y, uint64_t z, uint64_t a, uint64_t b) {
+        a += w;
+        b = rotate(b + a + z, 21);
+        uint64_t c = a;
+        a += x;
+        a += y;
+        b += rotate(a, 44);
+        return {a + z, b + c};
+    }
+
+    std::pair<uint64_t, uint64_t> weak_hash_len32_with_seeds(const uint8_t* s, uint64_t a, uint64_t b) {
+        return weak_hash_len32_with_seeds(fetch64(s), fetch64(s + 8), fetch64(s + 16), fetch64(s + 24), a, b);
+    }
+
+    uint64_t hash_len33to64(const uint8_t* s, size_t len) {
+        uint64_t mul = K2 + len * 2;
+        uint64_t a = fetch64(s) * K2;
+        uint64_t b = fetch64(s + 8);
+        uint64_t c = fetch64(s + len - 24);
+        uint64_t d = fetch64(s + len - 32);
+        uint64_t e = fetch64(s + 16) * K2;
+        uint64_t f = fetch64(s + 24) * 9;
+        uint64_t g = fetch64(s + len - 8);
+        uint64_t h = fetch64(s + len - 16) * mul;
+        uint64_t u = rotate(a + g, 43) + (rotate(b, 30) + c) * 9;
+        uint64_t v = ((a + g) ^ d) + f + 1;
+        uint64_t w = byte_swap((u + v) * mul) + h;
+        uint64_t x = rotate(e + f, 42) + c;
+        uint64_t y = (byte_swap((v + w) * mul) + g) * mul;
+        uint64_t z = e + f + c;
+        a = byte_swap((x + z) * mul + y) + b;
+        b = shift_mix((z + a) * mul + d + h) * mul;
+        return b + x;
+    }
+}
+
+uint64_t hash64(const uint8_t* s, size_t len) {
+    if (len <= 32) {
+        return len <= 16 ? hash_len0to16(s, len) : hash_len17to32(s, len);
+    }
+    if (len <= 64) {
+        return hash_len33to64(s, len);
+    }
+
+    // For longer strings, keep 56 bytes of state: v, w, x, y and z
+    uint64_t x = fetch64(s + len - 40);
+    uint64_t y = fetch64(s + len - 16) + fetch64(s + len - 56);
+    uint64_t z = hash_len16(fetch64(s + len - 48) + len, fetch64(s + len - 24));
+    auto v = weak_hash_len32_with_seeds(s + len - 64, len, z);
+    auto w = weak_hash_len32_with_seeds(s + len - 32, y + K1, x);
+    x = x * K1 + fetch64(s);
+
+    // Loop over 64-byte chunks, ending with the last whole chunk before the tail
+    len = (len - 1) & ~static_cast<size_t>(63);
+    do {
+        x = rotate(x + y + v.first + fetch64(s + 8), 37) * K1;
+        y = rotate(y + v.second + fetch64(s + 48), 42) * K1;
+        x ^= w.second;
+        y += v.first + fetch64(s + 40);
+        z = rotate(z + w.first, 33) * K1;
+        v = weak_hash_len32_with_seeds(s, v.second * K1, x + w.first);
+        w = weak_hash_len32_with_seeds(s + 32, z + w.second, y + fetch64(s + 16));
+        std::swap(z, x);
+        s += 64;
+        len -= 64;
+    } while (len != 0);
+
+    return hash_len16(hash_len16(v.first, w.first) + shift_mix(y) * K1 + z, hash_len16(v.second, w.second) + x);
+}
+
+} // namespace file_formats::city_hash
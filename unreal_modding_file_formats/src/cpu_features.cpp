@@ -0,0 +1,81 @@
+#include "cpu_features.h"
+
+#include <cstdint>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FILE_FORMATS_CPUID 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace file_formats {
+
+namespace {
+#ifdef FILE_FORMATS_CPUID
+    void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4]) {
+#ifdef _MSC_VER
+        int values[4];
+        __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+        for (int i = 0; i < 4; ++i) {
+            regs[i] = static_cast<uint32_t>(values[i]);
+        }
+#else
+        __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    }
+
+    uint64_t xgetbv0() {
+#ifdef _MSC_VER
+        return _xgetbv(0);
+#else
+        uint32_t low, high;
+        __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+        return (static_cast<uint64_t>(high) << 32) | low;
+#endif
+    }
+
+    CpuFeatures detect_features() {
+        CpuFeatures features;
+        uint32_t regs[4];
+
+        cpuid(0, 0, regs);
+        uint32_t max_leaf = regs[0];
+        if (max_leaf < 1) {
+            return features;
+        }
+
+        cpuid(1, 0, regs);
+        features.ssse3 = (regs[2] & (1u << 9)) != 0;
+        features.sse41 = (regs[2] & (1u << 19)) != 0;
+        bool osxsave = (regs[2] & (1u << 27)) != 0;
+        if (max_leaf < 7) {
+            return features;
+        }
+
+        // The OS has to save the wider registers across context switches
+        uint64_t xcr0 = osxsave ? xgetbv0() : 0;
+        bool ymm_enabled = (xcr0 & 0x6) == 0x6;
+        bool zmm_enabled = (xcr0 & 0xE6) == 0xE6;
+
+        cpuid(7, 0, regs);
+        features.avx2 = ymm_enabled && (regs[1] & (1u << 5)) != 0;
+        features.avx512 = zmm_enabled && (regs[1] & (1u << 16)) != 0;
+        features.sha = features.ssse3 && features.sse41 && (regs[1] & (1u << 29)) != 0;
+        return features;
+    }
+#else
+    CpuFeatures detect_features() {
+        return {};
+    }
+#endif
+} // namespace
+
+const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect_features();
+    return features;
+}
+
+} // namespace file_formats
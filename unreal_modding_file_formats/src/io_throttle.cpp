@@ -0,0 +1,121 @@
+#include "io_throttle.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+
+namespace file_formats {
+
+namespace {
+    thread_local IoClass thread_io_class = IoClass::Interactive;
+}
+
+IoThrottle::Ticket::~Ticket() {
+    if (foreground_ != nullptr) {
+        foreground_->end_foreground();
+    }
+}
+
+IoThrottle::Ticket::Ticket(Ticket&& other) noexcept
+    : foreground_(std::exchange(other.foreground_, nullptr)) {}
+
+IoThrottle::Ticket& IoThrottle::Ticket::operator=(Ticket&& other) noexcept {
+    if (this != &other) {
+        if (foreground_ != nullptr) {
+            foreground_->end_foreground();
+        }
+        foreground_ = std::exchange(other.foreground_, nullptr);
+    }
+    return *this;
+}
+
+IoThrottle& IoThrottle::global() {
+    static IoThrottle throttle;
+    return throttle;
+}
+
+void IoThrottle::set_limit(IoClass io_class, IoLimit limit) {
+    std::lock_guard lock(mutex_);
+    Bucket& bucket = buckets_[static_cast<size_t>(io_class)];
+    bucket.limit = limit;
+    bucket.tokens = static_cast<double>(limit.burst_bytes);
+    bucket.refilled = std::chrono::steady_clock::now();
+}
+
+IoLimit IoThrottle::limit(IoClass io_class) const {
+    std::lock_guard lock(mutex_);
+    return buckets_[static_cast<size_t>(io_class)].limit;
+}
+
+IoThrottle::Ticket IoThrottle::acquire(uint64_t bytes) {
+    return acquire(current_io_class(), bytes);
+}
+
+IoThrottle::Ticket IoThrottle::acquire(IoClass io_class, uint64_t bytes) {
+    std::unique_lock lock(mutex_);
+    Bucket& bucket = buckets_[static_cast<size_t>(io_class)];
+
+    // Idle-only classes back off until the interactive reads are done
+    if (bucket.limit.idle_only) {
+        foreground_idle_.wait(lock, [&]() { return foreground_pending_ == 0; });
+    }
+
+    std::chrono::nanoseconds wait{0};
+    const uint64_t rate = bucket.limit.bytes_per_second;
+    if (rate != 0) {
+        // Refill for the time since the last read, then take the bytes. A
+        // read larger than the bucket leaves it in debt instead of never
+        // fitting, and the reader sleeps the debt off.
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - bucket.refilled).count();
+        bucket.refilled = now;
+        bucket.tokens = std::min(bucket.tokens + elapsed * static_cast<double>(rate),
+                                 static_cast<double>(bucket.limit.burst_bytes));
+        bucket.tokens -= static_cast<double>(bytes);
+        if (bucket.tokens < 0) {
+            wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::duration<double>(-bucket.tokens / static_cast<double>(rate)));
+        }
+    }
+
+    Ticket ticket;
+    if (io_class == IoClass::Interactive) {
+        ++foreground_pending_;
+        ticket = Ticket(this);
+    }
+    lock.unlock();
+
+    if (wait > std::chrono::nanoseconds::zero()) {
+        std::this_thread::sleep_for(wait);
+    }
+    return ticket;
+}
+
+size_t IoThrottle::foreground_pending() const {
+    std::lock_guard lock(mutex_);
+    return foreground_pending_;
+}
+
+void IoThrottle::end_foreground() {
+    bool idle = false;
+    {
+        std::lock_guard lock(mutex_);
+        idle = --foreground_pending_ == 0;
+    }
+    if (idle) {
+        foreground_idle_.notify_all();
+    }
+}
+
+IoClass current_io_class() {
+    return thread_io_class;
+}
+
+IoClassScope::IoClassScope(IoClass io_class)
+    : previous_(std::exchange(thread_io_class, io_class)) {}
+
+IoClassScope::~IoClassScope() {
+    thread_io_class = previous_;
+}
+
+} // namespace file_formats
@@ -0,0 +1,137 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace file_formats {
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        close();
+        data_ = std::exchange(other.data_, nullptr);
+        size_ = std::exchange(other.size_, 0);
+        open_ = std::exchange(other.open_, false);
+#ifdef _WIN32
+        file_ = std::exchange(other.file_, nullptr);
+        mapping_ = std::exchange(other.mapping_, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+
+    // Empty files can't be mapped but are valid
+    file_ = file;
+    open_ = true;
+    if (size.QuadPart == 0) {
+        return true;
+    }
+
+    mapping_ = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ == nullptr) {
+        close();
+        return false;
+    }
+    data_ = static_cast<const uint8_t*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    if (data_ == nullptr) {
+        close();
+        return false;
+    }
+    size_ = static_cast<size_t>(size.QuadPart);
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr) {
+        UnmapViewOfFile(data_);
+    }
+    if (mapping_ != nullptr) {
+        CloseHandle(mapping_);
+    }
+    if (file_ != nullptr) {
+        CloseHandle(file_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+    file_ = nullptr;
+    mapping_ = nullptr;
+}
+
+#else
+
+bool MappedFile::open(const std::filesystem::path& path) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+
+    // Empty files can't be mapped but are valid
+    if (info.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        if (data == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        data_ = static_cast<const uint8_t*>(data);
+        size_ = static_cast<size_t>(info.st_size);
+    }
+
+    // The mapping keeps the file alive on its own
+    ::close(fd);
+    open_ = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ != nullptr) {
+        munmap(const_cast<uint8_t*>(data_), size_);
+    }
+    data_ = nullptr;
+    size_ = 0;
+    open_ = false;
+}
+
+#endif
+
+} // namespace file_formats
@@ -0,0 +1,151 @@
+#include "package_id.h"
+#include "city_hash.h"
+
+#include <cwctype>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FILE_FORMATS_PACKAGE_ID_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace file_formats::package_id {
+
+namespace {
+    // Directory that holds a mount point's packages
+    constexpr std::string_view CONTENT_DIRECTORY = "/Content/";
+
+    char16_t to_lower(char16_t c) {
+        if (c < 0x80) {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char16_t>(c + ('a' - 'A')) : c;
+        }
+        return static_cast<char16_t>(std::towlower(c));
+    }
+
+    // Decode one UTF-8 sequence at `name[i]` into UTF-16, lowercased, and
+    // advance `i`. Invalid bytes are taken as Latin-1.
+    void append_utf8(std::string_view name, size_t& i, std::vector<char16_t>& out) {
+        auto byte = [&name](size_t at) { return static_cast<uint8_t>(name[at]); };
+        auto continuation = [&](size_t at) { return at < name.size() && (byte(at) & 0xC0) == 0x80; };
+
+        uint32_t lead = byte(i);
+        uint32_t code_point = lead;
+        size_t length = 1;
+        if ((lead & 0xE0) == 0xC0 && continuation(i + 1)) {
+            code_point = ((lead & 0x1F) << 6) | (byte(i + 1) & 0x3F);
+            length = 2;
+        } else if ((lead & 0xF0) == 0xE0 && continuation(i + 1) && continuation(i + 2)) {
+            code_point = ((lead & 0x0F) << 12) | ((byte(i + 1) & 0x3F) << 6) | (byte(i + 2) & 0x3F);
+            length = 3;
+        } else if ((lead & 0xF8) == 0xF0 && continuation(i + 1) && continuation(i + 2) && continuation(i + 3)) {
+            code_point = ((lead & 0x07) << 18) | ((byte(i + 1) & 0x3F) << 12) | ((byte(i + 2) & 0x3F) << 6) | (byte(i + 3) & 0x3F);
+            length = 4;
+        }
+        i += length;
+
+        if (code_point >= 0x10000) {
+            code_point -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (code_point >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (code_point & 0x3FF)));
+        } else {
+            out.push_back(to_lower(static_cast<char16_t>(code_point)));
+        }
+    }
+
+    // Lowercase and widen a name into `out`, replacing its contents
+    void widen_lower(std::string_view name, std::vector<char16_t>& out) {
+        out.resize(name.size());
+        size_t i = 0;
+#ifdef FILE_FORMATS_PACKAGE_ID_SSE2
+        // ASCII runs, 16 characters per step: add 0x20 to bytes in 'A'..'Z'
+        // and interleave with zeros to get UTF-16
+        const __m128i before_a = _mm_set1_epi8('A' - 1);
+        const __m128i after_z = _mm_set1_epi8('Z' + 1);
+        const __m128i case_bit = _mm_set1_epi8(0x20);
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 16 <= name.size(); i += 16) {
+            __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(name.data() + i));
+            if (_mm_movemask_epi8(bytes) != 0) {
+                break;
+            }
+            __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(bytes, before_a), _mm_cmplt_epi8(bytes, after_z));
+            bytes = _mm_add_epi8(bytes, _mm_and_si128(upper, case_bit));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out.data() + i), _mm_unpacklo_epi8(bytes, zero));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out.data() + i + 8), _mm_unpackhi_epi8(bytes, zero));
+        }
+#endif
+        size_t written = i;
+        for (; i < name.size() && static_cast<uint8_t>(name[i]) < 0x80; ++i) {
+            out[written++] = to_lower(static_cast<char16_t>(name[i]));
+        }
+        if (i == name.size()) {
+            out.resize(written);
+            return;
+        }
+
+        // Non-ASCII names take the slow path from here on
+        out.resize(written);
+        while (i < name.size()) {
+            append_utf8(name, i, out);
+        }
+    }
+
+    uint64_t hash_utf16(const std::vector<char16_t>& name) {
+        return city_hash::hash64(reinterpret_cast<const uint8_t*>(name.data()), name.size() * sizeof(char16_t));
+    }
+}
+
+std::optional<std::string> package_name_from_path(std::string_view path) {
+    while (path.starts_with("../")) {
+        path.remove_prefix(3);
+    }
+    while (path.starts_with('/')) {
+        path.remove_prefix(1);
+    }
+
+    size_t content = path.find(CONTENT_DIRECTORY);
+    if (content == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    // The directory that owns the Content folder names the mount point: the
+    // project itself maps to /Game, anything deeper is a plugin
+    std::string_view owner = path.substr(0, content);
+    std::string_view mount;
+    size_t slash = owner.rfind('/');
+    if (slash == std::string_view::npos) {
+        mount = owner == "Engine" ? "Engine" : "Game";
+    } else {
+        mount = owner.substr(slash + 1);
+    }
+
+    std::string_view relative = path.substr(content + CONTENT_DIRECTORY.size());
+    size_t dot = relative.rfind('.');
+    if (dot != std::string_view::npos && relative.find('/', dot) == std::string_view::npos) {
+        relative = relative.substr(0, dot);
+    }
+
+    std::string name;
+    name.reserve(mount.size() + relative.size() + 2);
+    name += '/';
+    name += mount;
+    name += '/';
+    name += relative;
+    return name;
+}
+
+uint64_t from_name(std::string_view package_name) {
+    std::vector<char16_t> buffer;
+    widen_lower(package_name, buffer);
+    return hash_utf16(buffer);
+}
+
+void from_names(std::span<const std::string_view> names, std::span<uint64_t> out) {
+    std::vector<char16_t> buffer;
+    for (size_t i = 0; i < names.size(); ++i) {
+        widen_lower(names[i], buffer);
+        out[i] = hash_utf16(buffer);
+    }
+}
+
+} // namespace file_formats::package_id
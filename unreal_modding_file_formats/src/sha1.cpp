@@ -0,0 +1,403 @@
+#include "sha1.h"
+#include "cpu_features.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define FILE_FORMATS_SHA1_X86 1
+#include <immintrin.h>
+#endif
+
+// The SIMD kernels are compiled for their instruction set regardless of the
+// target's baseline flags, and only called after a runtime CPU check.
+#if defined(__clang__)
+#define FILE_FORMATS_TARGET_SSE2 _Pragma("clang attribute push(__attribute__((target(\"sse2\"))), apply_to = function)")
+#define FILE_FORMATS_TARGET_AVX2 _Pragma("clang attribute push(__attribute__((target(\"avx2\"))), apply_to = function)")
+#define FILE_FORMATS_TARGET_AVX512 _Pragma("clang attribute push(__attribute__((target(\"avx512f\"))), apply_to = function)")
+#define FILE_FORMATS_TARGET_SHA _Pragma("clang attribute push(__attribute__((target(\"sha,ssse3,sse4.1\"))), apply_to = function)")
+#define FILE_FORMATS_TARGET_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define FILE_FORMATS_TARGET_SSE2 _Pragma("GCC push_options") _Pragma("GCC target(\"sse2\")")
+#define FILE_FORMATS_TARGET_AVX2 _Pragma("GCC push_options") _Pragma("GCC target(\"avx2\")")
+#define FILE_FORMATS_TARGET_AVX512 _Pragma("GCC push_options") _Pragma("GCC target(\"avx512f\")")
+#define FILE_FORMATS_TARGET_SHA _Pragma("GCC push_options") _Pragma("GCC target(\"sha,ssse3,sse4.1\")")
+#define FILE_FORMATS_TARGET_END _Pragma("GCC pop_options")
+#else
+#define FILE_FORMATS_TARGET_SSE2
+#define FILE_FORMATS_TARGET_AVX2
+#define FILE_FORMATS_TARGET_AVX512
+#define FILE_FORMATS_TARGET_SHA
+#define FILE_FORMATS_TARGET_END
+#endif
+
+namespace file_formats::sha1 {
+
+namespace {
+    constexpr uint32_t INITIAL_STATE[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    constexpr uint32_t K[4] = {0x5A827999, 0x6ED9EBA1, 0x8F1BBCDC, 0xCA62C1D6};
+    constexpr uint8_t ZERO_BLOCK[64] = {};
+
+    // Buffers at least this large skip the multi-buffer kernels when SHA-NI
+    // is available: one stream at a time is then as fast, and large buffers
+    // would leave the other lanes idle for most of the group.
+    constexpr size_t SHA_NI_THRESHOLD = 16 * 1024;
+
+    uint32_t load_be32(const uint8_t* p) {
+        return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+               (static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+    }
+
+    uint32_t rotl(uint32_t value, int bits) {
+        return (value << bits) | (value >> (32 - bits));
+    }
+
+    Digest to_digest(const uint32_t state[5]) {
+        Digest digest;
+        for (int i = 0; i < 5; ++i) {
+            digest[i * 4 + 0] = static_cast<uint8_t>(state[i] >> 24);
+            digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+            digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+            digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+        }
+        return digest;
+    }
+
+    size_t padded_block_count(size_t size) {
+        // Data, the 0x80 terminator and the 64-bit length, rounded up to blocks
+        return (size + 8) / 64 + 1;
+    }
+
+    // A message split into the blocks the compression function consumes: the
+    // whole 64-byte blocks are read in place, the last one or two blocks
+    // (remaining bytes, terminator and bit length) live in `tail`.
+    struct PaddedMessage {
+        const uint8_t* data = nullptr;
+        size_t full_blocks = 0;
+        size_t total_blocks = 0;
+        uint8_t tail[128];
+
+        void assign(const uint8_t* message, size_t size) {
+            data = message;
+            full_blocks = size / 64;
+            total_blocks = padded_block_count(size);
+
+            size_t remaining = size % 64;
+            size_t tail_size = (total_blocks - full_blocks) * 64;
+            std::memset(tail, 0, tail_size);
+            if (remaining > 0) {
+                std::memcpy(tail, data + full_blocks * 64, remaining);
+            }
+            tail[remaining] = 0x80;
+
+            uint64_t bits = static_cast<uint64_t>(size) * 8;
+            for (int i = 0; i < 8; ++i) {
+                tail[tail_size - 1 - i] = static_cast<uint8_t>(bits >> (i * 8));
+            }
+        }
+
+        const uint8_t* block(size_t index) const {
+            return index < full_blocks ? data + index * 64 : tail + (index - full_blocks) * 64;
+        }
+    };
+
+    void compress_scalar(uint32_t state[5], const uint8_t* block) {
+        uint32_t w[80];
+        for (int t = 0; t < 16; ++t) {
+            w[t] = load_be32(block + t * 4);
+        }
+        for (int t = 16; t < 80; ++t) {
+            w[t] = rotl(w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1);
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int t = 0; t < 80; ++t) {
+            uint32_t f, k;
+            if (t < 20) {
+                f = d ^ (b & (c ^ d));
+                k = K[0];
+            } else if (t < 40) {
+                f = b ^ c ^ d;
+                k = K[1];
+            } else if (t < 60) {
+                f = (b & c) | (d & (b | c));
+                k = K[2];
+            } else {
+                f = b ^ c ^ d;
+                k = K[3];
+            }
+            uint32_t temp = rotl(a, 5) + f + e + k + w[t];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    Digest hash_scalar(const uint8_t* data, size_t size) {
+        PaddedMessage message;
+        message.assign(data, size);
+
+        uint32_t state[5];
+        std::memcpy(state, INITIAL_STATE, sizeof(state));
+        for (size_t i = 0; i < message.total_blocks; ++i) {
+            compress_scalar(state, message.block(i));
+        }
+        return to_digest(state);
+    }
+
+} // namespace
+
+#ifdef FILE_FORMATS_SHA1_X86
+namespace {
+
+FILE_FORMATS_TARGET_SHA
+namespace shani {
+    // One group of four rounds. The message schedule is interleaved with the
+    // rounds; which registers are updated depends only on the group number.
+    template <int group>
+    inline void rounds(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i msg[4]) {
+        __m128i& current = msg[group % 4];
+        if constexpr (group == 0) {
+            e0 = _mm_add_epi32(e0, current);
+            e1 = abcd;
+            abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+        } else if constexpr (group % 2 == 0) {
+            e0 = _mm_sha1nexte_epu32(e0, current);
+            e1 = abcd;
+            abcd = _mm_sha1rnds4_epu32(abcd, e0, group / 5);
+        } else {
+            e1 = _mm_sha1nexte_epu32(e1, current);
+            e0 = abcd;
+            abcd = _mm_sha1rnds4_epu32(abcd, e1, group / 5);
+        }
+
+        if constexpr (group >= 3 && group <= 18) {
+            msg[(group + 1) % 4] = _mm_sha1msg2_epu32(msg[(group + 1) % 4], current);
+        }
+        if constexpr (group >= 1 && group <= 16) {
+            msg[(group + 3) % 4] = _mm_sha1msg1_epu32(msg[(group + 3) % 4], current);
+        }
+        if constexpr (group >= 2 && group <= 17) {
+            msg[(group + 2) % 4] = _mm_xor_si128(msg[(group + 2) % 4], current);
+        }
+    }
+
+    template <int... groups>
+    inline void all_rounds(__m128i& abcd, __m128i& e0, __m128i& e1, __m128i msg[4],
+                           std::integer_sequence<int, groups...>) {
+        (rounds<groups>(abcd, e0, e1, msg), ...);
+    }
+
+    inline void compress(const uint8_t* block, __m128i& abcd, __m128i& e0) {
+        const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607LL, 0x08090a0b0c0d0e0fLL);
+
+        __m128i abcd_save = abcd;
+        __m128i e0_save = e0;
+        __m128i e1;
+        __m128i msg[4];
+        for (int i = 0; i < 4; ++i) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i * 16)), byte_swap);
+        }
+
+        all_rounds(abcd, e0, e1, msg, std::make_integer_sequence<int, 20>{});
+
+        e0 = _mm_sha1nexte_epu32(e0, e0_save);
+        abcd = _mm_add_epi32(abcd, abcd_save);
+    }
+
+    inline Digest hash(const uint8_t* data, size_t size) {
+        PaddedMessage message;
+        message.assign(data, size);
+
+        __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(INITIAL_STATE)), 0x1B);
+        __m128i e0 = _mm_set_epi32(static_cast<int>(INITIAL_STATE[4]), 0, 0, 0);
+        for (size_t i = 0; i < message.total_blocks; ++i) {
+            compress(message.block(i), abcd, e0);
+        }
+
+        uint32_t state[5];
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(state), _mm_shuffle_epi32(abcd, 0x1B));
+        state[4] = static_cast<uint32_t>(_mm_extract_epi32(e0, 3));
+        return to_digest(state);
+    }
+} // namespace shani
+FILE_FORMATS_TARGET_END
+
+FILE_FORMATS_TARGET_SSE2
+namespace sse2 {
+    struct Vec {
+        using reg = __m128i;
+        static constexpr size_t lanes = 4;
+
+        static reg load(const uint32_t* p) { return _mm_load_si128(reinterpret_cast<const __m128i*>(p)); }
+        static void store(uint32_t* p, reg v) { _mm_store_si128(reinterpret_cast<__m128i*>(p), v); }
+        static reg set1(uint32_t v) { return _mm_set1_epi32(static_cast<int>(v)); }
+        static reg add(reg a, reg b) { return _mm_add_epi32(a, b); }
+        static reg band(reg a, reg b) { return _mm_and_si128(a, b); }
+        static reg bor(reg a, reg b) { return _mm_or_si128(a, b); }
+        static reg bxor(reg a, reg b) { return _mm_xor_si128(a, b); }
+        template <int bits>
+        static reg rotl(reg v) { return _mm_or_si128(_mm_slli_epi32(v, bits), _mm_srli_epi32(v, 32 - bits)); }
+    };
+
+#include "sha1_lanes.inl"
+} // namespace sse2
+FILE_FORMATS_TARGET_END
+
+FILE_FORMATS_TARGET_AVX2
+namespace avx2 {
+    struct Vec {
+        using reg = __m256i;
+        static constexpr size_t lanes = 8;
+
+        static reg load(const uint32_t* p) { return _mm256_load_si256(reinterpret_cast<const __m256i*>(p)); }
+        static void store(uint32_t* p, reg v) { _mm256_store_si256(reinterpret_cast<__m256i*>(p), v); }
+        static reg set1(uint32_t v) { return _mm256_set1_epi32(static_cast<int>(v)); }
+        static reg add(reg a, reg b) { return _mm256_add_epi32(a, b); }
+        static reg band(reg a, reg b) { return _mm256_and_si256(a, b); }
+        static reg bor(reg a, reg b) { return _mm256_or_si256(a, b); }
+        static reg bxor(reg a, reg b) { return _mm256_xor_si256(a, b); }
+        template <int bits>
+        static reg rotl(reg v) { return _mm256_or_si256(_mm256_slli_epi32(v, bits), _mm256_srli_epi32(v, 32 - bits)); }
+    };
+
+#include "sha1_lanes.inl"
+} // namespace avx2
+FILE_FORMATS_TARGET_END
+
+FILE_FORMATS_TARGET_AVX512
+namespace avx512 {
+    struct Vec {
+        using reg = __m512i;
+        static constexpr size_t lanes = 16;
+
+        static reg load(const uint32_t* p) { return _mm512_load_si512(p); }
+        static void store(uint32_t* p, reg v) { _mm512_store_si512(p, v); }
+        static reg set1(uint32_t v) { return _mm512_set1_epi32(static_cast<int>(v)); }
+        static reg add(reg a, reg b) { return _mm512_add_epi32(a, b); }
+        static reg band(reg a, reg b) { return _mm512_and_si512(a, b); }
+        static reg bor(reg a, reg b) { return _mm512_or_si512(a, b); }
+        static reg bxor(reg a, reg b) { return _mm512_xor_si512(a, b); }
+        // Masked form with a zero source: the unmasked intrinsic passes an
+        // undefined register that GCC reports as maybe-uninitialized
+        template <int bits>
+        static reg rotl(reg v) { return _mm512_mask_rol_epi32(_mm512_setzero_si512(), __mmask16(0xFFFF), v, bits); }
+    };
+
+#include "sha1_lanes.inl"
+} // namespace avx512
+FILE_FORMATS_TARGET_END
+
+} // namespace
+#endif
+
+namespace {
+    // Hash jobs `lanes` at a time, sorted by block count so every group
+    // holds messages of about the same length
+    void hash_grouped(std::vector<Job*>& jobs, Backend backend) {
+        std::sort(jobs.begin(), jobs.end(), [](const Job* a, const Job* b) {
+            return a->size < b->size;
+        });
+
+        const size_t lanes = lane_count(backend);
+        for (size_t i = 0; i < jobs.size(); i += lanes) {
+            size_t count = std::min(lanes, jobs.size() - i);
+            Job* const* group = jobs.data() + i;
+            switch (backend) {
+#ifdef FILE_FORMATS_SHA1_X86
+                case Backend::Sse2: sse2::hash_lanes(group, count); break;
+                case Backend::Avx2: avx2::hash_lanes(group, count); break;
+                case Backend::Avx512: avx512::hash_lanes(group, count); break;
+                case Backend::ShaNi:
+                    for (size_t j = 0; j < count; ++j) {
+                        *group[j]->out = shani::hash(group[j]->data, group[j]->size);
+                    }
+                    break;
+#endif
+                default:
+                    for (size_t j = 0; j < count; ++j) {
+                        *group[j]->out = hash_scalar(group[j]->data, group[j]->size);
+                    }
+                    break;
+            }
+        }
+    }
+} // namespace
+
+Digest hash(const uint8_t* data, size_t size) {
+#ifdef FILE_FORMATS_SHA1_X86
+    if (has_sha_ni()) {
+        return shani::hash(data, size);
+    }
+#endif
+    return hash_scalar(data, size);
+}
+
+void hash_many(std::span<Job> jobs) {
+    std::vector<Job*> small;
+    small.reserve(jobs.size());
+
+    bool sha_ni = has_sha_ni();
+    for (auto& job : jobs) {
+        if (sha_ni && job.size >= SHA_NI_THRESHOLD) {
+            *job.out = hash(job.data, job.size);
+        } else {
+            small.push_back(&job);
+        }
+    }
+
+    hash_grouped(small, best_backend());
+}
+
+void hash_many(std::span<Job> jobs, Backend backend) {
+    std::vector<Job*> pointers;
+    pointers.reserve(jobs.size());
+    for (auto& job : jobs) {
+        pointers.push_back(&job);
+    }
+    hash_grouped(pointers, backend);
+}
+
+Backend best_backend() {
+#ifdef FILE_FORMATS_SHA1_X86
+    const auto& features = file_formats::cpu_features();
+    if (features.avx512) {
+        return Backend::Avx512;
+    }
+    if (features.avx2) {
+        return Backend::Avx2;
+    }
+    return Backend::Sse2;
+#else
+    return Backend::Scalar;
+#endif
+}
+
+bool has_sha_ni() {
+#ifdef FILE_FORMATS_SHA1_X86
+    return file_formats::cpu_features().sha;
+#else
+    return false;
+#endif
+}
+
+size_t lane_count(Backend backend) {
+    switch (backend) {
+        case Backend::Sse2: return 4;
+        case Backend::Avx2: return 8;
+        case Backend::Avx512: return 16;
+        default: return 1;
+    }
+}
+
+} // namespace file_formats::sha1
@@ -0,0 +1,111 @@
+// Multi-buffer SHA1 kernel. This file is included once per instruction set,
+// inside a namespace that defines `Vec`: the register type, its lane count
+// and the handful of 32-bit lane operations SHA1 needs.
+
+// Compress one 64-byte block in every lane. `words` holds the 16 message
+// words transposed, so words[t * Vec::lanes + lane] is word t of that lane.
+inline void compress(Vec::reg state[5], const uint32_t* words) {
+    Vec::reg w[16];
+    for (int t = 0; t < 16; ++t) {
+        w[t] = Vec::load(words + t * Vec::lanes);
+    }
+
+    const Vec::reg k0 = Vec::set1(K[0]);
+    const Vec::reg k1 = Vec::set1(K[1]);
+    const Vec::reg k2 = Vec::set1(K[2]);
+    const Vec::reg k3 = Vec::set1(K[3]);
+
+    Vec::reg a = state[0];
+    Vec::reg b = state[1];
+    Vec::reg c = state[2];
+    Vec::reg d = state[3];
+    Vec::reg e = state[4];
+
+    for (int t = 0; t < 80; ++t) {
+        if (t >= 16) {
+            // W[t] = rotl1(W[t-3] ^ W[t-8] ^ W[t-14] ^ W[t-16])
+            w[t & 15] = Vec::rotl<1>(Vec::bxor(Vec::bxor(w[(t + 13) & 15], w[(t + 8) & 15]),
+                                               Vec::bxor(w[(t + 2) & 15], w[t & 15])));
+        }
+
+        Vec::reg f;
+        Vec::reg k;
+        if (t < 20) {
+            f = Vec::bxor(d, Vec::band(b, Vec::bxor(c, d)));
+            k = k0;
+        } else if (t < 40) {
+            f = Vec::bxor(b, Vec::bxor(c, d));
+            k = k1;
+        } else if (t < 60) {
+            f = Vec::bor(Vec::band(b, c), Vec::band(d, Vec::bor(b, c)));
+            k = k2;
+        } else {
+            f = Vec::bxor(b, Vec::bxor(c, d));
+            k = k3;
+        }
+
+        Vec::reg temp = Vec::add(Vec::add(Vec::rotl<5>(a), f), Vec::add(Vec::add(e, k), w[t & 15]));
+        e = d;
+        d = c;
+        c = Vec::rotl<30>(b);
+        b = a;
+        a = temp;
+    }
+
+    state[0] = Vec::add(state[0], a);
+    state[1] = Vec::add(state[1], b);
+    state[2] = Vec::add(state[2], c);
+    state[3] = Vec::add(state[3], d);
+    state[4] = Vec::add(state[4], e);
+}
+
+// Hash up to Vec::lanes jobs in lockstep. Lanes that run out of blocks keep
+// compressing throwaway data; their digest was captured when their last
+// block went through.
+inline void hash_lanes(Job* const* jobs, size_t count) {
+    PaddedMessage messages[Vec::lanes];
+    size_t max_blocks = 0;
+    for (size_t lane = 0; lane < count; ++lane) {
+        messages[lane].assign(jobs[lane]->data, jobs[lane]->size);
+        max_blocks = std::max(max_blocks, messages[lane].total_blocks);
+    }
+
+    Vec::reg state[5];
+    for (int i = 0; i < 5; ++i) {
+        state[i] = Vec::set1(INITIAL_STATE[i]);
+    }
+
+    alignas(64) uint32_t words[16 * Vec::lanes];
+    alignas(64) uint32_t lane_state[5][Vec::lanes];
+
+    for (size_t block = 0; block < max_blocks; ++block) {
+        bool finishing = false;
+        for (size_t lane = 0; lane < Vec::lanes; ++lane) {
+            const uint8_t* source = ZERO_BLOCK;
+            if (lane < count && block < messages[lane].total_blocks) {
+                source = messages[lane].block(block);
+                finishing |= messages[lane].total_blocks == block + 1;
+            }
+            for (int t = 0; t < 16; ++t) {
+                words[t * Vec::lanes + lane] = load_be32(source + t * 4);
+            }
+        }
+
+        compress(state, words);
+
+        if (finishing) {
+            for (int i = 0; i < 5; ++i) {
+                Vec::store(lane_state[i], state[i]);
+            }
+            for (size_t lane = 0; lane < count; ++lane) {
+                if (messages[lane].total_blocks == block + 1) {
+                    uint32_t digest_words[5];
+                    for (int i = 0; i < 5; ++i) {
+                        digest_words[i] = lane_state[i][lane];
+                    }
+                    *jobs[lane]->out = to_digest(digest_words);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace pak {
+class PakReader;
+}
+
+namespace utoc {
+class UtocReader;
+}
+
+namespace mo2 {
+
+// Position of an archive in the load order. Higher ids have higher
+// priority and win conflicts.
+using ArchiveId = uint32_t;
+
+enum class ArchiveKind {
+    Pak,
+    IoStore,
+    Loose
+};
+
+// The file list of one archive (or one mod's loose files), with every
+// path normalized. A path's position in `paths` is its entry id.
+struct ArchiveListing {
+    std::string name;
+    ArchiveKind kind = ArchiveKind::Pak;
+    std::filesystem::path source;
+    std::vector<std::string> paths;
+
+    // Loose files only: each entry's path under `source` as found on disk,
+    // before case folding. Empty for archives.
+    std::vector<std::string> source_paths;
+};
+
+// Build the listing of an open .pak
+ArchiveListing list_archive(const pak::PakReader& reader, std::string name, std::filesystem::path source);
+
+// Build the listing of an open .utoc
+ArchiveListing list_archive(const utoc::UtocReader& reader, std::string name, std::filesystem::path source);
+
+// Archives in load order, lowest priority first
+class ArchiveSet {
+public:
+    // Append an archive at the top of the load order and return its id
+    ArchiveId add(ArchiveListing listing);
+
+    size_t size() const { return archives_.size(); }
+    bool empty() const { return archives_.empty(); }
+
+    const ArchiveListing& operator[](ArchiveId id) const { return archives_[id]; }
+    const ArchiveListing& at(ArchiveId id) const { return archives_.at(id); }
+
+    std::span<const ArchiveListing> archives() const { return archives_; }
+
+private:
+    std::vector<ArchiveListing> archives_;
+};
+
+} // namespace mo2
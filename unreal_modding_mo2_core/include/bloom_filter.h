@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace mo2 {
+
+// Bloom filter over normalized path hashes. Answers "might this archive
+// ship the path" from about ten bits per path, with roughly a 1% false
+// positive rate and no false negatives. Probe positions are derived from
+// the two halves of the 64-bit path hash, so no rehashing is needed.
+class BloomFilter {
+public:
+    BloomFilter() = default;
+
+    // Size the filter for this many hashes and add them
+    static BloomFilter build(std::span<const uint64_t> hashes);
+
+    bool may_contain(uint64_t hash) const;
+
+    size_t memory_usage() const { return words_.size() * sizeof(uint64_t); }
+
+private:
+    static constexpr size_t BITS_PER_KEY = 10;
+    static constexpr uint32_t PROBES = 7;
+
+    void add(uint64_t hash);
+
+    std::vector<uint64_t> words_;
+    uint64_t bit_count_ = 0;
+};
+
+} // namespace mo2
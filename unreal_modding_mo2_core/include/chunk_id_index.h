@@ -0,0 +1,64 @@
+#pragma once
+
+#include "archive_set.h"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace utoc {
+class UtocReader;
+struct FIoChunkId;
+}
+
+namespace mo2 {
+
+// The winning copy of a chunk: the container it resolves to and its chunk
+// index there, plus how many lower-priority containers it overrides
+struct ChunkLocation {
+    ArchiveId container;
+    uint32_t chunk_index;
+    uint32_t shadowed;
+};
+
+// Every FIoChunkId of every open IoStore container, resolved by load
+// order. IoStore mods override assets by chunk id, so this is where
+// chunk-level conflicts are found. Lookups are one hash probe.
+class ChunkIdIndex {
+public:
+    // Build from containers in load order, lowest priority first. A
+    // container's position in `containers` is its id. Built in parallel.
+    static ChunkIdIndex build(std::span<const utoc::UtocReader* const> containers);
+
+    // Number of unique chunk ids
+    size_t size() const { return size_; }
+
+    std::optional<ChunkLocation> find(const utoc::FIoChunkId& id) const;
+
+    // True if more than one container ships the chunk
+    bool is_conflicted(const utoc::FIoChunkId& id) const;
+
+private:
+    struct Slot {
+        uint8_t id[12];
+        ArchiveId container; // EMPTY_SLOT if unused
+        uint32_t chunk_index;
+        uint32_t shadowed;
+    };
+
+    static constexpr ArchiveId EMPTY_SLOT = UINT32_MAX;
+
+    const Slot* find_slot(const utoc::FIoChunkId& id) const;
+
+    // One open-addressing table per hash partition, so partitions can be
+    // built independently
+    struct Table {
+        std::vector<Slot> slots;
+        size_t mask = 0;
+    };
+    std::vector<Table> tables_;
+    size_t size_ = 0;
+};
+
+} // namespace mo2
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "archive_set.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace pak {
+class PakReader;
+struct Entry;
+}
+
+namespace utoc {
+class UtocReader;
+}
+
+namespace mo2 {
+
+// The sibling files of one UE5 mod: Name_P.pak + Name_P.utoc + Name_P.ucas.
+// Older mods ship only the .pak.
+struct ContainerPaths {
+    std::string name; // file name without extension
+    std::optional<std::filesystem::path> pak;
+    std::optional<std::filesystem::path> utoc;
+    std::optional<std::filesystem::path> ucas;
+};
+
+// Find the siblings of any one member of a container set
+ContainerPaths discover_container(const std::filesystem::path& member);
+
+// Every container set in a directory, sorted by name
+std::vector<ContainerPaths> discover_containers(const std::filesystem::path& directory);
+
+// Where a file of a container set lives
+struct ContainerFile {
+    const pak::Entry* pak_entry = nullptr; // set when the file is in the .pak
+    std::optional<uint32_t> chunk_index;   // set when the file is in the .utoc/.ucas
+};
+
+// A .pak and its .utoc/.ucas opened as one mod. The parts are opened
+// concurrently, so opening a set takes about as long as its slowest part.
+// Files in both the .pak and the IoStore container resolve to the IoStore
+// copy, which is the one the game loads.
+class ContainerSet {
+public:
+    // Open every part found next to `member`. Throws ContainerException if
+    // no part can be opened, if a .utoc has no .ucas, or if a part fails
+    // to parse.
+    static ContainerSet open(const std::filesystem::path& member);
+
+    // Open the parts of an already discovered set
+    static ContainerSet open(ContainerPaths paths);
+
+    ContainerSet(ContainerSet&&) noexcept;
+    ContainerSet& operator=(ContainerSet&&) noexcept;
+    ~ContainerSet();
+
+    const ContainerPaths& paths() const { return paths_; }
+    const std::string& name() const { return paths_.name; }
+
+    // The readers of the parts; nullptr if the part is missing
+    const pak::PakReader* pak() const { return pak_.get(); }
+    const utoc::UtocReader* utoc() const { return utoc_.get(); }
+
+    // Normalized paths of every file in the set, without duplicates
+    const std::vector<std::string>& files() const { return files_; }
+
+    // Look up a path that is already normalized
+    std::optional<ContainerFile> find(std::string_view normalized_path) const;
+
+    // The merged listing of the set, ready for an ArchiveSet
+    ArchiveListing listing() const;
+
+private:
+    ContainerSet() = default;
+
+    ContainerPaths paths_;
+    std::unique_ptr<pak::PakReader> pak_;
+    std::unique_ptr<utoc::UtocReader> utoc_;
+
+    // Sorted by (hash, path); files_[i] is resolved by locations_[i]
+    std::vector<uint64_t> hashes_;
+    std::vector<std::string> files_;
+    std::vector<ContainerFile> locations_;
+};
+
+// Exception class for container set errors
+class ContainerException : public std::runtime_error {
+public:
+    explicit ContainerException(const std::string& message);
+};
+
+} // namespace mo2
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "merged_vfs.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mo2 {
+
+// How a file is placed in the deploy directory, in order of preference
+enum class DeployMethod : uint8_t {
+    Reflink,  // copy-on-write clone sharing the source's extents
+    Hardlink, // second name for the source file; edits reach the mod
+    Copy      // full copy, in the kernel where possible
+};
+
+// One file of a deploy directory
+struct DeployItem {
+    std::string target; // relative to the deploy directory
+    std::filesystem::path source;
+    uint64_t size = 0;
+    int64_t mtime_ns = 0; // of the source, nanoseconds since the Unix epoch
+    DeployMethod method = DeployMethod::Copy; // how it was deployed
+};
+
+// The files of a deploy directory, sorted by target
+struct DeployManifest {
+    std::vector<DeployItem> items;
+
+    // Read a manifest written by save(); empty if the file doesn't exist.
+    // Throws std::runtime_error if the file is malformed.
+    static DeployManifest load(const std::filesystem::path& file);
+
+    // Write the manifest, replacing the file atomically
+    void save(const std::filesystem::path& file) const;
+};
+
+// What the deploy directory should contain for a merged VFS: every loose
+// file that wins its path, at that path, and every mounted .pak or IoStore
+// container with its companion files (.pak, .utoc, .ucas, .sig) under
+// `archive_directory`. Files are matched by normalized path but keep the
+// case they have on disk, as does `archive_directory`. Sources are stat'ed
+// in parallel; throws std::filesystem::filesystem_error if a loose file has
+// gone missing.
+DeployManifest desired_state(const MergedVfs& vfs, std::string_view archive_directory);
+
+// Differences between two manifests, as indices into them
+struct DeployPlan {
+    std::vector<size_t> added;    // in desired only
+    std::vector<std::pair<size_t, size_t>> replaced; // in both with a changed source: (desired, deployed)
+    std::vector<size_t> removed;  // in deployed only
+    size_t unchanged = 0;
+
+    bool empty() const { return added.empty() && replaced.empty() && removed.empty(); }
+};
+
+// Compare the desired state with the last deployment in one linear pass
+DeployPlan plan_deployment(const DeployManifest& desired, const DeployManifest& deployed);
+
+struct DeployOptions {
+    // Preferred method. Reflink falls back to Copy; Hardlink falls back to
+    // Reflink and then Copy, e.g. when the source is on another file system.
+    DeployMethod method = DeployMethod::Reflink;
+};
+
+struct DeployReport {
+    size_t added = 0;
+    size_t replaced = 0;
+    size_t removed = 0;
+    size_t unchanged = 0;
+    size_t reflinked = 0;
+    size_t hardlinked = 0;
+    size_t copied = 0;
+};
+
+// Name of the manifest kept in every deploy directory
+inline constexpr std::string_view DEPLOY_MANIFEST_NAME = ".mo2_deploy_manifest";
+
+// Bring a deploy directory to the desired state, touching only what changed
+// since the last deployment: files that are no longer wanted are deleted
+// and directories left empty are pruned, then new and changed files are
+// placed in parallel, each written under a temporary name and renamed into
+// place.
+// The manifest is saved even if some files fail, recording what was
+// actually deployed, and the first failure is then rethrown.
+DeployReport deploy(const std::filesystem::path& directory, const DeployManifest& desired,
+                    const DeployOptions& options = {});
+
+} // namespace mo2
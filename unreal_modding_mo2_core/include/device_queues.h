@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mo2 {
+
+enum class DeviceKind {
+    Nvme,
+    Ssd,
+    Rotational,
+    Unknown
+};
+
+// The block device a file lives on
+struct DeviceInfo {
+    uint64_t id = 0;  // st_dev of the file
+    DeviceKind kind = DeviceKind::Unknown;
+    std::string name; // kernel name such as "nvme0n1" or "sda", if known
+};
+
+// Find the device of a file. On Linux the kind comes from sysfs; elsewhere,
+// or for files on virtual file systems, it is Unknown.
+DeviceInfo identify_device(const std::filesystem::path& file);
+
+// How requests to one device are issued
+struct DevicePolicy {
+    size_t queue_depth;  // requests in flight at once
+    bool sort_by_offset; // serve requests in (file, offset) order, elevator style
+};
+
+// Deep and unordered for flash, one request at a time in disk order for
+// spinning disks
+DevicePolicy policy_for(DeviceKind kind);
+
+// Per-device I/O queues. Work is queued on the device of the file it reads
+// and run by that device's own workers, so archives on different drives are
+// processed concurrently and each drive gets the queue depth and request
+// order that suits it. A library scan keeps every drive busy without
+// sending a spinning disk's head back and forth.
+class DeviceQueues {
+public:
+    DeviceQueues();
+
+    // Waits for all queued work
+    ~DeviceQueues();
+
+    DeviceQueues(const DeviceQueues&) = delete;
+    DeviceQueues& operator=(const DeviceQueues&) = delete;
+
+    // Queue work that reads `file` around `offset`. The file is stat'ed to
+    // find its device; sysfs is only read the first time a device is seen.
+    void submit(const std::filesystem::path& file, uint64_t offset, std::function<void()> work);
+
+    // Block until every queued request has run. Rethrows the first
+    // exception thrown by a request.
+    void wait();
+
+    // Devices seen so far
+    std::vector<DeviceInfo> devices() const;
+
+private:
+    struct Request {
+        std::filesystem::path file;
+        uint64_t offset;
+        std::function<void()> work;
+    };
+
+    struct Device;
+
+    Device& device_of(const std::filesystem::path& file);
+    void work(Device& device);
+
+    mutable std::mutex mutex_;
+    std::condition_variable idle_;
+    std::map<uint64_t, std::unique_ptr<Device>> devices_;
+    size_t outstanding_ = 0;
+    std::exception_ptr error_;
+};
+
+// Run fn(file) for every file, queued on the file's device
+void for_each_file_by_device(std::span<const std::filesystem::path> files,
+                             const std::function<void(const std::filesystem::path&)>& fn);
+
+} // namespace mo2
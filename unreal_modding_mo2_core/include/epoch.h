@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace mo2 {
+
+// Epoch-based reclamation. Readers pin the current epoch while they look at
+// shared data, without taking a lock; writers hand what they replaced to
+// retire(), and it is freed once every reader that could still see it has
+// unpinned.
+class EpochDomain {
+    struct Slot;
+
+public:
+    // Keeps an epoch pinned until destroyed
+    class Guard {
+    public:
+        Guard() = default;
+        ~Guard() { release(); }
+
+        Guard(Guard&& other) noexcept : slot_(other.slot_) { other.slot_ = nullptr; }
+        Guard& operator=(Guard&& other) noexcept;
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        friend class EpochDomain;
+
+        explicit Guard(Slot* slot) : slot_(slot) {}
+        void release();
+
+        Slot* slot_ = nullptr;
+    };
+
+    EpochDomain() = default;
+
+    // Frees everything still retired; no guards may be alive
+    ~EpochDomain();
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // Pin the current epoch. Wait-free unless more than SLOT_COUNT threads
+    // read at once, in which case it spins until a slot frees up.
+    Guard pin();
+
+    // Run `deleter` once no reader pinned before this call is left. The
+    // object must already be unreachable for new readers.
+    void retire(std::function<void()> deleter);
+
+    // Free whatever no pinned reader can still see. retire() calls this.
+    void collect();
+
+    // Number of retired objects not freed yet
+    size_t retired_count() const;
+
+private:
+    static constexpr size_t SLOT_COUNT = 128;
+    static constexpr uint64_t IDLE = UINT64_MAX;
+
+    // One reader's pin, on its own cache line so readers don't contend
+    struct alignas(64) Slot {
+        std::atomic<bool> claimed{false};
+        std::atomic<uint64_t> epoch{IDLE};
+    };
+
+    struct Retired {
+        uint64_t epoch;
+        std::function<void()> deleter;
+    };
+
+    std::atomic<uint64_t> epoch_{0};
+    std::array<Slot, SLOT_COUNT> slots_{};
+
+    mutable std::mutex retired_mutex_; // taken by writers only
+    std::vector<Retired> retired_;
+};
+
+} // namespace mo2
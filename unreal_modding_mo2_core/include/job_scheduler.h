@@ -0,0 +1,193 @@
+#pragma once
+
+#include "parallel.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace mo2 {
+
+// Priority classes, most urgent first. Interactive work is what a user is
+// waiting on (looking up the files of the mod they clicked); background
+// work is whole-library jobs such as verify or cache rebuilds.
+enum class JobPriority : uint8_t {
+    Interactive,
+    Normal,
+    Background,
+};
+
+constexpr size_t JOB_PRIORITY_COUNT = 3;
+
+// Shared flag that asks one or more jobs to stop. Copies share the flag.
+class CancellationToken {
+public:
+    CancellationToken() : cancelled_(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void cancel() const { cancelled_->store(true, std::memory_order_relaxed); }
+    bool cancelled() const { return cancelled_->load(std::memory_order_relaxed); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Thrown by JobContext::throw_if_cancelled() to unwind a cancelled step
+class JobCancelled : public std::runtime_error {
+public:
+    JobCancelled() : std::runtime_error("Job cancelled") {}
+};
+
+enum class JobStatus : uint8_t {
+    Queued,
+    Running,
+    Completed,
+    Cancelled,
+    Failed,
+};
+
+struct JobProgress {
+    uint64_t done = 0;
+    uint64_t total = 0; // 0 while unknown
+};
+
+namespace detail {
+    struct JobState {
+        CancellationToken token;
+        std::atomic<uint64_t> done{0};
+        std::atomic<uint64_t> total{0};
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        JobStatus status = JobStatus::Queued;
+        std::exception_ptr error;
+    };
+}
+
+// What a running job sees: its cancellation token and its progress counters
+class JobContext {
+public:
+    explicit JobContext(detail::JobState& state) : state_(state) {}
+
+    const CancellationToken& token() const { return state_.token; }
+    bool cancelled() const { return state_.token.cancelled(); }
+
+    void throw_if_cancelled() const {
+        if (cancelled()) {
+            throw JobCancelled();
+        }
+    }
+
+    void set_total(uint64_t total) { state_.total.store(total, std::memory_order_relaxed); }
+    void advance(uint64_t count = 1) { state_.done.fetch_add(count, std::memory_order_relaxed); }
+
+private:
+    detail::JobState& state_;
+};
+
+// One block of a job's work: a single read, decompression or hash batch.
+// Returns true once the job is finished. Jobs are rescheduled between
+// blocks, which is where more urgent work preempts them.
+using JobStep = std::function<bool(JobContext&)>;
+
+// Caller's view of a submitted job
+class JobHandle {
+public:
+    JobHandle() = default;
+
+    bool valid() const { return state_ != nullptr; }
+
+    void cancel() const { state_->token.cancel(); }
+
+    JobStatus status() const;
+    bool finished() const;
+
+    JobProgress progress() const {
+        return {state_->done.load(std::memory_order_relaxed), state_->total.load(std::memory_order_relaxed)};
+    }
+
+    // Block until the job has finished. Rethrows the exception that failed
+    // the job; a cancelled job returns normally.
+    JobStatus wait() const;
+
+private:
+    friend class JobScheduler;
+
+    explicit JobHandle(std::shared_ptr<detail::JobState> state) : state_(std::move(state)) {}
+
+    std::shared_ptr<detail::JobState> state_;
+};
+
+// Work-stealing pool with priority classes. Every worker keeps a deque per
+// priority; it runs its own newest job (which keeps a job's blocks on one
+// thread) and steals the oldest job of another worker when it runs dry.
+// Before every block a worker takes the most urgent job available anywhere,
+// so interactive requests overtake a running verify at block granularity.
+class JobScheduler {
+public:
+    explicit JobScheduler(size_t threads = file_formats::worker_count());
+
+    // Stops the workers after their current block; jobs still queued are
+    // marked cancelled
+    ~JobScheduler();
+
+    JobScheduler(const JobScheduler&) = delete;
+    JobScheduler& operator=(const JobScheduler&) = delete;
+
+    // Queue a job made of steps. Submitting from a worker queues the job on
+    // that worker, everything else is spread round-robin.
+    JobHandle submit(JobPriority priority, JobStep step, CancellationToken token = {});
+
+    // Queue a job that runs in a single block
+    template <typename Fn>
+    JobHandle run(JobPriority priority, Fn fn, CancellationToken token = {}) {
+        return submit(priority, [fn = std::move(fn)](JobContext& context) mutable {
+            fn(context);
+            return true;
+        }, std::move(token));
+    }
+
+    size_t thread_count() const { return threads_.size(); }
+
+    // Number of jobs waiting for a worker at a priority
+    size_t queued(JobPriority priority) const {
+        return queued_[static_cast<size_t>(priority)].load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Job {
+        JobStep step;
+        std::shared_ptr<detail::JobState> state;
+    };
+
+    struct Worker {
+        std::mutex mutex;
+        std::array<std::deque<Job>, JOB_PRIORITY_COUNT> queues;
+    };
+
+    void push(size_t worker, size_t priority, Job job, bool wake);
+    bool pop(size_t worker, Job& job, size_t& priority);
+    void work(size_t worker);
+    static void finish(detail::JobState& state, JobStatus status, std::exception_ptr error = nullptr);
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::array<std::atomic<size_t>, JOB_PRIORITY_COUNT> queued_{};
+    std::atomic<size_t> next_worker_{0};
+
+    std::mutex sleep_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> total_queued_{0};
+    bool stopping_ = false;
+};
+
+} // namespace mo2
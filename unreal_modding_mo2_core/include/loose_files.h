@@ -0,0 +1,43 @@
+#pragma once
+
+#include "archive_set.h"
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace mo2 {
+
+class JobScheduler;
+
+// One regular file found under a mod directory
+struct LooseFile {
+    std::string path;      // normalized, relative to the mod directory
+    std::string relative;  // as found on disk, with forward slashes
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;  // last write time, nanoseconds since the Unix epoch
+};
+
+// Every regular file under a mod directory, sorted by path
+struct LooseTree {
+    std::filesystem::path root;
+    std::vector<LooseFile> files;
+    std::vector<std::string> unreadable; // subdirectories that couldn't be read, as found on disk, sorted
+};
+
+// Walk a mod directory in parallel. Directories are read from a shared
+// queue by the calling thread and by up to one helper job per worker of
+// `scheduler`. The caller reads directories itself rather than block a
+// worker, so it may be a job on that same scheduler. On Linux,
+// directories are read with getdents64 and metadata is fetched with statx
+// relative to the open directory, so no path is resolved twice. Symlinked
+// directories are not followed. A subdirectory that can't be read is
+// skipped and listed in `unreadable`; only an unreadable root throws
+// std::filesystem::filesystem_error.
+LooseTree scan_loose_tree(const std::filesystem::path& root, JobScheduler* scheduler = nullptr);
+
+// Build the listing of a mod's loose files, ready for an ArchiveSet
+ArchiveListing list_archive(const LooseTree& tree, std::string name);
+
+} // namespace mo2
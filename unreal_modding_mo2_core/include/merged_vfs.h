@@ -0,0 +1,55 @@
+#pragma once
+
+#include "archive_set.h"
+
+#include <flat_path_map.h>
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mo2 {
+
+// The winning copy of one path: the archive it resolves to and its entry
+// id in that archive's listing
+struct VfsEntry {
+    uint64_t hash;
+    ArchiveId archive;
+    uint32_t entry;
+};
+
+// The virtual file system the game sees once every archive is mounted:
+// one entry per unique path, resolved to the highest-priority archive
+// that ships it. Entries are sorted by path hash.
+class MergedVfs {
+public:
+    MergedVfs() = default;
+
+    // Resolve every path of the set, in parallel
+    static MergedVfs build(std::shared_ptr<const ArchiveSet> archives);
+
+    size_t size() const { return entries_.size(); }
+    bool empty() const { return entries_.empty(); }
+
+    std::span<const VfsEntry> entries() const { return entries_; }
+    const ArchiveSet& archives() const { return *archives_; }
+
+    // The normalized path of an entry
+    const std::string& path(const VfsEntry& entry) const {
+        return (*archives_)[entry.archive].paths[entry.entry];
+    }
+
+    // Look up a path that is already normalized
+    std::optional<VfsEntry> find(std::string_view normalized_path) const;
+
+private:
+    std::shared_ptr<const ArchiveSet> archives_ = std::make_shared<ArchiveSet>();
+    std::vector<VfsEntry> entries_;
+    file_formats::FlatPathMap<uint32_t> index_; // path hash to position in entries_, for find()
+};
+
+} // namespace mo2
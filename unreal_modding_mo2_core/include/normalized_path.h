@@ -0,0 +1,22 @@
+#pragma once
+
+#include "path_hash.h"
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mo2 {
+
+// Normalize a path so the same file compares equal across archives and
+// loose files: forward slashes, ASCII lower case, and no leading "../",
+// "./" or "/" segments (pak mount points usually start with "../../../").
+std::string normalize_path(std::string_view path);
+
+// Join an archive's mount point with a path inside the archive, then normalize
+std::string normalize_path(std::string_view mount_point, std::string_view path);
+
+// Hash of a normalized path; the same hash the readers' lookup tables use
+using file_formats::hash_path;
+
+} // namespace mo2
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "archive_set.h"
+#include "roaring_bitmap.h"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mo2 {
+
+// Dense id of a unique normalized path across all archives
+using PathId = uint32_t;
+
+// Inverted index from every unique path to the archives that contain it,
+// plus the forward index from every archive to its paths, both as
+// compressed bitmaps. Answers "which archives ship this file, in priority
+// order" and "what does mod A override in mod B" with bitmap operations.
+class PathPostingIndex {
+public:
+    // Build the index from every archive in the set, in parallel
+    static PathPostingIndex build(const ArchiveSet& archives);
+
+    size_t path_count() const { return paths_.size(); }
+    size_t archive_count() const { return archive_paths_.size(); }
+
+    // The normalized path behind an id
+    const std::string& path(PathId id) const { return paths_[id]; }
+
+    // Look up a path that is already normalized
+    std::optional<PathId> find(std::string_view normalized_path) const;
+
+    // Archives that contain the path
+    RoaringBitmap postings(PathId id) const;
+
+    // Every archive that contains the path, highest priority (the winner)
+    // first. The path is normalized before the lookup.
+    std::vector<ArchiveId> explain(std::string_view path) const;
+
+    // Paths shipped by an archive
+    const RoaringBitmap& paths_of(ArchiveId archive) const { return archive_paths_[archive]; }
+
+    // Paths that `upper` overrides in `lower`: both ship them and `upper`
+    // is later in the load order. Empty if `upper` loads first.
+    RoaringBitmap overrides(ArchiveId upper, ArchiveId lower) const;
+
+    // Paths of an archive that no later archive overrides
+    RoaringBitmap winning_paths(ArchiveId archive) const;
+
+private:
+    // Most paths live in exactly one archive. Their posting reference holds
+    // that archive id with this bit set instead of pointing at a bitmap.
+    static constexpr uint32_t SINGLE_ARCHIVE = 0x80000000u;
+
+    std::vector<uint64_t> hashes_; // sorted, indexed by path id
+    std::vector<std::string> paths_;
+    std::vector<uint32_t> posting_refs_;
+    std::vector<RoaringBitmap> shared_postings_;
+    std::vector<RoaringBitmap> archive_paths_;
+};
+
+} // namespace mo2
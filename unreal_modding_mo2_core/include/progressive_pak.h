@@ -0,0 +1,45 @@
+#pragma once
+
+#include "job_scheduler.h"
+
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace pak {
+class PakReader;
+class IndexParser;
+}
+
+namespace mo2 {
+
+// Called after every block with the parser, so the caller can show the
+// paths parsed so far before the whole index is in
+using PakProgressCallback = std::function<void(const pak::IndexParser&)>;
+
+// Called once with the finished reader
+using PakDoneCallback = std::function<void(std::unique_ptr<pak::PakReader>)>;
+
+// Called once with the paths whose data didn't match their stored SHA1
+using PakVerifyCallback = std::function<void(std::vector<std::string>)>;
+
+// Open a pak on the scheduler, parsing its index a few milliseconds per
+// block so that a pak with hundreds of thousands of entries gives way to
+// more urgent jobs between blocks. Progress counts index entries. The
+// callbacks run on the worker that runs the block. A failed open fails the
+// job and a cancelled one stops at the next block; neither calls on_done.
+JobHandle open_pak_progressively(JobScheduler& scheduler, const std::filesystem::path& path,
+                                 PakProgressCallback on_progress, PakDoneCallback on_done,
+                                 JobPriority priority = JobPriority::Normal, CancellationToken token = {});
+
+// Verify a pak on the scheduler, one read-and-hash batch per block, so a
+// whole-library verify can be cancelled and interactive lookups overtake
+// it. Progress counts entries checked. on_done runs like it does for
+// open_pak_progressively().
+JobHandle verify_pak(JobScheduler& scheduler, std::shared_ptr<const pak::PakReader> reader,
+                     PakVerifyCallback on_done, JobPriority priority = JobPriority::Background,
+                     CancellationToken token = {});
+
+} // namespace mo2
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace mo2 {
+
+// Compressed set of 32-bit ids in the style of Roaring bitmaps. Values are
+// split on their high 16 bits into containers; a container is a sorted
+// array of the low 16 bits while it holds at most 4096 values, and a
+// 65536-bit bitmap once it grows past that. Sparse sets stay small and
+// dense ones get word-at-a-time set operations.
+class RoaringBitmap {
+public:
+    RoaringBitmap() = default;
+
+    // Build from values sorted in ascending order (duplicates allowed)
+    static RoaringBitmap from_sorted(std::span<const uint32_t> values);
+
+    // Add a value; appending in ascending order is the fast path
+    void add(uint32_t value);
+
+    bool contains(uint32_t value) const;
+    bool empty() const { return containers_.empty(); }
+    uint64_t cardinality() const;
+
+    // Smallest and largest value; the bitmap must not be empty
+    uint32_t minimum() const;
+    uint32_t maximum() const;
+
+    // All values in ascending order
+    std::vector<uint32_t> to_vector() const;
+
+    // Call fn(value) for every value in ascending order
+    template <typename Fn>
+    void for_each(Fn&& fn) const {
+        for (const auto& container : containers_) {
+            uint32_t high = static_cast<uint32_t>(container.key) << 16;
+            if (container.is_bitmap()) {
+                for (size_t word = 0; word < container.bits.size(); ++word) {
+                    uint64_t bits = container.bits[word];
+                    while (bits != 0) {
+                        int bit = std::countr_zero(bits);
+                        fn(high | static_cast<uint32_t>(word * 64 + bit));
+                        bits &= bits - 1;
+                    }
+                }
+            } else {
+                for (uint16_t low : container.array) {
+                    fn(high | low);
+                }
+            }
+        }
+    }
+
+    // Set operations
+    RoaringBitmap operator&(const RoaringBitmap& other) const;
+    RoaringBitmap operator|(const RoaringBitmap& other) const;
+    RoaringBitmap and_not(const RoaringBitmap& other) const;
+
+    // Size of the intersection without materializing it
+    uint64_t and_cardinality(const RoaringBitmap& other) const;
+
+    // Approximate heap usage in bytes
+    size_t memory_usage() const;
+
+    bool operator==(const RoaringBitmap& other) const;
+
+private:
+    // Containers switch from array to bitmap above this many values
+    static constexpr uint32_t ARRAY_LIMIT = 4096;
+    static constexpr size_t BITMAP_WORDS = 65536 / 64;
+
+    struct Container {
+        uint16_t key = 0;
+        uint32_t cardinality = 0;
+        std::vector<uint16_t> array; // sorted low bits, while an array container
+        std::vector<uint64_t> bits;  // BITMAP_WORDS words, once a bitmap container
+
+        bool is_bitmap() const { return !bits.empty(); }
+        bool contains(uint16_t low) const;
+        void add(uint16_t low);
+        void to_bitmap();
+        void shrink_if_sparse();
+    };
+
+    static Container intersect(const Container& a, const Container& b);
+    static Container unite(const Container& a, const Container& b);
+    static Container subtract(const Container& a, const Container& b);
+    static uint64_t intersect_count(const Container& a, const Container& b);
+
+    Container* find_container(uint16_t key);
+    const Container* find_container(uint16_t key) const;
+
+    std::vector<Container> containers_; // sorted by key
+};
+
+} // namespace mo2
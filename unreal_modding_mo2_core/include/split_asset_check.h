@@ -0,0 +1,30 @@
+#pragma once
+
+#include "merged_vfs.h"
+
+#include <string>
+#include <vector>
+
+namespace mo2 {
+
+// One file of a split asset and the archive it resolves to
+struct SplitAssetMember {
+    std::string extension; // ".uasset", ".uexp", ...
+    ArchiveId archive;
+};
+
+// A split asset whose files come from more than one archive, e.g. the
+// .uasset of one mod paired with the .uexp of another. The game loads
+// them as one package, so this is almost always a broken load order.
+struct SplitAssetIssue {
+    std::string stem; // normalized path without the extension
+    std::vector<SplitAssetMember> members;
+};
+
+// Group the split-asset files of the merged VFS (.uasset/.umap, .uexp,
+// .ubulk, .uptnl) by stem and report every group that resolves to
+// different archives. One parallel pass over the entries, then one per
+// stem partition. Issues are sorted by stem.
+std::vector<SplitAssetIssue> find_split_asset_conflicts(const MergedVfs& vfs);
+
+} // namespace mo2
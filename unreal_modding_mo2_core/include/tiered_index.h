@@ -0,0 +1,121 @@
+#pragma once
+
+#include "archive_set.h"
+#include "bloom_filter.h"
+#include "flat_path_map.h"
+#include "vfs_cache.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace mo2 {
+
+// How much of an archive's index is kept in memory
+enum class IndexTier : uint8_t {
+    Hot,  // decoded listing plus a flat hash map for lookups
+    Warm, // listing front-coded into one compact buffer
+    Cold  // source and Bloom filter only; the listing is loaded again on use
+};
+
+struct ResidencyBudget {
+    // Decoded listings beyond this are compressed, least recently used first
+    size_t hot_bytes = size_t(256) << 20;
+
+    // Listings beyond this are dropped to their Bloom filter, least
+    // recently used first
+    size_t total_bytes = size_t(512) << 20;
+};
+
+// Bytes and archives per tier
+struct ResidencyStats {
+    size_t archives[3] = {};
+    size_t bytes[3] = {};
+};
+
+// The listings of a large library with bounded memory. Every archive keeps
+// its Bloom filter, so negative lookups never touch a listing, while the
+// listings themselves move between tiers under a global budget: using an
+// archive promotes it to hot, and the least recently used ones are demoted
+// when a tier runs over. Every archive stays queryable in every tier.
+// Thread-safe.
+//
+// The tiers hold ArchiveListings, the form the VFS and the cache share,
+// rather than each reader's own entry table; a reader reopened on demand
+// rebuilds its table from the archive anyway.
+class TieredIndexes {
+public:
+    // Lists a cold archive again; the default opens the archive itself
+    using Loader = std::function<ArchiveListing(const ArchiveSource&)>;
+
+    explicit TieredIndexes(ResidencyBudget budget = {}, Loader loader = load_listing);
+
+    // Add a listing, hot, and return its id
+    ArchiveId add(ArchiveListing listing);
+
+    size_t size() const;
+
+    // The listing, decoded or loaded if needed. Stays valid after the
+    // archive is demoted.
+    std::shared_ptr<const ArchiveListing> listing(ArchiveId archive);
+
+    // Entry id of a normalized path in an archive. Paths the Bloom filter
+    // rules out are answered without touching the listing.
+    std::optional<uint32_t> find(ArchiveId archive, std::string_view normalized_path);
+
+    // Bloom filter check only; never loads anything
+    bool may_contain(ArchiveId archive, std::string_view normalized_path) const;
+
+    IndexTier tier(ArchiveId archive) const;
+
+    void set_budget(ResidencyBudget budget);
+    ResidencyStats stats() const;
+
+private:
+    struct HotIndex {
+        ArchiveListing listing;
+        file_formats::FlatPathMap<uint32_t> entries; // path hash -> entry
+    };
+
+    struct Slot {
+        ArchiveSource source;
+        BloomFilter filter;
+        IndexTier tier = IndexTier::Hot;
+        std::shared_ptr<const HotIndex> hot;
+        std::string warm;
+        size_t bytes = 0; // of the current tier, filter included
+        std::list<ArchiveId>::iterator lru;
+    };
+
+    // Index a listing; `sorted_hashes` receives its path hashes, in order,
+    // for the Bloom filter
+    static std::shared_ptr<const HotIndex> make_hot(ArchiveListing listing, std::vector<uint64_t>& sorted_hashes);
+
+    std::shared_ptr<const HotIndex> promote(std::unique_lock<std::mutex>& lock, ArchiveId archive);
+    void set_tier(ArchiveId archive, IndexTier tier);
+    void enforce_budget(ArchiveId keep);
+
+    mutable std::mutex mutex_;
+    ResidencyBudget budget_;
+    Loader loader_;
+    std::vector<Slot> slots_;
+    std::list<ArchiveId> lru_[3]; // per tier, most recently used first
+    size_t bytes_[3] = {};
+};
+
+// A TieredIndexes::Loader that lists cold archives from the VFS cache at
+// `cache_file`, reading only their own record, while their fingerprint
+// still matches, and opens them otherwise. Loose directories are always
+// walked, as fingerprinting one walks it anyway.
+TieredIndexes::Loader cached_listing_loader(std::filesystem::path cache_file);
+
+} // namespace mo2
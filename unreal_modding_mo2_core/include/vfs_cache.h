@@ -0,0 +1,113 @@
+#pragma once
+
+#include "archive_set.h"
+#include "job_scheduler.h"
+#include "vfs_snapshot.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace mo2 {
+
+// An archive of the load order before it is opened: a .pak, a .utoc or a
+// mod's loose file directory
+struct ArchiveSource {
+    std::string name;
+    ArchiveKind kind = ArchiveKind::Pak;
+    std::filesystem::path source;
+};
+
+// Cheap identity of an archive's contents. For containers: the file's size
+// and mtime and a hash of its first and last 4 KiB, where the .utoc header
+// and the .pak footer live. For loose files: the file count, the newest
+// mtime and a hash of every path, size and mtime.
+struct ArchiveFingerprint {
+    uint64_t size = 0;
+    int64_t mtime_ns = 0;
+    uint64_t footer_hash = 0;
+
+    bool operator==(const ArchiveFingerprint&) const = default;
+};
+
+// Throws std::runtime_error or std::filesystem::filesystem_error if the
+// archive can't be read
+ArchiveFingerprint fingerprint_archive(const ArchiveSource& source);
+
+// Open an archive and list it. Throws like fingerprint_archive().
+ArchiveListing load_listing(const ArchiveSource& source);
+
+// An archive's index as of its fingerprint
+struct CachedArchive {
+    ArchiveFingerprint fingerprint;
+    std::shared_ptr<const VfsArchive> archive;
+};
+
+// Read the archives saved by save_vfs_cache(). The file is read in one go
+// and the archives use their hashed and sorted tables where they lie in
+// it, so nothing is decoded, hashed or sorted again. A missing, truncated,
+// damaged or outdated cache reads as empty; the cache is only ever a head
+// start.
+std::vector<CachedArchive> load_vfs_cache(const std::filesystem::path& file);
+
+// Read the record of one archive from a cache saved by save_vfs_cache(),
+// skipping the other archives' tables. nullopt if the archive isn't cached
+// or the cache is unusable.
+std::optional<CachedArchive> load_cached_archive(const std::filesystem::path& file, const ArchiveSource& source);
+
+// Write the archives' tables, replacing the file atomically. The layout is
+// native-endian; the cache belongs to the machine that wrote it.
+void save_vfs_cache(const std::filesystem::path& file, std::span<const CachedArchive> archives);
+
+// What revalidation found
+struct RevalidationReport {
+    size_t cached = 0;    // served from the cache at startup
+    size_t unchanged = 0; // cached listing still matched the archive
+    size_t reloaded = 0;  // changed or missing from the cache, listed again
+    size_t failed = 0;    // couldn't be read; left out of the VFS
+};
+
+// Stale-while-revalidate startup. The constructor publishes the VFS of the
+// load order straight from the cache, without touching any archive, so
+// lookups work immediately. A background job then fingerprints every
+// archive, each on the DeviceQueues queue of its drive, and submits one
+// job per archive that changed or was not cached to list it again. The
+// last of those publishes the corrected snapshot (sharing every leaf the
+// changes don't reach) and rewrites the cache.
+class CachedVfsStartup {
+public:
+    CachedVfsStartup(LiveVfs& vfs, JobScheduler& scheduler, std::filesystem::path cache_file,
+                     std::vector<ArchiveSource> load_order);
+
+    // Cancels the revalidation and waits for its jobs
+    ~CachedVfsStartup();
+
+    CachedVfsStartup(const CachedVfsStartup&) = delete;
+    CachedVfsStartup& operator=(const CachedVfsStartup&) = delete;
+
+    // Archives served from the cache at startup
+    size_t cached() const;
+
+    // Archives checked so far, out of the load order
+    JobProgress progress() const;
+
+    // Stop revalidating. Archives already listed again are not published.
+    void cancel() const;
+
+    // Waits for the revalidation and returns what it found. Rethrows if
+    // the cache couldn't be written.
+    RevalidationReport wait() const;
+
+private:
+    struct State;
+
+    std::shared_ptr<State> state_;
+    JobHandle revalidation_; // fingerprints, then fans the listing out
+};
+
+} // namespace mo2
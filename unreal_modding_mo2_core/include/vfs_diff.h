@@ -0,0 +1,28 @@
+#pragma once
+
+#include "merged_vfs.h"
+
+#include <utility>
+#include <vector>
+
+namespace mo2 {
+
+// What changes between two merged VFSes, e.g. the same game under two
+// profiles. Archives are matched across the two by name and source, so a
+// path whose winner is the same archive at a different load order position
+// counts as unchanged. Every list is sorted by path hash.
+struct VfsDiff {
+    std::vector<VfsEntry> added;   // entries of `to` with no path in `from`
+    std::vector<VfsEntry> removed; // entries of `from` with no path in `to`
+
+    // Paths in both whose winner is a different archive: (from, to)
+    std::vector<std::pair<VfsEntry, VfsEntry>> changed;
+
+    bool empty() const { return added.empty() && removed.empty() && changed.empty(); }
+};
+
+// Compare two merged VFSes with a linear merge of their sorted entries, one
+// hash range per task
+VfsDiff diff(const MergedVfs& from, const MergedVfs& to);
+
+} // namespace mo2
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "archive_set.h"
+#include "epoch.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mo2 {
+
+// An archive's listing with its paths hashed and bucketed by leaf, ready to
+// be merged into VFS snapshots. Immutable and shared by every snapshot that
+// mounts the archive.
+class VfsArchive {
+public:
+    // The index and the paths as flat arrays, the form they are cached in.
+    // Path i is path_chars[path_offsets[i], path_offsets[i + 1]); source
+    // paths are laid out the same way, and empty except for loose files.
+    struct Tables {
+        std::span<const uint64_t> hashes;      // sorted
+        std::span<const uint32_t> entries;     // entry id of each hash
+        std::span<const uint32_t> leaf_starts; // first hash of each leaf, plus the end
+        std::span<const uint64_t> path_offsets;
+        std::span<const char> path_chars;
+        std::span<const uint64_t> source_path_offsets;
+        std::span<const char> source_path_chars;
+    };
+
+    // Hash and sort the paths of a listing
+    static std::shared_ptr<const VfsArchive> index(ArchiveListing listing);
+
+    // Use tables built by index() earlier, such as ones read back from a
+    // cache, in place; `storage` keeps them alive. The tables are checked
+    // for consistency in one pass, without hashing or sorting anything.
+    // Returns nullptr if they don't hold together.
+    static std::shared_ptr<const VfsArchive> adopt(std::string name, ArchiveKind kind, std::filesystem::path source,
+                                                   const Tables& tables, std::shared_ptr<const void> storage);
+
+    // The same archive under another name, sharing the tables
+    std::shared_ptr<const VfsArchive> renamed(std::string name) const;
+
+    const std::string& name() const { return name_; }
+    ArchiveKind kind() const { return kind_; }
+    const std::filesystem::path& source() const { return source_; }
+    size_t size() const { return tables_.entries.size(); }
+    const Tables& tables() const { return tables_; }
+
+    std::string_view path(uint32_t entry) const {
+        return string_at(tables_.path_offsets, tables_.path_chars, entry);
+    }
+
+    // Loose files only: the entry's path under source() as found on disk
+    std::string_view source_path(uint32_t entry) const {
+        return string_at(tables_.source_path_offsets, tables_.source_path_chars, entry);
+    }
+
+    // Copy the paths back out into a listing
+    ArchiveListing listing() const;
+
+private:
+    friend class VfsSnapshot;
+
+    static std::string_view string_at(std::span<const uint64_t> offsets, std::span<const char> chars, uint32_t i) {
+        return {chars.data() + offsets[i], static_cast<size_t>(offsets[i + 1] - offsets[i])};
+    }
+
+    std::string name_;
+    ArchiveKind kind_ = ArchiveKind::Pak;
+    std::filesystem::path source_;
+    Tables tables_;
+    std::shared_ptr<const void> storage_; // what the tables point into
+};
+
+// The winning copy of one path in a snapshot
+struct SnapshotEntry {
+    uint64_t hash;
+    const VfsArchive* archive;
+    uint32_t entry;
+};
+
+// One immutable version of the merged VFS. The VFS is split into leaves on
+// the top bits of the path hash; a new version rebuilds only the leaves
+// whose contributing archives changed order and shares the rest with the
+// version before it.
+class VfsSnapshot {
+public:
+    static constexpr int LEAF_BITS = 12;
+    static constexpr size_t LEAF_COUNT = size_t(1) << LEAF_BITS;
+
+    // The leaf a path hash falls in
+    static size_t leaf_of(uint64_t hash) { return static_cast<size_t>(hash >> (64 - LEAF_BITS)); }
+
+    // Resolve every path of `load_order` (lowest priority first), reusing
+    // the leaves of `previous` that are unaffected
+    static std::unique_ptr<const VfsSnapshot> build(std::vector<std::shared_ptr<const VfsArchive>> load_order,
+                                                    const VfsSnapshot* previous = nullptr);
+
+    // Increases by one with every snapshot built from a previous one
+    uint64_t version() const { return version_; }
+
+    size_t size() const { return size_; }
+
+    // Mounted archives, lowest priority first
+    std::span<const std::shared_ptr<const VfsArchive>> archives() const { return archives_; }
+
+    // How many leaves were rebuilt rather than shared with the previous snapshot
+    size_t rebuilt_leaves() const { return rebuilt_leaves_; }
+
+    std::string_view path(const SnapshotEntry& entry) const {
+        return entry.archive->path(entry.entry);
+    }
+
+    // Look up a path that is already normalized
+    std::optional<SnapshotEntry> find(std::string_view normalized_path) const;
+
+private:
+    struct Leaf {
+        std::vector<const VfsArchive*> contributors; // archives with paths here, in load order
+        std::vector<SnapshotEntry> entries;          // winners, sorted by hash
+    };
+
+    static std::shared_ptr<const Leaf> build_leaf(size_t leaf, std::vector<const VfsArchive*> contributors);
+
+    std::vector<std::shared_ptr<const VfsArchive>> archives_;
+    std::vector<std::shared_ptr<const Leaf>> leaves_;
+    uint64_t version_ = 0;
+    size_t size_ = 0;
+    size_t rebuilt_leaves_ = 0;
+};
+
+// The merged VFS as it changes over time. Readers get the current snapshot
+// without taking a lock and keep it for as long as they hold the view, even
+// while a writer publishes newer versions.
+class LiveVfs {
+public:
+    // A pinned snapshot
+    class View {
+    public:
+        const VfsSnapshot& operator*() const { return *snapshot_; }
+        const VfsSnapshot* operator->() const { return snapshot_; }
+
+    private:
+        friend class LiveVfs;
+
+        View(EpochDomain::Guard guard, const VfsSnapshot* snapshot)
+            : guard_(std::move(guard)), snapshot_(snapshot) {}
+
+        EpochDomain::Guard guard_;
+        const VfsSnapshot* snapshot_;
+    };
+
+    LiveVfs();
+    ~LiveVfs();
+
+    LiveVfs(const LiveVfs&) = delete;
+    LiveVfs& operator=(const LiveVfs&) = delete;
+
+    // Pin and return the current snapshot; lock-free
+    View read() const;
+
+    // Build the snapshot for a new load order from the current one and
+    // publish it. Writers are serialized; readers are never blocked.
+    void publish(std::vector<std::shared_ptr<const VfsArchive>> load_order);
+
+private:
+    mutable EpochDomain epochs_;
+    std::atomic<const VfsSnapshot*> current_;
+    std::mutex writer_mutex_;
+};
+
+} // namespace mo2
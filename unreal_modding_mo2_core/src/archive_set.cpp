@@ -0,0 +1,44 @@
+#include "archive_set.h"
+#include "normalized_path.h"
+
+#include "pak_reader.h"
+#include "utoc_reader.h"
+
+namespace mo2 {
+
+ArchiveListing list_archive(const pak::PakReader& reader, std::string name, std::filesystem::path source) {
+    ArchiveListing listing;
+    listing.name = std::move(name);
+    listing.kind = ArchiveKind::Pak;
+    listing.source = std::move(source);
+
+    std::string mount_point = reader.mount_point();
+    std::vector<std::string> files = reader.files();
+    listing.paths.reserve(files.size());
+    for (const auto& file : files) {
+        listing.paths.push_back(normalize_path(mount_point, file));
+    }
+    return listing;
+}
+
+ArchiveListing list_archive(const utoc::UtocReader& reader, std::string name, std::filesystem::path source) {
+    ArchiveListing listing;
+    listing.name = std::move(name);
+    listing.kind = ArchiveKind::IoStore;
+    listing.source = std::move(source);
+
+    // Directory index paths already start with the mount point
+    std::vector<std::string> files = reader.GetAllFilePaths();
+    listing.paths.reserve(files.size());
+    for (const auto& file : files) {
+        listing.paths.push_back(normalize_path(file));
+    }
+    return listing;
+}
+
+ArchiveId ArchiveSet::add(ArchiveListing listing) {
+    archives_.push_back(std::move(listing));
+    return static_cast<ArchiveId>(archives_.size() - 1);
+}
+
+} // namespace mo2
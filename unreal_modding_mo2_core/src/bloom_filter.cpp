@@ -0,0 +1,40 @@
+#include "bloom_filter.h"
+
+namespace mo2 {
+
+BloomFilter BloomFilter::build(std::span<const uint64_t> hashes) {
+    BloomFilter filter;
+    size_t words = (hashes.size() * BITS_PER_KEY + 63) / 64;
+    filter.words_.assign(words == 0 ? 1 : words, 0);
+    filter.bit_count_ = filter.words_.size() * 64;
+    for (uint64_t hash : hashes) {
+        filter.add(hash);
+    }
+    return filter;
+}
+
+void BloomFilter::add(uint64_t hash) {
+    uint64_t low = static_cast<uint32_t>(hash);
+    uint64_t high = hash >> 32;
+    for (uint32_t i = 0; i < PROBES; ++i) {
+        uint64_t bit = (low + i * high) % bit_count_;
+        words_[bit / 64] |= uint64_t(1) << (bit % 64);
+    }
+}
+
+bool BloomFilter::may_contain(uint64_t hash) const {
+    if (bit_count_ == 0) {
+        return false;
+    }
+    uint64_t low = static_cast<uint32_t>(hash);
+    uint64_t high = hash >> 32;
+    for (uint32_t i = 0; i < PROBES; ++i) {
+        uint64_t bit = (low + i * high) % bit_count_;
+        if ((words_[bit / 64] & (uint64_t(1) << (bit % 64))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace mo2
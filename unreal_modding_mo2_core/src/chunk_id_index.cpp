@@ -0,0 +1,153 @@
+#include "chunk_id_index.h"
+#include "parallel.h"
+#include "path_partitions.h"
+
+#include "utoc_reader.h"
+
+#include <array>
+#include <bit>
+#include <cstring>
+
+namespace mo2 {
+
+namespace {
+    // Chunk ids are already well mixed in their first 8 bytes (a package
+    // id or a hash), but the index and type bytes must count too
+    uint64_t hash_chunk_id(const utoc::FIoChunkId& id) {
+        uint64_t low = 0;
+        uint32_t high = 0;
+        std::memcpy(&low, id.id, sizeof(low));
+        std::memcpy(&high, id.id + 8, sizeof(high));
+        uint64_t hash = low ^ (static_cast<uint64_t>(high) * 0x9E3779B97F4A7C15ull);
+        hash ^= hash >> 31;
+        hash *= 0xBF58476D1CE4E5B9ull;
+        hash ^= hash >> 29;
+        return hash;
+    }
+
+    struct ChunkOccurrence {
+        uint64_t hash;
+        ArchiveId container;
+        uint32_t chunk_index;
+    };
+}
+
+ChunkIdIndex ChunkIdIndex::build(std::span<const utoc::UtocReader* const> containers) {
+    using detail::PARTITION_COUNT;
+    const size_t container_count = containers.size();
+
+    // Hash every container's chunk ids and bucket them by partition
+    struct ContainerItems {
+        std::vector<ChunkOccurrence> items;
+        std::array<uint32_t, PARTITION_COUNT + 1> offsets{};
+    };
+    std::vector<ContainerItems> per_container(container_count);
+    file_formats::parallel_for(container_count, [&](size_t c) {
+        const auto& chunk_ids = containers[c]->GetChunkIds();
+        auto& result = per_container[c];
+
+        std::vector<uint64_t> hashes(chunk_ids.size());
+        std::array<uint32_t, PARTITION_COUNT> counts{};
+        for (size_t i = 0; i < chunk_ids.size(); ++i) {
+            hashes[i] = hash_chunk_id(chunk_ids[i]);
+            ++counts[detail::partition_of(hashes[i])];
+        }
+
+        for (size_t p = 0; p < PARTITION_COUNT; ++p) {
+            result.offsets[p + 1] = result.offsets[p] + counts[p];
+        }
+
+        result.items.resize(chunk_ids.size());
+        std::array<uint32_t, PARTITION_COUNT> cursor;
+        std::copy(result.offsets.begin(), result.offsets.end() - 1, cursor.begin());
+        for (size_t i = 0; i < chunk_ids.size(); ++i) {
+            result.items[cursor[detail::partition_of(hashes[i])]++] = {hashes[i], static_cast<ArchiveId>(c), static_cast<uint32_t>(i)};
+        }
+    });
+
+    // Fill each partition's table in load order, so later containers
+    // replace earlier ones
+    ChunkIdIndex index;
+    index.tables_.resize(PARTITION_COUNT);
+    std::vector<size_t> unique_counts(PARTITION_COUNT, 0);
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        size_t total = 0;
+        for (const auto& source : per_container) {
+            total += source.offsets[p + 1] - source.offsets[p];
+        }
+
+        auto& table = index.tables_[p];
+        table.slots.resize(std::bit_ceil(std::max<size_t>(total * 2, 2)));
+        table.mask = table.slots.size() - 1;
+        for (auto& slot : table.slots) {
+            slot.container = EMPTY_SLOT;
+        }
+
+        for (size_t c = 0; c < container_count; ++c) {
+            const auto& source = per_container[c];
+            const auto& chunk_ids = containers[c]->GetChunkIds();
+            for (uint32_t i = source.offsets[p]; i < source.offsets[p + 1]; ++i) {
+                const auto& occurrence = source.items[i];
+                const auto& id = chunk_ids[occurrence.chunk_index];
+                for (size_t s = occurrence.hash & table.mask;; s = (s + 1) & table.mask) {
+                    Slot& slot = table.slots[s];
+                    if (slot.container == EMPTY_SLOT) {
+                        std::memcpy(slot.id, id.id, sizeof(slot.id));
+                        slot.container = occurrence.container;
+                        slot.chunk_index = occurrence.chunk_index;
+                        slot.shadowed = 0;
+                        ++unique_counts[p];
+                        break;
+                    }
+                    if (std::memcmp(slot.id, id.id, sizeof(slot.id)) == 0) {
+                        // A container can list the same chunk id twice;
+                        // that's not an override
+                        if (slot.container != occurrence.container) {
+                            ++slot.shadowed;
+                        }
+                        slot.container = occurrence.container;
+                        slot.chunk_index = occurrence.chunk_index;
+                        break;
+                    }
+                }
+            }
+        }
+    });
+
+    for (size_t count : unique_counts) {
+        index.size_ += count;
+    }
+    return index;
+}
+
+const ChunkIdIndex::Slot* ChunkIdIndex::find_slot(const utoc::FIoChunkId& id) const {
+    if (tables_.empty()) {
+        return nullptr;
+    }
+    uint64_t hash = hash_chunk_id(id);
+    const auto& table = tables_[detail::partition_of(hash)];
+    for (size_t s = hash & table.mask;; s = (s + 1) & table.mask) {
+        const Slot& slot = table.slots[s];
+        if (slot.container == EMPTY_SLOT) {
+            return nullptr;
+        }
+        if (std::memcmp(slot.id, id.id, sizeof(slot.id)) == 0) {
+            return &slot;
+        }
+    }
+}
+
+std::optional<ChunkLocation> ChunkIdIndex::find(const utoc::FIoChunkId& id) const {
+    const Slot* slot = find_slot(id);
+    if (!slot) {
+        return std::nullopt;
+    }
+    return ChunkLocation{slot->container, slot->chunk_index, slot->shadowed};
+}
+
+bool ChunkIdIndex::is_conflicted(const utoc::FIoChunkId& id) const {
+    const Slot* slot = find_slot(id);
+    return slot && slot->shadowed > 0;
+}
+
+} // namespace mo2
@@ -0,0 +1,220 @@
+#include "container_set.h"
+#include "normalized_path.h"
+
+#include "pak_reader.h"
+#include "utoc_reader.h"
+
+#include <algorithm>
+#include <cctype>
+#include <future>
+#include <iterator>
+#include <map>
+
+namespace mo2 {
+
+namespace {
+    // Extension of a container part, lower case
+    std::string part_extension(const std::filesystem::path& path) {
+        std::string extension = path.extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        return extension;
+    }
+
+    // Record `path` as the matching part of `paths`; false if it's not a part
+    bool assign_part(ContainerPaths& paths, const std::filesystem::path& path) {
+        std::string extension = part_extension(path);
+        if (extension == ".pak") {
+            paths.pak = path;
+        } else if (extension == ".utoc") {
+            paths.utoc = path;
+        } else if (extension == ".ucas") {
+            paths.ucas = path;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    struct ListedFile {
+        uint64_t hash;
+        std::string path;
+        ContainerFile location;
+    };
+
+    std::vector<ListedFile> list_pak(const pak::PakReader& reader) {
+        std::string mount_point = reader.mount_point();
+        std::vector<std::string> files = reader.files();
+        std::vector<std::string_view> views(files.begin(), files.end());
+        std::vector<const pak::Entry*> entries = reader.find_many(views);
+
+        std::vector<ListedFile> listed;
+        listed.reserve(files.size());
+        for (size_t i = 0; i < files.size(); ++i) {
+            std::string path = normalize_path(mount_point, files[i]);
+            uint64_t hash = hash_path(path);
+            listed.push_back({hash, std::move(path), {entries[i], std::nullopt}});
+        }
+        return listed;
+    }
+
+    std::vector<ListedFile> list_utoc(const utoc::UtocReader& reader) {
+        std::vector<ListedFile> listed;
+        reader.GetDirectoryIndex().ForEachFile([&listed](const std::string& file, uint32_t chunk_index) {
+            std::string path = normalize_path(file);
+            uint64_t hash = hash_path(path);
+            listed.push_back({hash, std::move(path), {nullptr, chunk_index}});
+        });
+        return listed;
+    }
+}
+
+ContainerException::ContainerException(const std::string& message)
+    : std::runtime_error(message) {}
+
+ContainerPaths discover_container(const std::filesystem::path& member) {
+    ContainerPaths paths;
+    paths.name = member.stem().string();
+
+    std::filesystem::path stem = member;
+    for (const char* extension : {".pak", ".utoc", ".ucas"}) {
+        std::filesystem::path candidate = stem.replace_extension(extension);
+        if (std::filesystem::is_regular_file(candidate)) {
+            assign_part(paths, candidate);
+        }
+    }
+    return paths;
+}
+
+std::vector<ContainerPaths> discover_containers(const std::filesystem::path& directory) {
+    std::map<std::string, ContainerPaths> by_name;
+    for (const auto& item : std::filesystem::directory_iterator(directory)) {
+        if (!item.is_regular_file()) {
+            continue;
+        }
+        std::string name = item.path().stem().string();
+        ContainerPaths candidate;
+        candidate.name = name;
+        if (auto it = by_name.find(name); it != by_name.end()) {
+            candidate = it->second;
+        }
+        if (assign_part(candidate, item.path())) {
+            by_name[name] = std::move(candidate);
+        }
+    }
+
+    std::vector<ContainerPaths> result;
+    result.reserve(by_name.size());
+    for (auto& [name, paths] : by_name) {
+        result.push_back(std::move(paths));
+    }
+    return result;
+}
+
+ContainerSet ContainerSet::open(const std::filesystem::path& member) {
+    return open(discover_container(member));
+}
+
+ContainerSet ContainerSet::open(ContainerPaths paths) {
+    if (!paths.pak && !paths.utoc) {
+        throw ContainerException("No .pak or .utoc found for container: " + paths.name);
+    }
+    if (paths.utoc && !paths.ucas) {
+        throw ContainerException("Missing .ucas next to: " + paths.utoc->string());
+    }
+
+    ContainerSet set;
+    set.paths_ = std::move(paths);
+
+    // Open and list each part on its own thread
+    std::future<std::vector<ListedFile>> pak_files;
+    std::future<std::vector<ListedFile>> utoc_files;
+    if (set.paths_.pak) {
+        pak_files = std::async(std::launch::async, [&set]() {
+            try {
+                set.pak_ = std::make_unique<pak::PakReader>(*set.paths_.pak);
+            } catch (const pak::PakException& e) {
+                throw ContainerException("Failed to open pak: " + set.paths_.pak->string() + ": " + e.what());
+            }
+            return list_pak(*set.pak_);
+        });
+    }
+    if (set.paths_.utoc) {
+        utoc_files = std::async(std::launch::async, [&set]() {
+            auto reader = std::make_unique<utoc::UtocReader>();
+            if (!reader->Open(*set.paths_.utoc)) {
+                throw ContainerException("Failed to open utoc: " + set.paths_.utoc->string());
+            }
+            set.utoc_ = std::move(reader);
+            return list_utoc(*set.utoc_);
+        });
+    }
+
+    std::vector<ListedFile> listed;
+    std::exception_ptr error;
+    for (auto* part : {&utoc_files, &pak_files}) {
+        if (!part->valid()) {
+            continue;
+        }
+        try {
+            auto files = part->get();
+            std::move(files.begin(), files.end(), std::back_inserter(listed));
+        } catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // IoStore files were listed first, so the stable sort keeps them ahead
+    // of a .pak copy of the same path
+    std::stable_sort(listed.begin(), listed.end(), [](const ListedFile& x, const ListedFile& y) {
+        if (x.hash != y.hash) {
+            return x.hash < y.hash;
+        }
+        return x.path < y.path;
+    });
+
+    set.hashes_.reserve(listed.size());
+    set.files_.reserve(listed.size());
+    set.locations_.reserve(listed.size());
+    for (size_t i = 0; i < listed.size(); ++i) {
+        if (i > 0 && listed[i].hash == listed[i - 1].hash && listed[i].path == listed[i - 1].path) {
+            continue;
+        }
+        set.hashes_.push_back(listed[i].hash);
+        set.files_.push_back(std::move(listed[i].path));
+        set.locations_.push_back(listed[i].location);
+    }
+    return set;
+}
+
+ContainerSet::ContainerSet(ContainerSet&&) noexcept = default;
+ContainerSet& ContainerSet::operator=(ContainerSet&&) noexcept = default;
+ContainerSet::~ContainerSet() = default;
+
+std::optional<ContainerFile> ContainerSet::find(std::string_view normalized_path) const {
+    uint64_t hash = hash_path(normalized_path);
+    auto it = std::lower_bound(hashes_.begin(), hashes_.end(), hash);
+    for (; it != hashes_.end() && *it == hash; ++it) {
+        size_t index = static_cast<size_t>(it - hashes_.begin());
+        if (files_[index] == normalized_path) {
+            return locations_[index];
+        }
+    }
+    return std::nullopt;
+}
+
+ArchiveListing ContainerSet::listing() const {
+    ArchiveListing listing;
+    listing.name = paths_.name;
+    listing.kind = utoc_ ? ArchiveKind::IoStore : ArchiveKind::Pak;
+    listing.source = utoc_ ? *paths_.utoc : *paths_.pak;
+    listing.paths = files_;
+    return listing;
+}
+
+} // namespace mo2
@@ -0,0 +1,525 @@
+#include "deploy.h"
+#include "normalized_path.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+namespace mo2 {
+
+namespace {
+    constexpr std::string_view MANIFEST_HEADER = "mo2-deploy-manifest 1";
+
+    // Files that make up a container, besides the one in the listing
+    constexpr std::string_view ARCHIVE_EXTENSIONS[] = {".pak", ".utoc", ".ucas", ".sig"};
+
+    // Suffix of files being placed, before they are renamed into place
+    constexpr std::string_view TEMPORARY_SUFFIX = ".mo2_deploy_tmp";
+
+    struct FileMetadata {
+        uint64_t size;
+        int64_t mtime_ns;
+    };
+
+    std::optional<FileMetadata> stat_file(const std::filesystem::path& file) {
+#ifdef __linux__
+        struct stat status;
+        if (::stat(file.c_str(), &status) != 0 || !S_ISREG(status.st_mode)) {
+            return std::nullopt;
+        }
+        return FileMetadata{static_cast<uint64_t>(status.st_size),
+                            status.st_mtim.tv_sec * 1000000000ll + status.st_mtim.tv_nsec};
+#else
+        std::error_code error;
+        if (!std::filesystem::is_regular_file(file, error)) {
+            return std::nullopt;
+        }
+        auto mtime = std::chrono::clock_cast<std::chrono::system_clock>(std::filesystem::last_write_time(file, error));
+        return FileMetadata{std::filesystem::file_size(file, error),
+                            std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count()};
+#endif
+    }
+
+    // Targets keep the case they have on disk, so nothing has stripped a
+    // leading '/' or a ".." from them; either would leave the deploy directory
+    bool is_safe_target(std::string_view target) {
+        if (target.empty() || target.front() == '/') {
+            return false;
+        }
+        size_t start = 0;
+        while (start <= target.size()) {
+            size_t end = std::min(target.find('/', start), target.size());
+            if (target.substr(start, end - start) == "..") {
+                return false;
+            }
+            start = end + 1;
+        }
+        return true;
+    }
+
+    bool same_source(const DeployItem& a, const DeployItem& b) {
+        return a.size == b.size && a.mtime_ns == b.mtime_ns && a.source == b.source;
+    }
+
+#ifdef __linux__
+    std::filesystem::filesystem_error error_from_errno(const char* what, const std::filesystem::path& file) {
+        return std::filesystem::filesystem_error(what, file, std::error_code(errno, std::generic_category()));
+    }
+
+    // Clone the source's extents into a new file; false if the file system
+    // can't share extents between the two
+    bool reflink_file(const std::filesystem::path& source, const std::filesystem::path& target) {
+        int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            throw error_from_errno("Failed to open deploy source", source);
+        }
+        int out = open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (out < 0) {
+            auto error = error_from_errno("Failed to create deployed file", target);
+            close(in);
+            throw error;
+        }
+        bool cloned = ioctl(out, FICLONE, in) == 0;
+        close(out);
+        close(in);
+        if (!cloned) {
+            unlink(target.c_str());
+        }
+        return cloned;
+    }
+
+    // Copy in the kernel with copy_file_range, falling back to read/write
+    // where the file systems don't support it
+    void copy_contents(const std::filesystem::path& source, const std::filesystem::path& target) {
+        int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0) {
+            throw error_from_errno("Failed to open deploy source", source);
+        }
+        int out = open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (out < 0) {
+            auto error = error_from_errno("Failed to create deployed file", target);
+            close(in);
+            throw error;
+        }
+
+        auto fail = [&](const char* what, const std::filesystem::path& file) {
+            auto error = error_from_errno(what, file);
+            close(out);
+            close(in);
+            unlink(target.c_str());
+            throw error;
+        };
+
+        bool in_kernel = true;
+        for (;;) {
+            ssize_t copied = in_kernel ? copy_file_range(in, nullptr, out, nullptr, 1 << 30, 0) : -1;
+            if (copied < 0 && in_kernel &&
+                (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                in_kernel = false;
+            }
+            if (!in_kernel) {
+                char buffer[256 * 1024];
+                copied = read(in, buffer, sizeof(buffer));
+                if (copied < 0) {
+                    fail("Failed to read deploy source", source);
+                }
+                for (ssize_t written = 0; written < copied;) {
+                    ssize_t count = write(out, buffer + written, static_cast<size_t>(copied - written));
+                    if (count < 0) {
+                        fail("Failed to write deployed file", target);
+                    }
+                    written += count;
+                }
+            }
+            if (copied < 0) {
+                fail("Failed to copy deploy source", source);
+            }
+            if (copied == 0) {
+                break;
+            }
+        }
+        close(out);
+        close(in);
+    }
+#else
+    bool reflink_file(const std::filesystem::path&, const std::filesystem::path&) {
+        return false;
+    }
+
+    void copy_contents(const std::filesystem::path& source, const std::filesystem::path& target) {
+        std::filesystem::copy_file(source, target);
+    }
+#endif
+
+    // Create the file at `temporary` with the preferred method or its fallbacks
+    DeployMethod materialize(const std::filesystem::path& source, const std::filesystem::path& temporary,
+                             DeployMethod method) {
+        if (method == DeployMethod::Hardlink) {
+            std::error_code error;
+            std::filesystem::create_hard_link(source, temporary, error);
+            if (!error) {
+                return DeployMethod::Hardlink;
+            }
+        }
+        if (method != DeployMethod::Copy && reflink_file(source, temporary)) {
+            return DeployMethod::Reflink;
+        }
+        copy_contents(source, temporary);
+        return DeployMethod::Copy;
+    }
+
+    // Place one file, replacing whatever is at the target atomically
+    DeployMethod place_file(const DeployItem& item, const std::filesystem::path& target, DeployMethod method) {
+        std::filesystem::path temporary = target;
+        temporary += TEMPORARY_SUFFIX;
+
+        std::error_code ignored;
+        std::filesystem::remove(temporary, ignored); // left over from an interrupted deploy
+
+        DeployMethod used = materialize(item.source, temporary, method);
+        std::error_code error;
+        std::filesystem::rename(temporary, target, error);
+        if (error) {
+            std::filesystem::remove(temporary, ignored);
+            throw std::filesystem::filesystem_error("Failed to move deployed file into place", temporary, target, error);
+        }
+        if (used == DeployMethod::Hardlink) {
+            // Renaming a link over another link to the same file is a no-op
+            // that leaves both names
+            std::filesystem::remove(temporary, ignored);
+        }
+        return used;
+    }
+}
+
+DeployManifest DeployManifest::load(const std::filesystem::path& file) {
+    DeployManifest manifest;
+    std::ifstream stream(file, std::ios::binary);
+    if (!stream) {
+        return manifest;
+    }
+
+    std::string line;
+    if (!std::getline(stream, line) || line != MANIFEST_HEADER) {
+        throw std::runtime_error("Not a deploy manifest: " + file.string());
+    }
+
+    // method \t size \t mtime \t target \t source
+    while (std::getline(stream, line)) {
+        std::string_view fields[5];
+        size_t start = 0;
+        for (size_t i = 0; i < 5; ++i) {
+            size_t end = i < 4 ? line.find('\t', start) : line.size();
+            if (end == std::string::npos) {
+                throw std::runtime_error("Malformed deploy manifest: " + file.string());
+            }
+            fields[i] = std::string_view(line).substr(start, end - start);
+            start = end + 1;
+        }
+
+        DeployItem item;
+        unsigned method = 0;
+        auto parse = [&](std::string_view field, auto& value) {
+            auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+            if (result.ec != std::errc() || result.ptr != field.data() + field.size()) {
+                throw std::runtime_error("Malformed deploy manifest: " + file.string());
+            }
+        };
+        parse(fields[0], method);
+        parse(fields[1], item.size);
+        parse(fields[2], item.mtime_ns);
+        if (method > static_cast<unsigned>(DeployMethod::Copy)) {
+            throw std::runtime_error("Malformed deploy manifest: " + file.string());
+        }
+        item.method = static_cast<DeployMethod>(method);
+        item.target = fields[3];
+        item.source = std::filesystem::path(std::string(fields[4]));
+        manifest.items.push_back(std::move(item));
+    }
+
+    std::sort(manifest.items.begin(), manifest.items.end(),
+              [](const DeployItem& a, const DeployItem& b) { return a.target < b.target; });
+    return manifest;
+}
+
+void DeployManifest::save(const std::filesystem::path& file) const {
+    std::filesystem::path temporary = file;
+    temporary += TEMPORARY_SUFFIX;
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        if (!stream) {
+            throw std::runtime_error("Failed to write deploy manifest: " + temporary.string());
+        }
+        stream << MANIFEST_HEADER << '\n';
+        for (const auto& item : items) {
+            std::string source = item.source.string();
+            if (item.target.find_first_of("\t\n") != std::string::npos ||
+                source.find_first_of("\t\n") != std::string::npos) {
+                throw std::runtime_error("Can't record a path with tabs or line breaks: " + item.target);
+            }
+            stream << static_cast<unsigned>(item.method) << '\t' << item.size << '\t' << item.mtime_ns << '\t'
+                   << item.target << '\t' << source << '\n';
+        }
+        if (!stream.flush()) {
+            throw std::runtime_error("Failed to write deploy manifest: " + temporary.string());
+        }
+    }
+    std::filesystem::rename(temporary, file);
+}
+
+DeployManifest desired_state(const MergedVfs& vfs, std::string_view archive_directory) {
+    // Files are compared by normalized path, as the VFS resolves them, but
+    // deployed under the names they have on disk
+    struct Candidate {
+        std::string key;
+        DeployItem item;
+        bool required; // loose files must exist; companions are optional
+        bool found = false;
+    };
+    const ArchiveSet& archives = vfs.archives();
+    std::vector<Candidate> candidates;
+
+    for (const auto& entry : vfs.entries()) {
+        const ArchiveListing& listing = archives[entry.archive];
+        const std::string& path = listing.paths[entry.entry];
+        if (listing.kind != ArchiveKind::Loose) {
+            continue;
+        }
+        const std::string& on_disk = listing.source_paths.empty() ? path : listing.source_paths[entry.entry];
+        if (is_safe_target(path) && is_safe_target(on_disk)) {
+            candidates.push_back({path, {on_disk, listing.source / on_disk}, true});
+        }
+    }
+
+    std::string prefix(archive_directory);
+    std::replace(prefix.begin(), prefix.end(), '\\', '/');
+    if (!prefix.empty() && prefix.back() != '/') {
+        prefix.push_back('/');
+    }
+    for (const auto& listing : archives.archives()) {
+        if (listing.kind == ArchiveKind::Loose) {
+            continue;
+        }
+        for (std::string_view extension : ARCHIVE_EXTENSIONS) {
+            std::filesystem::path companion = listing.source;
+            companion.replace_extension(extension);
+            std::string target = prefix + companion.filename().string();
+            if (is_safe_target(target)) {
+                std::string key = normalize_path(target);
+                candidates.push_back({std::move(key), {std::move(target), std::move(companion)}, false});
+            }
+        }
+    }
+
+    file_formats::parallel_for(candidates.size(), [&](size_t i) {
+        Candidate& candidate = candidates[i];
+        auto metadata = stat_file(candidate.item.source);
+        if (metadata) {
+            candidate.item.size = metadata->size;
+            candidate.item.mtime_ns = metadata->mtime_ns;
+            candidate.found = true;
+        } else if (candidate.required) {
+            throw std::filesystem::filesystem_error("Deploy source is missing", candidate.item.source,
+                                                    std::make_error_code(std::errc::no_such_file_or_directory));
+        }
+    });
+
+    // Archives come after loose files and in load order, so when two files
+    // claim a path the last one wins
+    std::erase_if(candidates, [](const Candidate& candidate) { return !candidate.found; });
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate& a, const Candidate& b) { return a.key < b.key; });
+    auto last = std::unique(candidates.rbegin(), candidates.rend(),
+                            [](const Candidate& a, const Candidate& b) { return a.key == b.key; });
+    candidates.erase(candidates.begin(), last.base());
+
+    DeployManifest desired;
+    desired.items.reserve(candidates.size());
+    for (auto& candidate : candidates) {
+        desired.items.push_back(std::move(candidate.item));
+    }
+    std::sort(desired.items.begin(), desired.items.end(),
+              [](const DeployItem& a, const DeployItem& b) { return a.target < b.target; });
+    return desired;
+}
+
+DeployPlan plan_deployment(const DeployManifest& desired, const DeployManifest& deployed) {
+    DeployPlan plan;
+    const auto& want = desired.items;
+    const auto& have = deployed.items;
+    size_t w = 0;
+    size_t h = 0;
+    while (w < want.size() || h < have.size()) {
+        if (h == have.size() || (w < want.size() && want[w].target < have[h].target)) {
+            plan.added.push_back(w++);
+        } else if (w == want.size() || have[h].target < want[w].target) {
+            plan.removed.push_back(h++);
+        } else {
+            if (same_source(want[w], have[h])) {
+                ++plan.unchanged;
+            } else {
+                plan.replaced.emplace_back(w, h);
+            }
+            ++w;
+            ++h;
+        }
+    }
+    return plan;
+}
+
+DeployReport deploy(const std::filesystem::path& directory, const DeployManifest& desired,
+                    const DeployOptions& options) {
+    const std::filesystem::path manifest_file = directory / DEPLOY_MANIFEST_NAME;
+    DeployManifest deployed = DeployManifest::load(manifest_file);
+    DeployPlan plan = plan_deployment(desired, deployed);
+
+    DeployReport report;
+    report.unchanged = plan.unchanged;
+    if (plan.empty()) {
+        return report;
+    }
+
+    // One change per file: removals, then additions, then replacements
+    struct Change {
+        const DeployItem* item;
+        bool remove;
+        bool done = false;
+        DeployMethod method = DeployMethod::Copy;
+    };
+    std::vector<Change> changes;
+    changes.reserve(plan.removed.size() + plan.added.size() + plan.replaced.size());
+    for (size_t h : plan.removed) {
+        changes.push_back({&deployed.items[h], true});
+    }
+    for (size_t w : plan.added) {
+        changes.push_back({&desired.items[w], false});
+    }
+    for (auto [w, h] : plan.replaced) {
+        changes.push_back({&desired.items[w], false});
+    }
+
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    auto fail = [&]() {
+        std::lock_guard lock(error_mutex);
+        if (!error) {
+            error = std::current_exception();
+        }
+    };
+    auto apply = [&](size_t first, size_t count) {
+        file_formats::parallel_for(count, [&](size_t i) {
+            Change& change = changes[first + i];
+            std::filesystem::path target = directory / change.item->target;
+            try {
+                if (change.remove) {
+                    std::filesystem::remove(target);
+                } else {
+                    change.method = place_file(*change.item, target, options.method);
+                }
+                change.done = true;
+            } catch (...) {
+                fail();
+            }
+        });
+    };
+
+    // Removals go first, so a file can take the place of a directory that
+    // is no longer wanted and the other way around
+    std::filesystem::create_directories(directory);
+    apply(0, plan.removed.size());
+
+    // Prune directories emptied by removals, deepest first
+    std::set<std::filesystem::path> emptied;
+    for (size_t i = 0; i < plan.removed.size(); ++i) {
+        if (changes[i].done) {
+            for (auto parent = std::filesystem::path(changes[i].item->target).parent_path(); !parent.empty();
+                 parent = parent.parent_path()) {
+                emptied.insert(parent);
+            }
+        }
+    }
+    for (auto it = emptied.rbegin(); it != emptied.rend(); ++it) {
+        std::error_code ignored;
+        std::filesystem::remove(directory / *it, ignored); // fails unless empty
+    }
+
+    // Create directories before placing files so the workers don't race on
+    // them; a file that can't get its directory fails when it is placed
+    std::set<std::filesystem::path> parents;
+    for (size_t i = plan.removed.size(); i < changes.size(); ++i) {
+        parents.insert((directory / changes[i].item->target).parent_path());
+    }
+    for (const auto& parent : parents) {
+        std::error_code ignored;
+        std::filesystem::create_directories(parent, ignored);
+    }
+    apply(plan.removed.size(), changes.size() - plan.removed.size());
+
+    // Record what is actually on disk now
+    std::vector<char> keep(deployed.items.size(), 1);
+    std::vector<DeployItem> items;
+    size_t index = 0;
+    for (size_t h : plan.removed) {
+        if (changes[index++].done) {
+            keep[h] = 0;
+            ++report.removed;
+        }
+    }
+    auto record = [&](const Change& change) {
+        DeployItem item = *change.item;
+        item.method = change.method;
+        switch (change.method) {
+            case DeployMethod::Reflink: ++report.reflinked; break;
+            case DeployMethod::Hardlink: ++report.hardlinked; break;
+            case DeployMethod::Copy: ++report.copied; break;
+        }
+        items.push_back(std::move(item));
+    };
+    for (size_t w = 0; w < plan.added.size(); ++w) {
+        if (changes[index++].done) {
+            record(changes[index - 1]);
+            ++report.added;
+        }
+    }
+    for (auto [w, h] : plan.replaced) {
+        if (changes[index++].done) {
+            record(changes[index - 1]);
+            keep[h] = 0;
+            ++report.replaced;
+        }
+    }
+    for (size_t h = 0; h < deployed.items.size(); ++h) {
+        if (keep[h]) {
+            items.push_back(std::move(deployed.items[h]));
+        }
+    }
+    std::sort(items.begin(), items.end(), [](const DeployItem& a, const DeployItem& b) { return a.target < b.target; });
+
+    DeployManifest manifest;
+    manifest.items = std::move(items);
+    manifest.save(manifest_file);
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return report;
+}
+
+} // namespace mo2
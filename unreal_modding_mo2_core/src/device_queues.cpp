@@ -0,0 +1,256 @@
+#include "device_queues.h"
+
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <optional>
+#include <thread>
+#include <utility>
+
+#ifdef _WIN32
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#endif
+
+namespace mo2 {
+
+namespace {
+#ifdef __linux__
+    // Read /sys/dev/block/<major>:<minor>/..., falling back to the parent
+    // device for partitions, which have no queue directory of their own
+    std::optional<std::string> read_sysfs(const std::filesystem::path& device, const std::string& attribute) {
+        for (const auto& candidate : {device / attribute, device / ".." / attribute}) {
+            std::ifstream file(candidate);
+            std::string value;
+            if (file && std::getline(file, value)) {
+                return value;
+            }
+        }
+        return std::nullopt;
+    }
+
+    DeviceKind kind_of(const std::filesystem::path& device, int depth = 0) {
+        std::error_code error;
+        std::filesystem::path resolved = std::filesystem::canonical(device, error);
+        if (error) {
+            return DeviceKind::Unknown;
+        }
+
+        // Device-mapper and md devices take the kind of what they sit on
+        std::filesystem::path slaves = resolved / "slaves";
+        if (depth < 4 && std::filesystem::is_directory(slaves, error)) {
+            for (const auto& slave : std::filesystem::directory_iterator(slaves, error)) {
+                return kind_of(slave.path(), depth + 1);
+            }
+        }
+
+        std::string name = resolved.filename().string();
+        auto rotational = read_sysfs(resolved, "queue/rotational");
+        if (!rotational) {
+            return DeviceKind::Unknown;
+        }
+        if (*rotational == "1") {
+            return DeviceKind::Rotational;
+        }
+        return name.starts_with("nvme") ? DeviceKind::Nvme : DeviceKind::Ssd;
+    }
+#endif
+
+    // st_dev of a file, or nullopt if it can't be stat'ed
+    std::optional<uint64_t> device_id(const std::filesystem::path& file) {
+#ifdef _WIN32
+        struct _stat64 status;
+        if (_wstat64(file.c_str(), &status) != 0) {
+            return std::nullopt;
+        }
+#else
+        struct stat status;
+        if (stat(file.c_str(), &status) != 0) {
+            return std::nullopt;
+        }
+#endif
+        return static_cast<uint64_t>(status.st_dev);
+    }
+
+    // Look up what kind of device an st_dev is
+    DeviceInfo describe_device(uint64_t id) {
+        DeviceInfo info;
+        info.id = id;
+#ifdef __linux__
+        dev_t dev = static_cast<dev_t>(id);
+        std::filesystem::path device = "/sys/dev/block/" + std::to_string(major(dev)) + ":" + std::to_string(minor(dev));
+        std::error_code error;
+        if (std::filesystem::exists(device, error)) {
+            info.kind = kind_of(device);
+            info.name = std::filesystem::canonical(device, error).filename().string();
+        }
+#endif
+        return info;
+    }
+}
+
+DeviceInfo identify_device(const std::filesystem::path& file) {
+    auto id = device_id(file);
+    return id ? describe_device(*id) : DeviceInfo{};
+}
+
+DevicePolicy policy_for(DeviceKind kind) {
+    switch (kind) {
+        case DeviceKind::Nvme: return {32, false};
+        case DeviceKind::Ssd: return {8, false};
+        case DeviceKind::Rotational: return {1, true};
+        case DeviceKind::Unknown: break;
+    }
+    return {4, false};
+}
+
+struct DeviceQueues::Device {
+    DeviceInfo info;
+    DevicePolicy policy;
+
+    // Pending requests; FIFO, or kept in (file, offset) order for an elevator
+    std::deque<Request> fifo;
+    std::multimap<std::pair<std::filesystem::path, uint64_t>, Request> sorted;
+    std::pair<std::filesystem::path, uint64_t> head; // position of the last request served
+
+    std::vector<std::thread> workers;
+    std::condition_variable ready;
+    bool stopping = false;
+
+    bool empty() const { return fifo.empty() && sorted.empty(); }
+};
+
+DeviceQueues::DeviceQueues() = default;
+
+DeviceQueues::~DeviceQueues() {
+    try {
+        wait();
+    } catch (...) {
+    }
+
+    {
+        std::lock_guard lock(mutex_);
+        for (auto& [id, device] : devices_) {
+            device->stopping = true;
+            device->ready.notify_all();
+        }
+    }
+    for (auto& [id, device] : devices_) {
+        for (auto& worker : device->workers) {
+            worker.join();
+        }
+    }
+}
+
+DeviceQueues::Device& DeviceQueues::device_of(const std::filesystem::path& file) {
+    // Every submit pays for a stat; the sysfs walk only runs for a device
+    // not seen before, and outside the lock
+    auto id = device_id(file);
+    uint64_t key = id.value_or(0);
+    {
+        std::lock_guard lock(mutex_);
+        auto it = devices_.find(key);
+        if (it != devices_.end()) {
+            return *it->second;
+        }
+    }
+    DeviceInfo info = id ? describe_device(*id) : DeviceInfo{};
+
+    std::lock_guard lock(mutex_);
+    auto& device = devices_[key];
+    if (!device) {
+        device = std::make_unique<Device>();
+        device->info = info;
+        device->policy = policy_for(info.kind);
+        for (size_t i = 0; i < device->policy.queue_depth; ++i) {
+            device->workers.emplace_back([this, raw = device.get()]() { work(*raw); });
+        }
+    }
+    return *device;
+}
+
+void DeviceQueues::submit(const std::filesystem::path& file, uint64_t offset, std::function<void()> work) {
+    Device& device = device_of(file);
+
+    std::lock_guard lock(mutex_);
+    Request request{file, offset, std::move(work)};
+    if (device.policy.sort_by_offset) {
+        device.sorted.emplace(std::make_pair(file, offset), std::move(request));
+    } else {
+        device.fifo.push_back(std::move(request));
+    }
+    ++outstanding_;
+    device.ready.notify_one();
+}
+
+void DeviceQueues::wait() {
+    std::unique_lock lock(mutex_);
+    idle_.wait(lock, [&]() { return outstanding_ == 0; });
+    if (error_) {
+        std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+}
+
+std::vector<DeviceInfo> DeviceQueues::devices() const {
+    std::lock_guard lock(mutex_);
+    std::vector<DeviceInfo> result;
+    for (const auto& [id, device] : devices_) {
+        result.push_back(device->info);
+    }
+    return result;
+}
+
+void DeviceQueues::work(Device& device) {
+    std::unique_lock lock(mutex_);
+    for (;;) {
+        device.ready.wait(lock, [&]() { return device.stopping || !device.empty(); });
+        if (device.empty()) {
+            return;
+        }
+
+        Request request;
+        if (device.policy.sort_by_offset) {
+            // Sweep forward from the last position, wrapping to the start
+            auto it = device.sorted.lower_bound(device.head);
+            if (it == device.sorted.end()) {
+                it = device.sorted.begin();
+            }
+            device.head = it->first;
+            request = std::move(it->second);
+            device.sorted.erase(it);
+        } else {
+            request = std::move(device.fifo.front());
+            device.fifo.pop_front();
+        }
+
+        lock.unlock();
+        std::exception_ptr error;
+        try {
+            request.work();
+        } catch (...) {
+            error = std::current_exception();
+        }
+        lock.lock();
+
+        if (error && !error_) {
+            error_ = error;
+        }
+        if (--outstanding_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
+
+void for_each_file_by_device(std::span<const std::filesystem::path> files,
+                             const std::function<void(const std::filesystem::path&)>& fn) {
+    DeviceQueues queues;
+    for (const auto& file : files) {
+        queues.submit(file, 0, [&fn, &file]() { fn(file); });
+    }
+    queues.wait();
+}
+
+} // namespace mo2
@@ -0,0 +1,91 @@
+#include "epoch.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <thread>
+
+namespace mo2 {
+
+EpochDomain::Guard& EpochDomain::Guard::operator=(Guard&& other) noexcept {
+    if (this != &other) {
+        release();
+        slot_ = other.slot_;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+void EpochDomain::Guard::release() {
+    if (slot_ != nullptr) {
+        slot_->epoch.store(IDLE, std::memory_order_release);
+        slot_->claimed.store(false, std::memory_order_release);
+        slot_ = nullptr;
+    }
+}
+
+EpochDomain::~EpochDomain() {
+    for (auto& retired : retired_) {
+        retired.deleter();
+    }
+}
+
+EpochDomain::Guard EpochDomain::pin() {
+    // Start the search at a per-thread place so threads rarely collide
+    const size_t start = std::hash<std::thread::id>()(std::this_thread::get_id()) % SLOT_COUNT;
+    for (;;) {
+        for (size_t i = 0; i < SLOT_COUNT; ++i) {
+            Slot& slot = slots_[(start + i) % SLOT_COUNT];
+            bool expected = false;
+            if (slot.claimed.load(std::memory_order_relaxed) ||
+                !slot.claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+                continue;
+            }
+
+            // The pin must be visible before the reader loads any shared
+            // pointer, so a writer that bumps the epoch afterwards sees it
+            slot.epoch.store(epoch_.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            return Guard(&slot);
+        }
+        std::this_thread::yield();
+    }
+}
+
+void EpochDomain::retire(std::function<void()> deleter) {
+    {
+        // Readers that pinned up to this epoch may still see the object;
+        // readers that pin later can't, since it was unpublished first
+        std::lock_guard lock(retired_mutex_);
+        uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+        retired_.push_back({epoch, std::move(deleter)});
+    }
+    collect();
+}
+
+void EpochDomain::collect() {
+    uint64_t oldest = IDLE;
+    for (const Slot& slot : slots_) {
+        oldest = std::min(oldest, slot.epoch.load(std::memory_order_seq_cst));
+    }
+
+    std::vector<Retired> freeable;
+    {
+        std::lock_guard lock(retired_mutex_);
+        auto keep = std::partition(retired_.begin(), retired_.end(),
+                                   [&](const Retired& retired) { return retired.epoch >= oldest; });
+        std::move(keep, retired_.end(), std::back_inserter(freeable));
+        retired_.erase(keep, retired_.end());
+    }
+
+    // Free outside the lock; deleters may be slow
+    for (auto& retired : freeable) {
+        retired.deleter();
+    }
+}
+
+size_t EpochDomain::retired_count() const {
+    std::lock_guard lock(retired_mutex_);
+    return retired_.size();
+}
+
+} // namespace mo2
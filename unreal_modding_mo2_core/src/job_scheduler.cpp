@@ -0,0 +1,194 @@
+#include "job_scheduler.h"
+
+#include <io_throttle.h>
+
+namespace mo2 {
+
+// Job priorities double as the I/O class of the reads a job makes
+static_assert(JOB_PRIORITY_COUNT == file_formats::IO_CLASS_COUNT);
+static_assert(static_cast<size_t>(JobPriority::Background) == static_cast<size_t>(file_formats::IoClass::Background));
+
+namespace {
+    // The scheduler and worker index of the current thread, if it is a worker
+    thread_local const JobScheduler* current_scheduler = nullptr;
+    thread_local size_t current_worker = 0;
+}
+
+JobStatus JobHandle::status() const {
+    std::lock_guard lock(state_->mutex);
+    return state_->status;
+}
+
+bool JobHandle::finished() const {
+    JobStatus current = status();
+    return current != JobStatus::Queued && current != JobStatus::Running;
+}
+
+JobStatus JobHandle::wait() const {
+    std::unique_lock lock(state_->mutex);
+    state_->finished.wait(lock, [&]() {
+        return state_->status != JobStatus::Queued && state_->status != JobStatus::Running;
+    });
+    if (state_->error) {
+        std::rethrow_exception(state_->error);
+    }
+    return state_->status;
+}
+
+JobScheduler::JobScheduler(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this, i]() { work(i); });
+    }
+}
+
+JobScheduler::~JobScheduler() {
+    {
+        std::lock_guard lock(sleep_mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+
+    for (auto& worker : workers_) {
+        for (auto& queue : worker->queues) {
+            for (auto& job : queue) {
+                finish(*job.state, JobStatus::Cancelled);
+            }
+        }
+    }
+}
+
+JobHandle JobScheduler::submit(JobPriority priority, JobStep step, CancellationToken token) {
+    auto state = std::make_shared<detail::JobState>();
+    state->token = std::move(token);
+
+    size_t worker = current_scheduler == this
+        ? current_worker
+        : next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+    push(worker, static_cast<size_t>(priority), Job{std::move(step), state}, true);
+    return JobHandle(std::move(state));
+}
+
+void JobScheduler::push(size_t worker, size_t priority, Job job, bool wake) {
+    {
+        std::lock_guard lock(workers_[worker]->mutex);
+        workers_[worker]->queues[priority].push_back(std::move(job));
+    }
+    queued_[priority].fetch_add(1, std::memory_order_relaxed);
+
+    // Publish under the sleep mutex so a worker about to sleep sees the job
+    {
+        std::lock_guard lock(sleep_mutex_);
+        total_queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (wake) {
+        wake_.notify_one();
+    }
+}
+
+bool JobScheduler::pop(size_t worker, Job& job, size_t& priority) {
+    const size_t count = workers_.size();
+    for (priority = 0; priority < JOB_PRIORITY_COUNT; ++priority) {
+        if (queued_[priority].load(std::memory_order_relaxed) == 0) {
+            continue;
+        }
+
+        // Own newest job first, then the oldest job of the other workers
+        for (size_t offset = 0; offset < count; ++offset) {
+            size_t victim = (worker + offset) % count;
+            std::lock_guard lock(workers_[victim]->mutex);
+            auto& queue = workers_[victim]->queues[priority];
+            if (queue.empty()) {
+                continue;
+            }
+            if (offset == 0) {
+                job = std::move(queue.back());
+                queue.pop_back();
+            } else {
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            queued_[priority].fetch_sub(1, std::memory_order_relaxed);
+            total_queued_.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobScheduler::work(size_t worker) {
+    current_scheduler = this;
+    current_worker = worker;
+
+    for (;;) {
+        Job job;
+        size_t priority = 0;
+        if (!pop(worker, job, priority)) {
+            std::unique_lock lock(sleep_mutex_);
+            wake_.wait(lock, [&]() { return stopping_ || total_queued_.load(std::memory_order_relaxed) > 0; });
+            if (stopping_) {
+                return;
+            }
+            continue;
+        }
+
+        detail::JobState& state = *job.state;
+        if (state.token.cancelled()) {
+            finish(state, JobStatus::Cancelled);
+            continue;
+        }
+        {
+            std::lock_guard lock(state.mutex);
+            state.status = JobStatus::Running;
+        }
+
+        // Run one block, then put the job back so the next pop can pick
+        // something more urgent
+        bool done = false;
+        try {
+            // Reads made by the job are throttled as its priority's I/O class
+            file_formats::IoClassScope io_class(static_cast<file_formats::IoClass>(priority));
+            JobContext context(state);
+            done = job.step(context);
+        } catch (const JobCancelled&) {
+            finish(state, JobStatus::Cancelled);
+            continue;
+        } catch (...) {
+            finish(state, JobStatus::Failed, std::current_exception());
+            continue;
+        }
+
+        if (done) {
+            finish(state, JobStatus::Completed);
+        } else {
+            // No point waking anyone: the job's blocks run one at a time
+            push(worker, priority, std::move(job), false);
+        }
+
+        {
+            std::lock_guard lock(sleep_mutex_);
+            if (stopping_) {
+                return;
+            }
+        }
+    }
+}
+
+void JobScheduler::finish(detail::JobState& state, JobStatus status, std::exception_ptr error) {
+    {
+        std::lock_guard lock(state.mutex);
+        state.status = status;
+        state.error = std::move(error);
+    }
+    state.finished.notify_all();
+}
+
+} // namespace mo2
@@ -0,0 +1,257 @@
+#include "loose_files.h"
+#include "job_scheduler.h"
+#include "normalized_path.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+
+#ifdef __linux__
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace mo2 {
+
+namespace {
+    // Shared state of one scan. Helper jobs may outlive the call that
+    // started it, so it is shared with them.
+    struct Scan {
+        Scan(std::filesystem::path root, JobScheduler& scheduler) : root(std::move(root)), scheduler(scheduler) {}
+
+        const std::filesystem::path root;
+        JobScheduler& scheduler;
+        std::mutex mutex;
+        std::condition_variable changed; // a directory was queued or finished
+        std::deque<std::string> queue;   // directories waiting to be read
+        size_t pending = 0;              // directories queued or being read
+        size_t helpers = 0;              // helper jobs draining the queue
+        std::vector<LooseFile> files;
+        std::vector<std::string> unreadable;
+        std::exception_ptr error;
+    };
+
+    void scan_directory(const std::shared_ptr<Scan>& scan, const std::string& relative);
+    void drain(const std::shared_ptr<Scan>& scan, bool until_done);
+
+    // Queue a directory, and start a helper job if fewer are running than
+    // the scheduler has workers
+    void queue_directory(const std::shared_ptr<Scan>& scan, std::string relative) {
+        bool start_helper = false;
+        {
+            std::lock_guard lock(scan->mutex);
+            ++scan->pending;
+            scan->queue.push_back(std::move(relative));
+            if (scan->helpers < scan->scheduler.thread_count()) {
+                ++scan->helpers;
+                start_helper = true;
+            }
+        }
+        scan->changed.notify_all();
+        if (start_helper) {
+            scan->scheduler.run(JobPriority::Normal, [scan](JobContext&) { drain(scan, false); });
+        }
+    }
+
+    void read_directory(const std::shared_ptr<Scan>& scan, const std::string& relative) {
+        try {
+            scan_directory(scan, relative);
+        } catch (const std::filesystem::filesystem_error&) {
+            // Only the root is required; a subdirectory we may not read is skipped
+            std::lock_guard lock(scan->mutex);
+            if (relative.empty()) {
+                if (!scan->error) {
+                    scan->error = std::current_exception();
+                }
+            } else {
+                scan->unreadable.push_back(relative);
+            }
+        } catch (...) {
+            std::lock_guard lock(scan->mutex);
+            if (!scan->error) {
+                scan->error = std::current_exception();
+            }
+        }
+    }
+
+    // Read queued directories until the queue is empty. The thread that
+    // started the scan keeps waiting while directories are still being
+    // read elsewhere, as they may queue more, so the scan finishes even if
+    // no helper job ever gets a worker.
+    void drain(const std::shared_ptr<Scan>& scan, bool until_done) {
+        std::unique_lock lock(scan->mutex);
+        for (;;) {
+            if (scan->queue.empty()) {
+                if (!until_done) {
+                    --scan->helpers;
+                    return;
+                }
+                if (scan->pending == 0) {
+                    return;
+                }
+                scan->changed.wait(lock);
+                continue;
+            }
+
+            std::string relative = std::move(scan->queue.front());
+            scan->queue.pop_front();
+            lock.unlock();
+            read_directory(scan, relative);
+            lock.lock();
+            if (--scan->pending == 0) {
+                scan->changed.notify_all();
+            }
+        }
+    }
+
+    std::string join(const std::string& relative, std::string_view name) {
+        return relative.empty() ? std::string(name) : relative + "/" + std::string(name);
+    }
+
+#ifdef __linux__
+    // Directory entries as returned by getdents64
+    struct LinuxDirent64 {
+        uint64_t d_ino;
+        int64_t d_off;
+        unsigned short d_reclen;
+        unsigned char d_type;
+        char d_name[];
+    };
+
+    void scan_directory(const std::shared_ptr<Scan>& scan, const std::string& relative) {
+        std::filesystem::path directory = relative.empty() ? scan->root : scan->root / relative;
+        int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) {
+            throw std::filesystem::filesystem_error("Failed to open directory", directory,
+                                                    std::error_code(errno, std::generic_category()));
+        }
+
+        std::vector<LooseFile> found;
+        alignas(LinuxDirent64) char buffer[64 * 1024];
+        for (;;) {
+            long read = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+            if (read < 0) {
+                int error = errno;
+                close(fd);
+                throw std::filesystem::filesystem_error("Failed to read directory", directory,
+                                                        std::error_code(error, std::generic_category()));
+            }
+            if (read == 0) {
+                break;
+            }
+
+            for (long offset = 0; offset < read;) {
+                auto* entry = reinterpret_cast<LinuxDirent64*>(buffer + offset);
+                offset += entry->d_reclen;
+
+                std::string_view name = entry->d_name;
+                if (name == "." || name == "..") {
+                    continue;
+                }
+                if (entry->d_type == DT_DIR) {
+                    queue_directory(scan, join(relative, name));
+                    continue;
+                }
+                if (entry->d_type != DT_REG && entry->d_type != DT_LNK && entry->d_type != DT_UNKNOWN) {
+                    continue;
+                }
+
+                // Resolve symlinks to files; the type is unknown on some file systems
+                struct statx status;
+                if (statx(fd, entry->d_name, AT_STATX_DONT_SYNC, STATX_TYPE | STATX_SIZE | STATX_MTIME, &status) != 0) {
+                    continue;
+                }
+                if (S_ISDIR(status.stx_mode) && entry->d_type == DT_UNKNOWN) {
+                    queue_directory(scan, join(relative, name));
+                    continue;
+                }
+                if (!S_ISREG(status.stx_mode)) {
+                    continue;
+                }
+                std::string file = join(relative, name);
+                found.push_back({normalize_path(file), std::move(file), status.stx_size,
+                                 status.stx_mtime.tv_sec * 1000000000ll + status.stx_mtime.tv_nsec});
+            }
+        }
+        close(fd);
+
+        std::lock_guard lock(scan->mutex);
+        std::move(found.begin(), found.end(), std::back_inserter(scan->files));
+    }
+#else
+    void scan_directory(const std::shared_ptr<Scan>& scan, const std::string& relative) {
+        // Paths are UTF-8 in the tree; build the native path from a u8string
+        std::u8string relative_u8(reinterpret_cast<const char8_t*>(relative.data()), relative.size());
+        std::filesystem::path directory =
+            relative.empty() ? scan->root : scan->root / std::filesystem::path(relative_u8);
+        std::vector<LooseFile> found;
+        for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+            std::u8string name_u8 = entry.path().filename().u8string();
+            std::string name(reinterpret_cast<const char*>(name_u8.data()), name_u8.size());
+            if (entry.is_directory() && !entry.is_symlink()) {
+                queue_directory(scan, join(relative, name));
+                continue;
+            }
+            std::error_code error;
+            if (!entry.is_regular_file(error)) {
+                continue;
+            }
+            auto mtime = std::chrono::clock_cast<std::chrono::system_clock>(entry.last_write_time(error));
+            std::string file = join(relative, name);
+            found.push_back({normalize_path(file), std::move(file), entry.file_size(error),
+                             std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count()});
+        }
+
+        std::lock_guard lock(scan->mutex);
+        std::move(found.begin(), found.end(), std::back_inserter(scan->files));
+    }
+#endif
+}
+
+LooseTree scan_loose_tree(const std::filesystem::path& root, JobScheduler* scheduler) {
+    std::optional<JobScheduler> own;
+    if (scheduler == nullptr) {
+        scheduler = &own.emplace();
+    }
+
+    auto scan = std::make_shared<Scan>(root, *scheduler);
+    queue_directory(scan, {});
+    drain(scan, true);
+    if (scan->error) {
+        std::rethrow_exception(scan->error);
+    }
+
+    LooseTree tree;
+    tree.root = root;
+    tree.files = std::move(scan->files);
+    tree.unreadable = std::move(scan->unreadable);
+    std::sort(tree.files.begin(), tree.files.end(),
+              [](const LooseFile& a, const LooseFile& b) { return a.path < b.path; });
+    std::sort(tree.unreadable.begin(), tree.unreadable.end());
+    return tree;
+}
+
+ArchiveListing list_archive(const LooseTree& tree, std::string name) {
+    ArchiveListing listing;
+    listing.name = std::move(name);
+    listing.kind = ArchiveKind::Loose;
+    listing.source = tree.root;
+    listing.paths.reserve(tree.files.size());
+    listing.source_paths.reserve(tree.files.size());
+    for (const auto& file : tree.files) {
+        listing.paths.push_back(file.path);
+        listing.source_paths.push_back(file.relative);
+    }
+    return listing;
+}
+
+} // namespace mo2
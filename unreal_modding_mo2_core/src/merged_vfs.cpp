@@ -0,0 +1,64 @@
+#include "merged_vfs.h"
+#include "normalized_path.h"
+#include "parallel.h"
+#include "path_partitions.h"
+
+#include <algorithm>
+
+namespace mo2 {
+
+MergedVfs MergedVfs::build(std::shared_ptr<const ArchiveSet> archives) {
+    using detail::PARTITION_COUNT;
+    auto partitions = detail::partition_paths(*archives);
+
+    // Occurrences of a path are adjacent and in load order, so the last
+    // one of each run is the winner
+    std::vector<std::vector<VfsEntry>> winners(PARTITION_COUNT);
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        const auto& occurrences = partitions[p];
+        auto& result = winners[p];
+        for (size_t i = 0; i < occurrences.size(); ++i) {
+            const auto& occurrence = occurrences[i];
+            bool last = i + 1 == occurrences.size() || occurrences[i + 1].hash != occurrence.hash ||
+                        detail::path_of(*archives, occurrences[i + 1]) != detail::path_of(*archives, occurrence);
+            if (last) {
+                result.push_back({occurrence.hash, occurrence.archive, occurrence.entry});
+            }
+        }
+        partitions[p].clear();
+        partitions[p].shrink_to_fit();
+    });
+
+    std::vector<size_t> first(PARTITION_COUNT + 1, 0);
+    for (size_t p = 0; p < PARTITION_COUNT; ++p) {
+        first[p + 1] = first[p] + winners[p].size();
+    }
+
+    MergedVfs vfs;
+    vfs.archives_ = std::move(archives);
+    vfs.entries_.resize(first[PARTITION_COUNT]);
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        std::copy(winners[p].begin(), winners[p].end(), vfs.entries_.begin() + first[p]);
+    });
+
+    std::vector<uint64_t> hashes(vfs.entries_.size());
+    std::vector<uint32_t> positions(vfs.entries_.size());
+    for (size_t i = 0; i < vfs.entries_.size(); ++i) {
+        hashes[i] = vfs.entries_[i].hash;
+        positions[i] = static_cast<uint32_t>(i);
+    }
+    vfs.index_ = file_formats::FlatPathMap<uint32_t>::build(hashes, positions);
+    return vfs;
+}
+
+std::optional<VfsEntry> MergedVfs::find(std::string_view normalized_path) const {
+    auto position = index_.find(hash_path(normalized_path), [&](uint32_t candidate) {
+        return path(entries_[candidate]) == normalized_path;
+    });
+    if (!position) {
+        return std::nullopt;
+    }
+    return entries_[*position];
+}
+
+} // namespace mo2
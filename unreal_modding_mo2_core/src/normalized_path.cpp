@@ -0,0 +1,50 @@
+#include "normalized_path.h"
+
+namespace mo2 {
+
+std::string normalize_path(std::string_view path) {
+    std::string result;
+    result.reserve(path.size());
+    for (char c : path) {
+        if (c == '\\') {
+            c = '/';
+        } else if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+        // Collapse repeated separators
+        if (c == '/' && !result.empty() && result.back() == '/') {
+            continue;
+        }
+        result.push_back(c);
+    }
+
+    // Strip relative and absolute prefixes
+    size_t start = 0;
+    while (start < result.size()) {
+        std::string_view rest = std::string_view(result).substr(start);
+        if (rest.starts_with("../")) {
+            start += 3;
+        } else if (rest.starts_with("./")) {
+            start += 2;
+        } else if (rest.starts_with("/")) {
+            start += 1;
+        } else {
+            break;
+        }
+    }
+    result.erase(0, start);
+    return result;
+}
+
+std::string normalize_path(std::string_view mount_point, std::string_view path) {
+    std::string joined;
+    joined.reserve(mount_point.size() + 1 + path.size());
+    joined.append(mount_point);
+    if (!joined.empty() && joined.back() != '/' && joined.back() != '\\') {
+        joined.push_back('/');
+    }
+    joined.append(path);
+    return normalize_path(joined);
+}
+
+} // namespace mo2
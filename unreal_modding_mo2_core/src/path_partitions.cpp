@@ -0,0 +1,71 @@
+#include "path_partitions.h"
+#include "normalized_path.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <array>
+
+namespace mo2::detail {
+
+std::vector<std::vector<PathOccurrence>> partition_paths(const ArchiveSet& archives) {
+    const size_t archive_count = archives.size();
+
+    // Hash every archive's paths and bucket them by partition
+    struct ArchiveItems {
+        std::vector<PathOccurrence> items;
+        std::array<uint32_t, PARTITION_COUNT + 1> offsets{};
+    };
+    std::vector<ArchiveItems> per_archive(archive_count);
+    file_formats::parallel_for(archive_count, [&](size_t a) {
+        const auto& paths = archives[static_cast<ArchiveId>(a)].paths;
+        auto& result = per_archive[a];
+
+        std::vector<uint64_t> hashes(paths.size());
+        std::array<uint32_t, PARTITION_COUNT> counts{};
+        for (size_t i = 0; i < paths.size(); ++i) {
+            hashes[i] = hash_path(paths[i]);
+            ++counts[partition_of(hashes[i])];
+        }
+
+        for (size_t p = 0; p < PARTITION_COUNT; ++p) {
+            result.offsets[p + 1] = result.offsets[p] + counts[p];
+        }
+
+        result.items.resize(paths.size());
+        std::array<uint32_t, PARTITION_COUNT> cursor;
+        std::copy(result.offsets.begin(), result.offsets.end() - 1, cursor.begin());
+        for (size_t i = 0; i < paths.size(); ++i) {
+            result.items[cursor[partition_of(hashes[i])]++] = {hashes[i], static_cast<ArchiveId>(a), static_cast<uint32_t>(i)};
+        }
+    });
+
+    // Gather each partition across archives and sort it
+    std::vector<std::vector<PathOccurrence>> partitions(PARTITION_COUNT);
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        auto& result = partitions[p];
+        size_t total = 0;
+        for (const auto& source : per_archive) {
+            total += source.offsets[p + 1] - source.offsets[p];
+        }
+        result.reserve(total);
+        for (const auto& source : per_archive) {
+            result.insert(result.end(), source.items.begin() + source.offsets[p], source.items.begin() + source.offsets[p + 1]);
+        }
+
+        std::sort(result.begin(), result.end(), [&archives](const PathOccurrence& x, const PathOccurrence& y) {
+            if (x.hash != y.hash) {
+                return x.hash < y.hash;
+            }
+            const std::string& x_path = path_of(archives, x);
+            const std::string& y_path = path_of(archives, y);
+            if (x_path != y_path) {
+                return x_path < y_path;
+            }
+            return x.archive < y.archive;
+        });
+    });
+
+    return partitions;
+}
+
+} // namespace mo2::detail
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "archive_set.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mo2::detail {
+
+// Paths are partitioned on the top bits of their hash so merges across
+// archives can run one partition per task. Partition order followed by
+// hash order is plain hash order.
+constexpr int PARTITION_BITS = 8;
+constexpr size_t PARTITION_COUNT = size_t(1) << PARTITION_BITS;
+
+inline size_t partition_of(uint64_t hash) {
+    return static_cast<size_t>(hash >> (64 - PARTITION_BITS));
+}
+
+// One path of one archive
+struct PathOccurrence {
+    uint64_t hash;
+    ArchiveId archive;
+    uint32_t entry;
+};
+
+inline const std::string& path_of(const ArchiveSet& archives, const PathOccurrence& occurrence) {
+    return archives[occurrence.archive].paths[occurrence.entry];
+}
+
+// Every path of every archive, hashed and split into partitions in
+// parallel. Each partition is sorted by hash, then path, then archive, so
+// all occurrences of a path are adjacent and in load order.
+std::vector<std::vector<PathOccurrence>> partition_paths(const ArchiveSet& archives);
+
+} // namespace mo2::detail
@@ -0,0 +1,165 @@
+#include "path_posting_index.h"
+#include "normalized_path.h"
+#include "parallel.h"
+#include "path_partitions.h"
+
+#include <algorithm>
+
+namespace mo2 {
+
+namespace {
+    struct PartitionResult {
+        std::vector<detail::PathOccurrence> occurrences;
+        std::vector<uint32_t> group_starts; // first occurrence of each unique path
+        size_t shared_count = 0;            // unique paths found in 2+ archives
+
+        // (archive, path id) pairs, sorted, for the forward index
+        std::vector<std::pair<ArchiveId, PathId>> archive_paths;
+    };
+}
+
+PathPostingIndex PathPostingIndex::build(const ArchiveSet& archives) {
+    using detail::PARTITION_COUNT;
+    const size_t archive_count = archives.size();
+
+    // Find the unique paths of each partition
+    auto occurrences_by_partition = detail::partition_paths(archives);
+    std::vector<PartitionResult> partitions(PARTITION_COUNT);
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        auto& result = partitions[p];
+        result.occurrences = std::move(occurrences_by_partition[p]);
+
+        for (size_t i = 0; i < result.occurrences.size(); ++i) {
+            const auto& occurrence = result.occurrences[i];
+            if (i == 0 || occurrence.hash != result.occurrences[i - 1].hash ||
+                detail::path_of(archives, occurrence) != detail::path_of(archives, result.occurrences[i - 1])) {
+                result.group_starts.push_back(static_cast<uint32_t>(i));
+            } else if (result.group_starts.back() == i - 1) {
+                ++result.shared_count;
+            }
+        }
+    });
+
+    // Assign path ids and bitmap slots partition by partition
+    std::vector<size_t> first_path(PARTITION_COUNT + 1, 0);
+    std::vector<size_t> first_shared(PARTITION_COUNT + 1, 0);
+    for (size_t p = 0; p < PARTITION_COUNT; ++p) {
+        first_path[p + 1] = first_path[p] + partitions[p].group_starts.size();
+        first_shared[p + 1] = first_shared[p] + partitions[p].shared_count;
+    }
+
+    PathPostingIndex index;
+    const size_t path_total = first_path[PARTITION_COUNT];
+    index.hashes_.resize(path_total);
+    index.paths_.resize(path_total);
+    index.posting_refs_.resize(path_total);
+    index.shared_postings_.resize(first_shared[PARTITION_COUNT]);
+
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        auto& result = partitions[p];
+        const auto& occurrences = result.occurrences;
+        size_t shared = first_shared[p];
+        std::vector<uint32_t> owners;
+
+        for (size_t g = 0; g < result.group_starts.size(); ++g) {
+            size_t begin = result.group_starts[g];
+            size_t end = g + 1 < result.group_starts.size() ? result.group_starts[g + 1] : occurrences.size();
+            PathId id = static_cast<PathId>(first_path[p] + g);
+
+            index.hashes_[id] = occurrences[begin].hash;
+            index.paths_[id] = detail::path_of(archives, occurrences[begin]);
+
+            owners.clear();
+            for (size_t i = begin; i < end; ++i) {
+                owners.push_back(occurrences[i].archive);
+                result.archive_paths.emplace_back(occurrences[i].archive, id);
+            }
+
+            if (end - begin == 1) {
+                index.posting_refs_[id] = SINGLE_ARCHIVE | owners.front();
+            } else {
+                index.shared_postings_[shared] = RoaringBitmap::from_sorted(owners);
+                index.posting_refs_[id] = static_cast<uint32_t>(shared++);
+            }
+        }
+
+        std::sort(result.archive_paths.begin(), result.archive_paths.end());
+        result.occurrences.clear();
+        result.occurrences.shrink_to_fit();
+    });
+
+    // Forward index: every archive's path ids, ascending across partitions
+    index.archive_paths_.resize(archive_count);
+    file_formats::parallel_for(archive_count, [&](size_t a) {
+        std::vector<uint32_t> ids;
+        ids.reserve(archives[static_cast<ArchiveId>(a)].paths.size());
+        for (const auto& result : partitions) {
+            auto range = std::equal_range(result.archive_paths.begin(), result.archive_paths.end(),
+                                          std::pair<ArchiveId, PathId>(static_cast<ArchiveId>(a), 0),
+                                          [](const auto& x, const auto& y) { return x.first < y.first; });
+            for (auto it = range.first; it != range.second; ++it) {
+                ids.push_back(it->second);
+            }
+        }
+        index.archive_paths_[a] = RoaringBitmap::from_sorted(ids);
+    });
+
+    return index;
+}
+
+std::optional<PathId> PathPostingIndex::find(std::string_view normalized_path) const {
+    uint64_t hash = hash_path(normalized_path);
+    auto it = std::lower_bound(hashes_.begin(), hashes_.end(), hash);
+    for (; it != hashes_.end() && *it == hash; ++it) {
+        PathId id = static_cast<PathId>(it - hashes_.begin());
+        if (paths_[id] == normalized_path) {
+            return id;
+        }
+    }
+    return std::nullopt;
+}
+
+RoaringBitmap PathPostingIndex::postings(PathId id) const {
+    uint32_t ref = posting_refs_[id];
+    if (ref & SINGLE_ARCHIVE) {
+        RoaringBitmap single;
+        single.add(ref & ~SINGLE_ARCHIVE);
+        return single;
+    }
+    return shared_postings_[ref];
+}
+
+std::vector<ArchiveId> PathPostingIndex::explain(std::string_view path) const {
+    auto id = find(normalize_path(path));
+    if (!id) {
+        return {};
+    }
+
+    uint32_t ref = posting_refs_[*id];
+    if (ref & SINGLE_ARCHIVE) {
+        return {ref & ~SINGLE_ARCHIVE};
+    }
+
+    std::vector<ArchiveId> result = shared_postings_[ref].to_vector();
+    std::reverse(result.begin(), result.end());
+    return result;
+}
+
+RoaringBitmap PathPostingIndex::overrides(ArchiveId upper, ArchiveId lower) const {
+    if (upper <= lower) {
+        return {};
+    }
+    return archive_paths_[upper] & archive_paths_[lower];
+}
+
+RoaringBitmap PathPostingIndex::winning_paths(ArchiveId archive) const {
+    RoaringBitmap result = archive_paths_[archive];
+    for (size_t later = static_cast<size_t>(archive) + 1; later < archive_paths_.size() && !result.empty(); ++later) {
+        if (result.and_cardinality(archive_paths_[later]) > 0) {
+            result = result.and_not(archive_paths_[later]);
+        }
+    }
+    return result;
+}
+
+} // namespace mo2
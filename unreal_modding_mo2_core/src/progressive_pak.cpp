@@ -0,0 +1,71 @@
+#include "progressive_pak.h"
+
+#include <pak_reader.h>
+
+#include <chrono>
+
+namespace mo2 {
+
+namespace {
+    // Index parsing done per block before the job goes back to the scheduler
+    constexpr std::chrono::milliseconds INDEX_STEP_BUDGET{2};
+}
+
+JobHandle open_pak_progressively(JobScheduler& scheduler, const std::filesystem::path& path,
+                                 PakProgressCallback on_progress, PakDoneCallback on_done,
+                                 JobPriority priority, CancellationToken token) {
+    // The parser is opened by the first block, so reading the footer is
+    // scheduled like the rest of the work
+    auto parser = std::make_shared<std::unique_ptr<pak::IndexParser>>();
+
+    return scheduler.submit(priority, [parser, path, on_progress = std::move(on_progress),
+                                       on_done = std::move(on_done)](JobContext& context) {
+        if (!*parser) {
+            *parser = std::make_unique<pak::IndexParser>(path);
+        }
+
+        // The entry count changes if the parse falls back to an older version
+        size_t before = (*parser)->parsed_count();
+        bool done = (*parser)->step(INDEX_STEP_BUDGET);
+        size_t after = (*parser)->parsed_count();
+        context.set_total((*parser)->total_count());
+        if (after > before) {
+            context.advance(after - before);
+        }
+        if (!done) {
+            if (on_progress) {
+                on_progress(**parser);
+            }
+            return false;
+        }
+
+        on_done((*parser)->finish());
+        return true;
+    }, std::move(token));
+}
+
+JobHandle verify_pak(JobScheduler& scheduler, std::shared_ptr<const pak::PakReader> reader,
+                     PakVerifyCallback on_done, JobPriority priority, CancellationToken token) {
+    // Listing the entries to check is left to the first block too
+    auto verifier = std::make_shared<std::unique_ptr<pak::Verifier>>();
+
+    return scheduler.submit(priority, [verifier, reader = std::move(reader),
+                                       on_done = std::move(on_done)](JobContext& context) {
+        if (!*verifier) {
+            *verifier = std::make_unique<pak::Verifier>(*reader);
+            context.set_total((*verifier)->total_count());
+        }
+
+        size_t before = (*verifier)->checked_count();
+        bool done = (*verifier)->step();
+        context.advance((*verifier)->checked_count() - before);
+        if (!done) {
+            return false;
+        }
+
+        on_done((*verifier)->mismatches());
+        return true;
+    }, std::move(token));
+}
+
+} // namespace mo2
@@ -0,0 +1,421 @@
+#include "roaring_bitmap.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace mo2 {
+
+bool RoaringBitmap::Container::contains(uint16_t low) const {
+    if (is_bitmap()) {
+        return (bits[low >> 6] >> (low & 63)) & 1;
+    }
+    return std::binary_search(array.begin(), array.end(), low);
+}
+
+void RoaringBitmap::Container::add(uint16_t low) {
+    if (is_bitmap()) {
+        uint64_t mask = uint64_t(1) << (low & 63);
+        if ((bits[low >> 6] & mask) == 0) {
+            bits[low >> 6] |= mask;
+            ++cardinality;
+        }
+        return;
+    }
+
+    if (array.empty() || array.back() < low) {
+        array.push_back(low);
+    } else {
+        auto it = std::lower_bound(array.begin(), array.end(), low);
+        if (it != array.end() && *it == low) {
+            return;
+        }
+        array.insert(it, low);
+    }
+    ++cardinality;
+
+    if (cardinality > ARRAY_LIMIT) {
+        to_bitmap();
+    }
+}
+
+void RoaringBitmap::Container::to_bitmap() {
+    bits.assign(BITMAP_WORDS, 0);
+    for (uint16_t low : array) {
+        bits[low >> 6] |= uint64_t(1) << (low & 63);
+    }
+    array.clear();
+    array.shrink_to_fit();
+}
+
+void RoaringBitmap::Container::shrink_if_sparse() {
+    if (!is_bitmap() || cardinality > ARRAY_LIMIT) {
+        return;
+    }
+    array.clear();
+    array.reserve(cardinality);
+    for (size_t word = 0; word < BITMAP_WORDS; ++word) {
+        uint64_t value = bits[word];
+        while (value != 0) {
+            array.push_back(static_cast<uint16_t>(word * 64 + std::countr_zero(value)));
+            value &= value - 1;
+        }
+    }
+    bits.clear();
+    bits.shrink_to_fit();
+}
+
+RoaringBitmap RoaringBitmap::from_sorted(std::span<const uint32_t> values) {
+    RoaringBitmap result;
+    size_t i = 0;
+    while (i < values.size()) {
+        uint16_t key = static_cast<uint16_t>(values[i] >> 16);
+        size_t end = i;
+        while (end < values.size() && (values[end] >> 16) == key) {
+            ++end;
+        }
+
+        Container container;
+        container.key = key;
+        container.array.reserve(std::min<size_t>(end - i, ARRAY_LIMIT + 1));
+        for (size_t j = i; j < end; ++j) {
+            uint16_t low = static_cast<uint16_t>(values[j]);
+            if (container.is_bitmap()) {
+                container.add(low);
+            } else if (container.array.empty() || container.array.back() != low) {
+                container.array.push_back(low);
+                if (++container.cardinality > ARRAY_LIMIT) {
+                    container.to_bitmap();
+                }
+            }
+        }
+        result.containers_.push_back(std::move(container));
+        i = end;
+    }
+    return result;
+}
+
+RoaringBitmap::Container* RoaringBitmap::find_container(uint16_t key) {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != containers_.end() && it->key == key ? &*it : nullptr;
+}
+
+const RoaringBitmap::Container* RoaringBitmap::find_container(uint16_t key) const {
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    return it != containers_.end() && it->key == key ? &*it : nullptr;
+}
+
+void RoaringBitmap::add(uint32_t value) {
+    uint16_t key = static_cast<uint16_t>(value >> 16);
+    uint16_t low = static_cast<uint16_t>(value);
+
+    if (containers_.empty() || containers_.back().key < key) {
+        Container container;
+        container.key = key;
+        containers_.push_back(std::move(container));
+        containers_.back().add(low);
+        return;
+    }
+
+    if (Container* container = find_container(key)) {
+        container->add(low);
+        return;
+    }
+
+    auto it = std::lower_bound(containers_.begin(), containers_.end(), key,
+                               [](const Container& c, uint16_t k) { return c.key < k; });
+    Container container;
+    container.key = key;
+    container.add(low);
+    containers_.insert(it, std::move(container));
+}
+
+bool RoaringBitmap::contains(uint32_t value) const {
+    const Container* container = find_container(static_cast<uint16_t>(value >> 16));
+    return container != nullptr && container->contains(static_cast<uint16_t>(value));
+}
+
+uint64_t RoaringBitmap::cardinality() const {
+    uint64_t total = 0;
+    for (const auto& container : containers_) {
+        total += container.cardinality;
+    }
+    return total;
+}
+
+uint32_t RoaringBitmap::minimum() const {
+    const Container& first = containers_.front();
+    uint32_t high = static_cast<uint32_t>(first.key) << 16;
+    if (!first.is_bitmap()) {
+        return high | first.array.front();
+    }
+    for (size_t word = 0; word < BITMAP_WORDS; ++word) {
+        if (first.bits[word] != 0) {
+            return high | static_cast<uint32_t>(word * 64 + std::countr_zero(first.bits[word]));
+        }
+    }
+    return high;
+}
+
+uint32_t RoaringBitmap::maximum() const {
+    const Container& last = containers_.back();
+    uint32_t high = static_cast<uint32_t>(last.key) << 16;
+    if (!last.is_bitmap()) {
+        return high | last.array.back();
+    }
+    for (size_t word = BITMAP_WORDS; word-- > 0;) {
+        if (last.bits[word] != 0) {
+            return high | static_cast<uint32_t>(word * 64 + 63 - std::countl_zero(last.bits[word]));
+        }
+    }
+    return high;
+}
+
+std::vector<uint32_t> RoaringBitmap::to_vector() const {
+    std::vector<uint32_t> result;
+    result.reserve(cardinality());
+    for_each([&result](uint32_t value) { result.push_back(value); });
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::intersect(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+
+    if (a.is_bitmap() && b.is_bitmap()) {
+        result.bits.resize(BITMAP_WORDS);
+        uint32_t count = 0;
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            result.bits[i] = a.bits[i] & b.bits[i];
+            count += std::popcount(result.bits[i]);
+        }
+        result.cardinality = count;
+        result.shrink_if_sparse();
+    } else if (a.is_bitmap() || b.is_bitmap()) {
+        const Container& array = a.is_bitmap() ? b : a;
+        const Container& bitmap = a.is_bitmap() ? a : b;
+        for (uint16_t low : array.array) {
+            if (bitmap.contains(low)) {
+                result.array.push_back(low);
+            }
+        }
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    } else {
+        std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                              std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    }
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::unite(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+
+    if (a.is_bitmap() || b.is_bitmap()) {
+        if (a.is_bitmap()) {
+            result.bits = a.bits;
+        } else {
+            result.bits = b.bits;
+        }
+        const Container& other = a.is_bitmap() ? b : a;
+        if (other.is_bitmap()) {
+            for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+                result.bits[i] |= other.bits[i];
+            }
+        } else {
+            for (uint16_t low : other.array) {
+                result.bits[low >> 6] |= uint64_t(1) << (low & 63);
+            }
+        }
+        uint32_t count = 0;
+        for (uint64_t word : result.bits) {
+            count += std::popcount(word);
+        }
+        result.cardinality = count;
+    } else {
+        result.array.reserve(a.array.size() + b.array.size());
+        std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                       std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+        if (result.cardinality > ARRAY_LIMIT) {
+            result.to_bitmap();
+        }
+    }
+    return result;
+}
+
+RoaringBitmap::Container RoaringBitmap::subtract(const Container& a, const Container& b) {
+    Container result;
+    result.key = a.key;
+
+    if (a.is_bitmap()) {
+        result.bits = a.bits;
+        if (b.is_bitmap()) {
+            for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+                result.bits[i] &= ~b.bits[i];
+            }
+        } else {
+            for (uint16_t low : b.array) {
+                result.bits[low >> 6] &= ~(uint64_t(1) << (low & 63));
+            }
+        }
+        uint32_t count = 0;
+        for (uint64_t word : result.bits) {
+            count += std::popcount(word);
+        }
+        result.cardinality = count;
+        result.shrink_if_sparse();
+    } else if (b.is_bitmap()) {
+        for (uint16_t low : a.array) {
+            if (!b.contains(low)) {
+                result.array.push_back(low);
+            }
+        }
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    } else {
+        std::set_difference(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                            std::back_inserter(result.array));
+        result.cardinality = static_cast<uint32_t>(result.array.size());
+    }
+    return result;
+}
+
+uint64_t RoaringBitmap::intersect_count(const Container& a, const Container& b) {
+    uint64_t count = 0;
+    if (a.is_bitmap() && b.is_bitmap()) {
+        for (size_t i = 0; i < BITMAP_WORDS; ++i) {
+            count += std::popcount(a.bits[i] & b.bits[i]);
+        }
+    } else if (a.is_bitmap() || b.is_bitmap()) {
+        const Container& array = a.is_bitmap() ? b : a;
+        const Container& bitmap = a.is_bitmap() ? a : b;
+        for (uint16_t low : array.array) {
+            count += bitmap.contains(low) ? 1 : 0;
+        }
+    } else {
+        auto i = a.array.begin();
+        auto j = b.array.begin();
+        while (i != a.array.end() && j != b.array.end()) {
+            if (*i < *j) {
+                ++i;
+            } else if (*j < *i) {
+                ++j;
+            } else {
+                ++count;
+                ++i;
+                ++j;
+            }
+        }
+    }
+    return count;
+}
+
+RoaringBitmap RoaringBitmap::operator&(const RoaringBitmap& other) const {
+    RoaringBitmap result;
+    auto i = containers_.begin();
+    auto j = other.containers_.begin();
+    while (i != containers_.end() && j != other.containers_.end()) {
+        if (i->key < j->key) {
+            ++i;
+        } else if (j->key < i->key) {
+            ++j;
+        } else {
+            Container container = intersect(*i, *j);
+            if (container.cardinality > 0) {
+                result.containers_.push_back(std::move(container));
+            }
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::operator|(const RoaringBitmap& other) const {
+    RoaringBitmap result;
+    auto i = containers_.begin();
+    auto j = other.containers_.begin();
+    while (i != containers_.end() || j != other.containers_.end()) {
+        if (j == other.containers_.end() || (i != containers_.end() && i->key < j->key)) {
+            result.containers_.push_back(*i++);
+        } else if (i == containers_.end() || j->key < i->key) {
+            result.containers_.push_back(*j++);
+        } else {
+            result.containers_.push_back(unite(*i, *j));
+            ++i;
+            ++j;
+        }
+    }
+    return result;
+}
+
+RoaringBitmap RoaringBitmap::and_not(const RoaringBitmap& other) const {
+    RoaringBitmap result;
+    auto j = other.containers_.begin();
+    for (const auto& container : containers_) {
+        while (j != other.containers_.end() && j->key < container.key) {
+            ++j;
+        }
+        if (j == other.containers_.end() || j->key != container.key) {
+            result.containers_.push_back(container);
+            continue;
+        }
+        Container difference = subtract(container, *j);
+        if (difference.cardinality > 0) {
+            result.containers_.push_back(std::move(difference));
+        }
+    }
+    return result;
+}
+
+uint64_t RoaringBitmap::and_cardinality(const RoaringBitmap& other) const {
+    uint64_t count = 0;
+    auto i = containers_.begin();
+    auto j = other.containers_.begin();
+    while (i != containers_.end() && j != other.containers_.end()) {
+        if (i->key < j->key) {
+            ++i;
+        } else if (j->key < i->key) {
+            ++j;
+        } else {
+            count += intersect_count(*i, *j);
+            ++i;
+            ++j;
+        }
+    }
+    return count;
+}
+
+size_t RoaringBitmap::memory_usage() const {
+    size_t bytes = containers_.capacity() * sizeof(Container);
+    for (const auto& container : containers_) {
+        bytes += container.array.capacity() * sizeof(uint16_t);
+        bytes += container.bits.capacity() * sizeof(uint64_t);
+    }
+    return bytes;
+}
+
+bool RoaringBitmap::operator==(const RoaringBitmap& other) const {
+    if (containers_.size() != other.containers_.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < containers_.size(); ++i) {
+        const Container& a = containers_[i];
+        const Container& b = other.containers_[i];
+        if (a.key != b.key || a.cardinality != b.cardinality) {
+            return false;
+        }
+        if (a.is_bitmap() == b.is_bitmap()) {
+            if (a.array != b.array || a.bits != b.bits) {
+                return false;
+            }
+        } else if (intersect_count(a, b) != a.cardinality) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace mo2
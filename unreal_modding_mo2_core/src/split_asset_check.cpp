@@ -0,0 +1,114 @@
+#include "split_asset_check.h"
+#include "normalized_path.h"
+#include "parallel.h"
+#include "path_partitions.h"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <optional>
+#include <string_view>
+
+namespace mo2 {
+
+namespace {
+    constexpr std::array<std::string_view, 5> SPLIT_ASSET_EXTENSIONS = {".uasset", ".umap", ".uexp", ".ubulk", ".uptnl"};
+
+    // Entries handed to one task in the scatter pass
+    constexpr size_t CHUNK_SIZE = 64 * 1024;
+
+    // One split-asset file, keyed by the hash of its stem
+    struct StemMember {
+        uint64_t stem_hash;
+        const VfsEntry* entry;
+        uint32_t stem_length;
+    };
+
+    // Length of the stem if the path ends in a split-asset extension
+    std::optional<size_t> split_asset_stem(std::string_view path) {
+        size_t dot = path.rfind('.');
+        if (dot == std::string_view::npos || path.find('/', dot) != std::string_view::npos) {
+            return std::nullopt;
+        }
+        std::string_view extension = path.substr(dot);
+        for (auto candidate : SPLIT_ASSET_EXTENSIONS) {
+            if (extension == candidate) {
+                return dot;
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+std::vector<SplitAssetIssue> find_split_asset_conflicts(const MergedVfs& vfs) {
+    using detail::PARTITION_COUNT;
+    auto entries = vfs.entries();
+
+    // Scatter: every chunk of entries buckets its split-asset files by the
+    // partition of their stem hash
+    size_t chunk_count = (entries.size() + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    std::vector<std::vector<std::vector<StemMember>>> scattered(chunk_count);
+    file_formats::parallel_for(chunk_count, [&](size_t c) {
+        auto& buckets = scattered[c];
+        buckets.resize(PARTITION_COUNT);
+        size_t end = std::min(entries.size(), (c + 1) * CHUNK_SIZE);
+        for (size_t i = c * CHUNK_SIZE; i < end; ++i) {
+            std::string_view path = vfs.path(entries[i]);
+            auto stem_length = split_asset_stem(path);
+            if (!stem_length) {
+                continue;
+            }
+            uint64_t stem_hash = hash_path(path.substr(0, *stem_length));
+            buckets[detail::partition_of(stem_hash)].push_back({stem_hash, &entries[i], static_cast<uint32_t>(*stem_length)});
+        }
+    });
+
+    // Group each partition by stem and keep the groups that span archives
+    std::vector<std::vector<SplitAssetIssue>> issues(PARTITION_COUNT);
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        std::vector<StemMember> members;
+        for (auto& buckets : scattered) {
+            members.insert(members.end(), buckets[p].begin(), buckets[p].end());
+        }
+
+        auto stem_of = [&vfs](const StemMember& member) {
+            return std::string_view(vfs.path(*member.entry)).substr(0, member.stem_length);
+        };
+        std::sort(members.begin(), members.end(), [&](const StemMember& x, const StemMember& y) {
+            if (x.stem_hash != y.stem_hash) {
+                return x.stem_hash < y.stem_hash;
+            }
+            return stem_of(x) < stem_of(y);
+        });
+
+        for (size_t begin = 0; begin < members.size();) {
+            size_t end = begin + 1;
+            bool mixed = false;
+            while (end < members.size() && members[end].stem_hash == members[begin].stem_hash &&
+                   stem_of(members[end]) == stem_of(members[begin])) {
+                mixed |= members[end].entry->archive != members[begin].entry->archive;
+                ++end;
+            }
+
+            if (mixed) {
+                SplitAssetIssue issue;
+                issue.stem = stem_of(members[begin]);
+                for (size_t i = begin; i < end; ++i) {
+                    std::string_view path = vfs.path(*members[i].entry);
+                    issue.members.push_back({std::string(path.substr(members[i].stem_length)), members[i].entry->archive});
+                }
+                issues[p].push_back(std::move(issue));
+            }
+            begin = end;
+        }
+    });
+
+    std::vector<SplitAssetIssue> result;
+    for (auto& partition : issues) {
+        std::move(partition.begin(), partition.end(), std::back_inserter(result));
+    }
+    std::sort(result.begin(), result.end(), [](const SplitAssetIssue& x, const SplitAssetIssue& y) { return x.stem < y.stem; });
+    return result;
+}
+
+} // namespace mo2
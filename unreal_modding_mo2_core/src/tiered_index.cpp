@@ -0,0 +1,305 @@
+#include "tiered_index.h"
+#include "normalized_path.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace mo2 {
+
+namespace {
+    constexpr ArchiveId NO_ARCHIVE = ~ArchiveId(0);
+
+    size_t tier_index(IndexTier tier) {
+        return static_cast<size_t>(tier);
+    }
+
+    void write_varint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<char>(value));
+    }
+
+    uint64_t read_varint(std::string_view& in) {
+        uint64_t value = 0;
+        for (int shift = 0; !in.empty() && shift < 64; shift += 7) {
+            uint8_t byte = static_cast<uint8_t>(in.front());
+            in.remove_prefix(1);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) {
+                return value;
+            }
+        }
+        throw std::runtime_error("Corrupt warm index");
+    }
+
+    // Front coding: every path as the length of the prefix it shares with
+    // the path before it plus the rest. Listings come in directory order,
+    // so most of each path is shared.
+    void encode_paths(std::string& out, const std::vector<std::string>& paths) {
+        write_varint(out, paths.size());
+        std::string_view previous;
+        for (const auto& path : paths) {
+            size_t limit = std::min(previous.size(), path.size());
+            size_t shared = 0;
+            while (shared < limit && previous[shared] == path[shared]) {
+                ++shared;
+            }
+            write_varint(out, shared);
+            write_varint(out, path.size() - shared);
+            out.append(path, shared, std::string::npos);
+            previous = path;
+        }
+    }
+
+    std::vector<std::string> decode_paths(std::string_view& in) {
+        std::vector<std::string> paths(read_varint(in));
+        for (size_t i = 0; i < paths.size(); ++i) {
+            size_t shared = read_varint(in);
+            size_t rest = read_varint(in);
+            if ((i == 0 ? 0 : paths[i - 1].size()) < shared || in.size() < rest) {
+                throw std::runtime_error("Corrupt warm index");
+            }
+            paths[i].reserve(shared + rest);
+            if (shared > 0) {
+                paths[i].append(paths[i - 1], 0, shared);
+            }
+            paths[i].append(in.substr(0, rest));
+            in.remove_prefix(rest);
+        }
+        return paths;
+    }
+
+    std::string compress_listing(const ArchiveListing& listing) {
+        std::string out;
+        encode_paths(out, listing.paths);
+        encode_paths(out, listing.source_paths);
+        out.shrink_to_fit();
+        return out;
+    }
+
+    ArchiveListing decompress_listing(const ArchiveSource& source, std::string_view data) {
+        ArchiveListing listing;
+        listing.name = source.name;
+        listing.kind = source.kind;
+        listing.source = source.source;
+        listing.paths = decode_paths(data);
+        listing.source_paths = decode_paths(data);
+        return listing;
+    }
+
+    size_t string_bytes(const std::string& text) {
+        static const size_t inline_capacity = std::string().capacity();
+        return sizeof(std::string) + (text.capacity() > inline_capacity ? text.capacity() + 1 : 0);
+    }
+
+    size_t listing_bytes(const ArchiveListing& listing) {
+        size_t bytes = sizeof(ArchiveListing) + string_bytes(listing.name);
+        for (const auto& path : listing.paths) {
+            bytes += string_bytes(path);
+        }
+        for (const auto& path : listing.source_paths) {
+            bytes += string_bytes(path);
+        }
+        return bytes;
+    }
+}
+
+TieredIndexes::TieredIndexes(ResidencyBudget budget, Loader loader)
+    : budget_(budget), loader_(std::move(loader)) {}
+
+std::shared_ptr<const TieredIndexes::HotIndex> TieredIndexes::make_hot(ArchiveListing listing,
+                                                                      std::vector<uint64_t>& sorted_hashes) {
+    std::vector<std::pair<uint64_t, uint32_t>> keys(listing.paths.size());
+    for (size_t i = 0; i < listing.paths.size(); ++i) {
+        keys[i] = {hash_path(listing.paths[i]), static_cast<uint32_t>(i)};
+    }
+    std::sort(keys.begin(), keys.end());
+
+    sorted_hashes.resize(keys.size());
+    std::vector<uint32_t> entries(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        sorted_hashes[i] = keys[i].first;
+        entries[i] = keys[i].second;
+    }
+
+    auto hot = std::make_shared<HotIndex>();
+    hot->entries = file_formats::FlatPathMap<uint32_t>::build(sorted_hashes, entries);
+    hot->listing = std::move(listing);
+    return hot;
+}
+
+ArchiveId TieredIndexes::add(ArchiveListing listing) {
+    ArchiveSource source{listing.name, listing.kind, listing.source};
+    std::vector<uint64_t> hashes;
+    auto hot = make_hot(std::move(listing), hashes);
+    BloomFilter filter = BloomFilter::build(hashes);
+
+    std::lock_guard lock(mutex_);
+    ArchiveId id = static_cast<ArchiveId>(slots_.size());
+    Slot& slot = slots_.emplace_back();
+    slot.source = std::move(source);
+    slot.filter = std::move(filter);
+    slot.tier = IndexTier::Hot;
+    slot.bytes = listing_bytes(hot->listing) + hot->entries.memory_usage() + slot.filter.memory_usage();
+    slot.hot = std::move(hot);
+    lru_[tier_index(IndexTier::Hot)].push_front(id);
+    slot.lru = lru_[tier_index(IndexTier::Hot)].begin();
+    bytes_[tier_index(IndexTier::Hot)] += slot.bytes;
+    enforce_budget(id);
+    return id;
+}
+
+size_t TieredIndexes::size() const {
+    std::lock_guard lock(mutex_);
+    return slots_.size();
+}
+
+std::shared_ptr<const ArchiveListing> TieredIndexes::listing(ArchiveId archive) {
+    std::unique_lock lock(mutex_);
+    auto hot = promote(lock, archive);
+    return std::shared_ptr<const ArchiveListing>(hot, &hot->listing);
+}
+
+std::optional<uint32_t> TieredIndexes::find(ArchiveId archive, std::string_view normalized_path) {
+    uint64_t hash = hash_path(normalized_path);
+    std::unique_lock lock(mutex_);
+    if (!slots_.at(archive).filter.may_contain(hash)) {
+        return std::nullopt;
+    }
+    auto hot = promote(lock, archive);
+    lock.unlock();
+
+    return hot->entries.find(hash, [&](uint32_t entry) { return hot->listing.paths[entry] == normalized_path; });
+}
+
+bool TieredIndexes::may_contain(ArchiveId archive, std::string_view normalized_path) const {
+    uint64_t hash = hash_path(normalized_path);
+    std::lock_guard lock(mutex_);
+    return slots_.at(archive).filter.may_contain(hash);
+}
+
+IndexTier TieredIndexes::tier(ArchiveId archive) const {
+    std::lock_guard lock(mutex_);
+    return slots_.at(archive).tier;
+}
+
+void TieredIndexes::set_budget(ResidencyBudget budget) {
+    std::lock_guard lock(mutex_);
+    budget_ = budget;
+    enforce_budget(NO_ARCHIVE);
+}
+
+ResidencyStats TieredIndexes::stats() const {
+    std::lock_guard lock(mutex_);
+    ResidencyStats stats;
+    for (size_t t = 0; t < 3; ++t) {
+        stats.archives[t] = lru_[t].size();
+        stats.bytes[t] = bytes_[t];
+    }
+    return stats;
+}
+
+std::shared_ptr<const TieredIndexes::HotIndex> TieredIndexes::promote(std::unique_lock<std::mutex>& lock,
+                                                                     ArchiveId archive) {
+    Slot* slot = &slots_.at(archive);
+    if (slot->tier == IndexTier::Hot) {
+        auto& hot_lru = lru_[tier_index(IndexTier::Hot)];
+        hot_lru.splice(hot_lru.begin(), hot_lru, slot->lru);
+        return slot->hot;
+    }
+
+    std::shared_ptr<const HotIndex> hot;
+    std::vector<uint64_t> hashes;
+    if (slot->tier == IndexTier::Warm) {
+        hot = make_hot(decompress_listing(slot->source, slot->warm), hashes);
+    } else {
+        // Load without holding the lock; another thread may get there first
+        ArchiveSource source = slot->source;
+        lock.unlock();
+        hot = make_hot(loader_(source), hashes);
+        lock.lock();
+        slot = &slots_[archive];
+        if (slot->tier == IndexTier::Hot) {
+            auto& hot_lru = lru_[tier_index(IndexTier::Hot)];
+            hot_lru.splice(hot_lru.begin(), hot_lru, slot->lru);
+            return slot->hot;
+        }
+
+        // The archive may have changed since it was first listed
+        bytes_[tier_index(slot->tier)] -= slot->filter.memory_usage();
+        slot->filter = BloomFilter::build(hashes);
+        bytes_[tier_index(slot->tier)] += slot->filter.memory_usage();
+        slot->bytes = slot->filter.memory_usage() + slot->warm.capacity();
+    }
+
+    lru_[tier_index(slot->tier)].erase(slot->lru);
+    bytes_[tier_index(slot->tier)] -= slot->bytes;
+    slot->warm.clear();
+    slot->warm.shrink_to_fit();
+    slot->hot = hot;
+    slot->tier = IndexTier::Hot;
+    slot->bytes = listing_bytes(hot->listing) + hot->entries.memory_usage() + slot->filter.memory_usage();
+    lru_[tier_index(IndexTier::Hot)].push_front(archive);
+    slot->lru = lru_[tier_index(IndexTier::Hot)].begin();
+    bytes_[tier_index(IndexTier::Hot)] += slot->bytes;
+    enforce_budget(archive);
+    return hot;
+}
+
+void TieredIndexes::set_tier(ArchiveId archive, IndexTier tier) {
+    Slot& slot = slots_[archive];
+    lru_[tier_index(slot.tier)].erase(slot.lru);
+    bytes_[tier_index(slot.tier)] -= slot.bytes;
+
+    if (tier == IndexTier::Warm) {
+        slot.warm = compress_listing(slot.hot->listing);
+    } else {
+        slot.warm.clear();
+        slot.warm.shrink_to_fit();
+    }
+    slot.hot.reset();
+    slot.tier = tier;
+    slot.bytes = slot.filter.memory_usage() + slot.warm.capacity();
+
+    lru_[tier_index(tier)].push_front(archive);
+    slot.lru = lru_[tier_index(tier)].begin();
+    bytes_[tier_index(tier)] += slot.bytes;
+}
+
+void TieredIndexes::enforce_budget(ArchiveId keep) {
+    auto& hot = lru_[tier_index(IndexTier::Hot)];
+    auto& warm = lru_[tier_index(IndexTier::Warm)];
+    while (bytes_[tier_index(IndexTier::Hot)] > budget_.hot_bytes && !hot.empty() && hot.back() != keep) {
+        set_tier(hot.back(), IndexTier::Warm);
+    }
+
+    // Compressed listings go first, then decoded ones if that's not enough
+    auto total = [&]() { return bytes_[0] + bytes_[1] + bytes_[2]; };
+    while (total() > budget_.total_bytes) {
+        if (!warm.empty()) {
+            set_tier(warm.back(), IndexTier::Cold);
+        } else if (!hot.empty() && hot.back() != keep) {
+            set_tier(hot.back(), IndexTier::Cold);
+        } else {
+            break;
+        }
+    }
+}
+
+TieredIndexes::Loader cached_listing_loader(std::filesystem::path cache_file) {
+    return [cache_file = std::move(cache_file)](const ArchiveSource& source) {
+        if (source.kind != ArchiveKind::Loose) {
+            auto cached = load_cached_archive(cache_file, source);
+            if (cached && cached->fingerprint == fingerprint_archive(source)) {
+                ArchiveListing listing = cached->archive->listing();
+                listing.name = source.name;
+                return listing;
+            }
+        }
+        return load_listing(source);
+    };
+}
+
+} // namespace mo2
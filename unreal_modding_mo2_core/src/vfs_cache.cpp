@@ -0,0 +1,659 @@
+#include "vfs_cache.h"
+#include "device_queues.h"
+#include "loose_files.h"
+#include "parallel.h"
+
+#include "city_hash.h"
+#include "pak_reader.h"
+#include "utoc_reader.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace mo2 {
+
+namespace {
+    constexpr char CACHE_MAGIC[8] = {'M', 'O', '2', 'V', 'F', 'S', 'C', '\0'};
+    constexpr uint32_t CACHE_VERSION = 2;
+
+    // Fixed fields, length prefixes and counts of an archive's cache
+    // record, plus the tables every archive has
+    constexpr size_t MIN_CACHED_ARCHIVE_SIZE = 1 + 3 * 8 + 2 * 4 + 4 * 8 + 8 + (VfsSnapshot::LEAF_COUNT + 1) * 4;
+
+    // Alignment of the tables in the cache, so they can be used in place
+    constexpr size_t TABLE_ALIGNMENT = 8;
+
+    // Bytes hashed at each end of a container
+    constexpr size_t FINGERPRINT_SPAN = 4096;
+
+    std::string cache_key(ArchiveKind kind, const std::filesystem::path& source) {
+        std::string key = source.string();
+        key.push_back(static_cast<char>('0' + static_cast<int>(kind)));
+        return key;
+    }
+
+    ArchiveFingerprint fingerprint_of(const LooseTree& tree) {
+        ArchiveFingerprint fingerprint;
+        fingerprint.size = tree.files.size();
+        std::string record;
+        for (const auto& file : tree.files) {
+            fingerprint.mtime_ns = std::max(fingerprint.mtime_ns, file.mtime_ns);
+            record.append(file.relative);
+            record.push_back('\0');
+            record.append(reinterpret_cast<const char*>(&file.size), sizeof(file.size));
+            record.append(reinterpret_cast<const char*>(&file.mtime_ns), sizeof(file.mtime_ns));
+        }
+        fingerprint.footer_hash =
+            file_formats::city_hash::hash64(reinterpret_cast<const uint8_t*>(record.data()), record.size());
+        return fingerprint;
+    }
+
+    ArchiveFingerprint fingerprint_file(const std::filesystem::path& file) {
+        ArchiveFingerprint fingerprint;
+        fingerprint.size = std::filesystem::file_size(file);
+        fingerprint.mtime_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::filesystem::last_write_time(file).time_since_epoch()).count();
+
+        std::ifstream stream(file, std::ios::binary);
+        if (!stream) {
+            throw std::runtime_error("Failed to open archive: " + file.string());
+        }
+        size_t head = static_cast<size_t>(std::min<uint64_t>(fingerprint.size, FINGERPRINT_SPAN));
+        size_t tail = static_cast<size_t>(std::min<uint64_t>(fingerprint.size - head, FINGERPRINT_SPAN));
+        std::vector<char> bytes(head + tail);
+        stream.read(bytes.data(), static_cast<std::streamsize>(head));
+        stream.seekg(static_cast<std::streamoff>(fingerprint.size - tail));
+        stream.read(bytes.data() + head, static_cast<std::streamsize>(tail));
+        if (!stream) {
+            throw std::runtime_error("Failed to read archive: " + file.string());
+        }
+        fingerprint.footer_hash =
+            file_formats::city_hash::hash64(reinterpret_cast<const uint8_t*>(bytes.data()), bytes.size());
+        return fingerprint;
+    }
+
+    // Appends the cache's fixed-width fields and length-prefixed strings
+    class CacheWriter {
+    public:
+        template <typename T>
+        void write(T value) {
+            buffer_.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        }
+
+        void write_bytes(const void* data, size_t size) {
+            buffer_.append(static_cast<const char*>(data), size);
+        }
+
+        void write_string(std::string_view text) {
+            write(static_cast<uint32_t>(text.size()));
+            buffer_.append(text);
+        }
+
+        template <typename T>
+        void write_array(std::span<const T> values) {
+            buffer_.append(reinterpret_cast<const char*>(values.data()), values.size_bytes());
+        }
+
+        // Zero-pad to a multiple of `alignment`
+        void align(size_t alignment) {
+            buffer_.resize((buffer_.size() + alignment - 1) / alignment * alignment, '\0');
+        }
+
+        const std::string& buffer() const { return buffer_; }
+
+    private:
+        std::string buffer_;
+    };
+
+    // Reads what CacheWriter wrote; every read fails once past the end
+    class CacheReader {
+    public:
+        explicit CacheReader(std::span<const uint8_t> bytes) : bytes_(bytes) {}
+
+        template <typename T>
+        bool read(T& value) {
+            if (bytes_.size() - offset_ < sizeof(T)) {
+                return false;
+            }
+            std::memcpy(&value, bytes_.data() + offset_, sizeof(T));
+            offset_ += sizeof(T);
+            return true;
+        }
+
+        bool read_string(std::string& text) {
+            uint32_t length = 0;
+            if (!read(length) || bytes_.size() - offset_ < length) {
+                return false;
+            }
+            text.assign(reinterpret_cast<const char*>(bytes_.data() + offset_), length);
+            offset_ += length;
+            return true;
+        }
+
+        // View `count` values where they lie; fails if they run past the
+        // end or aren't aligned for T
+        template <typename T>
+        bool view(uint64_t count, std::span<const T>& values) {
+            const uint8_t* data = bytes_.data() + offset_;
+            if ((bytes_.size() - offset_) / sizeof(T) < count || reinterpret_cast<uintptr_t>(data) % alignof(T) != 0) {
+                return false;
+            }
+            values = {reinterpret_cast<const T*>(data), static_cast<size_t>(count)};
+            offset_ += static_cast<size_t>(count) * sizeof(T);
+            return true;
+        }
+
+        // Skip the padding CacheWriter::align() wrote
+        bool align(size_t alignment) {
+            size_t padded = (offset_ + alignment - 1) / alignment * alignment;
+            if (padded > bytes_.size()) {
+                return false;
+            }
+            offset_ = padded;
+            return true;
+        }
+
+        size_t remaining() const { return bytes_.size() - offset_; }
+
+    private:
+        std::span<const uint8_t> bytes_;
+        size_t offset_ = 0;
+    };
+
+    // Reads what CacheWriter wrote straight from the file, for when only
+    // one record is wanted and the rest can be skipped
+    class CacheFileReader {
+    public:
+        explicit CacheFileReader(const std::filesystem::path& file)
+            : stream_(file, std::ios::binary | std::ios::ate) {
+            size_ = stream_ ? static_cast<size_t>(stream_.tellg()) : 0;
+            stream_.seekg(0);
+        }
+
+        template <typename T>
+        bool read(T& value) {
+            return read_bytes(&value, sizeof(T));
+        }
+
+        bool read_string(std::string& text) {
+            uint32_t length = 0;
+            if (!read(length) || remaining() < length) {
+                return false;
+            }
+            text.resize(length);
+            return read_bytes(text.data(), length);
+        }
+
+        bool read_bytes(void* data, size_t size) {
+            if (remaining() < size || !stream_.read(static_cast<char*>(data), static_cast<std::streamsize>(size))) {
+                return false;
+            }
+            offset_ += size;
+            return true;
+        }
+
+        bool skip(size_t size) {
+            if (remaining() < size) {
+                return false;
+            }
+            offset_ += size;
+            return static_cast<bool>(stream_.seekg(static_cast<std::streamoff>(offset_)));
+        }
+
+        bool align(size_t alignment) {
+            return skip((offset_ + alignment - 1) / alignment * alignment - offset_);
+        }
+
+        size_t remaining() const { return size_ - offset_; }
+
+    private:
+        std::ifstream stream_;
+        size_t size_ = 0;
+        size_t offset_ = 0;
+    };
+
+    // Checks the magic and version and reads the archive count
+    template <typename Reader>
+    bool read_cache_header(Reader& reader, uint32_t& count) {
+        char magic[sizeof(CACHE_MAGIC)];
+        uint32_t version = 0;
+        return reader.read(magic) && std::memcmp(magic, CACHE_MAGIC, sizeof(magic)) == 0 && reader.read(version) &&
+               version == CACHE_VERSION && reader.read(count) && reader.remaining() / MIN_CACHED_ARCHIVE_SIZE >= count;
+    }
+
+    // An archive's cache record up to its tables
+    struct RecordHeader {
+        uint8_t kind = 0;
+        ArchiveFingerprint fingerprint;
+        std::string name;
+        std::string source;
+        uint64_t path_count = 0;
+        uint64_t path_chars = 0;
+        uint64_t source_offsets = 0;
+        uint64_t source_chars = 0;
+
+        // Size of the tables that follow, or nullopt if it's over `limit`
+        std::optional<uint64_t> table_bytes(uint64_t limit) const {
+            if (path_count > limit || path_chars > limit || source_offsets > limit || source_chars > limit) {
+                return std::nullopt;
+            }
+            uint64_t bytes = 8 * (2 * path_count + 1 + source_offsets) + 4 * (path_count + VfsSnapshot::LEAF_COUNT + 1) +
+                             path_chars + source_chars;
+            return bytes <= limit ? std::optional<uint64_t>(bytes) : std::nullopt;
+        }
+    };
+
+    // Reads a record header and the padding up to its tables
+    template <typename Reader>
+    bool read_record_header(Reader& reader, RecordHeader& header) {
+        return reader.read(header.kind) && header.kind <= static_cast<uint8_t>(ArchiveKind::Loose) &&
+               reader.read(header.fingerprint.size) && reader.read(header.fingerprint.mtime_ns) &&
+               reader.read(header.fingerprint.footer_hash) && reader.read_string(header.name) &&
+               reader.read_string(header.source) && reader.read(header.path_count) && reader.read(header.path_chars) &&
+               reader.read(header.source_offsets) && reader.read(header.source_chars) && reader.align(TABLE_ALIGNMENT);
+    }
+
+    // Views the tables of a record where they lie, in the order
+    // save_vfs_cache() wrote them
+    bool view_tables(CacheReader& reader, const RecordHeader& header, VfsArchive::Tables& tables) {
+        return reader.view(header.path_count, tables.hashes) && reader.view(header.path_count + 1, tables.path_offsets) &&
+               reader.view(header.source_offsets, tables.source_path_offsets) &&
+               reader.view(header.path_count, tables.entries) &&
+               reader.view(VfsSnapshot::LEAF_COUNT + 1, tables.leaf_starts) &&
+               reader.view(header.path_chars, tables.path_chars) &&
+               reader.view(header.source_chars, tables.source_path_chars);
+    }
+}
+
+ArchiveFingerprint fingerprint_archive(const ArchiveSource& source) {
+    if (source.kind == ArchiveKind::Loose) {
+        return fingerprint_of(scan_loose_tree(source.source));
+    }
+    return fingerprint_file(source.source);
+}
+
+ArchiveListing load_listing(const ArchiveSource& source) {
+    switch (source.kind) {
+        case ArchiveKind::Pak: {
+            pak::PakReader reader(source.source);
+            return list_archive(reader, source.name, source.source);
+        }
+        case ArchiveKind::IoStore: {
+            utoc::UtocReader reader;
+            if (!reader.Open(source.source)) {
+                throw std::runtime_error("Failed to open utoc: " + source.source.string());
+            }
+            return list_archive(reader, source.name, source.source);
+        }
+        case ArchiveKind::Loose:
+            break;
+    }
+    return list_archive(scan_loose_tree(source.source), source.name);
+}
+
+std::vector<CachedArchive> load_vfs_cache(const std::filesystem::path& file) {
+    // Read into 8-byte words so the tables are aligned where they lie. The
+    // file is read rather than mapped: on Windows a mapping would keep it
+    // from being replaced while its archives are mounted.
+    std::ifstream stream(file, std::ios::binary | std::ios::ate);
+    if (!stream) {
+        return {};
+    }
+    const auto size = static_cast<size_t>(stream.tellg());
+    auto storage = std::make_shared<std::vector<uint64_t>>((size + 7) / 8);
+    stream.seekg(0);
+    if (!stream.read(reinterpret_cast<char*>(storage->data()), static_cast<std::streamsize>(size))) {
+        return {};
+    }
+
+    CacheReader reader({reinterpret_cast<const uint8_t*>(storage->data()), size});
+    uint32_t count = 0;
+    if (!read_cache_header(reader, count)) {
+        return {};
+    }
+
+    struct Record {
+        RecordHeader header;
+        VfsArchive::Tables tables;
+    };
+    std::vector<Record> records(count);
+    for (auto& record : records) {
+        if (!read_record_header(reader, record.header) || !view_tables(reader, record.header, record.tables)) {
+            return {};
+        }
+    }
+
+    // Only consistency is checked, in one pass per archive; nothing is
+    // decoded, hashed or sorted
+    std::vector<CachedArchive> archives(count);
+    std::atomic<bool> damaged{false};
+    file_formats::parallel_for(records.size(), [&](size_t i) {
+        RecordHeader& header = records[i].header;
+        archives[i].fingerprint = header.fingerprint;
+        archives[i].archive = VfsArchive::adopt(std::move(header.name), static_cast<ArchiveKind>(header.kind),
+                                                std::filesystem::path(header.source), records[i].tables, storage);
+        if (!archives[i].archive) {
+            damaged.store(true, std::memory_order_relaxed);
+        }
+    });
+    if (damaged.load()) {
+        return {};
+    }
+    return archives;
+}
+
+std::optional<CachedArchive> load_cached_archive(const std::filesystem::path& file, const ArchiveSource& source) {
+    CacheFileReader reader(file);
+    uint32_t count = 0;
+    if (!read_cache_header(reader, count)) {
+        return std::nullopt;
+    }
+
+    const std::string wanted = source.source.string();
+    RecordHeader header;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!read_record_header(reader, header)) {
+            return std::nullopt;
+        }
+        auto table_bytes = header.table_bytes(reader.remaining());
+        if (!table_bytes) {
+            return std::nullopt;
+        }
+        if (header.kind != static_cast<uint8_t>(source.kind) || header.source != wanted) {
+            if (!reader.skip(*table_bytes)) {
+                return std::nullopt;
+            }
+            continue;
+        }
+
+        // The tables start 8-aligned in the file, so they stay aligned here
+        const size_t size = static_cast<size_t>(*table_bytes);
+        auto storage = std::make_shared<std::vector<uint64_t>>((size + 7) / 8);
+        CacheReader tables_reader({reinterpret_cast<const uint8_t*>(storage->data()), size});
+        VfsArchive::Tables tables;
+        if (!reader.read_bytes(storage->data(), size) || !view_tables(tables_reader, header, tables)) {
+            return std::nullopt;
+        }
+        auto archive = VfsArchive::adopt(std::move(header.name), source.kind, source.source, tables, std::move(storage));
+        if (!archive) {
+            return std::nullopt;
+        }
+        return CachedArchive{header.fingerprint, std::move(archive)};
+    }
+    return std::nullopt;
+}
+
+void save_vfs_cache(const std::filesystem::path& file, std::span<const CachedArchive> archives) {
+    CacheWriter writer;
+    writer.write_bytes(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    writer.write(CACHE_VERSION);
+    writer.write(static_cast<uint32_t>(archives.size()));
+    for (const auto& cached : archives) {
+        const VfsArchive& archive = *cached.archive;
+        const VfsArchive::Tables& tables = archive.tables();
+        writer.write(static_cast<uint8_t>(archive.kind()));
+        writer.write(cached.fingerprint.size);
+        writer.write(cached.fingerprint.mtime_ns);
+        writer.write(cached.fingerprint.footer_hash);
+        writer.write_string(archive.name());
+        writer.write_string(archive.source().string());
+        writer.write(static_cast<uint64_t>(tables.hashes.size()));
+        writer.write(static_cast<uint64_t>(tables.path_chars.size()));
+        writer.write(static_cast<uint64_t>(tables.source_path_offsets.size()));
+        writer.write(static_cast<uint64_t>(tables.source_path_chars.size()));
+
+        // 64-bit tables first, so the 32-bit ones after them stay aligned
+        writer.align(TABLE_ALIGNMENT);
+        writer.write_array(tables.hashes);
+        writer.write_array(tables.path_offsets);
+        writer.write_array(tables.source_path_offsets);
+        writer.write_array(tables.entries);
+        writer.write_array(tables.leaf_starts);
+        writer.write_array(tables.path_chars);
+        writer.write_array(tables.source_path_chars);
+    }
+
+    std::filesystem::path temporary = file;
+    temporary += ".tmp";
+    {
+        std::ofstream stream(temporary, std::ios::binary | std::ios::trunc);
+        stream.write(writer.buffer().data(), static_cast<std::streamsize>(writer.buffer().size()));
+        if (!stream.flush()) {
+            throw std::runtime_error("Failed to write VFS cache: " + temporary.string());
+        }
+    }
+    std::filesystem::rename(temporary, file);
+}
+
+struct CachedVfsStartup::State {
+    // One archive of the load order
+    struct Slot {
+        ArchiveSource source;
+        ArchiveFingerprint fingerprint;           // of the published listing
+        std::shared_ptr<const VfsArchive> archive; // published listing, if any
+    };
+
+    // What the fingerprint pass found for one slot
+    struct Check {
+        std::optional<ArchiveFingerprint> fingerprint; // nullopt if the archive couldn't be read
+        std::optional<LooseTree> tree;                 // walk of a loose directory, reused for its listing
+    };
+
+    State(LiveVfs& vfs, std::filesystem::path cache_file) : vfs(vfs), cache_file(std::move(cache_file)) {}
+
+    LiveVfs& vfs;
+    std::filesystem::path cache_file;
+    CancellationToken token;
+    std::vector<Slot> slots;
+    std::vector<Check> checks; // by slot, filled by the first step
+    std::atomic<uint64_t> checked{0};
+
+    std::mutex mutex; // guards the report, the relist jobs and the slots while they run
+    RevalidationReport report;
+    std::vector<JobHandle> relists; // one job per archive listed again
+    size_t pending = 0;             // relist jobs still to finish
+
+    std::vector<std::shared_ptr<const VfsArchive>> load_order() const {
+        std::vector<std::shared_ptr<const VfsArchive>> archives;
+        archives.reserve(slots.size());
+        for (const auto& slot : slots) {
+            if (slot.archive) {
+                archives.push_back(slot.archive);
+            }
+        }
+        return archives;
+    }
+
+    // Fingerprint every archive on the queue of the drive it lives on, so
+    // archives on different drives are read at once and a spinning disk
+    // reads its archives in path order instead of seeking between them.
+    // Once cancelled, the requests still queued return without reading
+    void fingerprint_all(JobScheduler& scheduler) {
+        checks.resize(slots.size());
+        DeviceQueues queues;
+        for (size_t i = 0; i < slots.size(); ++i) {
+            queues.submit(slots[i].source.source, 0, [this, &scheduler, i]() {
+                if (!token.cancelled()) {
+                    fingerprint(scheduler, slots[i].source, checks[i]);
+                }
+            });
+        }
+        queues.wait();
+    }
+
+    void fingerprint(JobScheduler& scheduler, const ArchiveSource& source, Check& check) {
+        try {
+            if (source.kind == ArchiveKind::Loose) {
+                check.tree = scan_loose_tree(source.source, &scheduler);
+                check.fingerprint = fingerprint_of(*check.tree);
+            } else {
+                check.fingerprint = fingerprint_archive(source);
+            }
+        } catch (...) {
+            check.fingerprint.reset(); // counted as failed by fan_out()
+        }
+    }
+
+    // Settle the unchanged and unreadable archives and submit a job to list
+    // each of the others again, so they are listed on every worker at once
+    void fan_out(JobScheduler& scheduler, const std::shared_ptr<State>& self) {
+        if (token.cancelled()) {
+            return; // the checks of a cancelled pass are incomplete
+        }
+        std::vector<size_t> changed;
+        {
+            std::lock_guard lock(mutex);
+            for (size_t i = 0; i < slots.size(); ++i) {
+                Slot& slot = slots[i];
+                if (!checks[i].fingerprint) {
+                    slot.archive.reset();
+                    ++report.failed;
+                    checked.fetch_add(1, std::memory_order_relaxed);
+                } else if (slot.archive && *checks[i].fingerprint == slot.fingerprint) {
+                    ++report.unchanged;
+                    checked.fetch_add(1, std::memory_order_relaxed);
+                } else {
+                    changed.push_back(i);
+                }
+            }
+            pending = changed.size();
+        }
+
+        if (changed.empty()) {
+            finish();
+            return;
+        }
+        for (size_t i : changed) {
+            JobHandle handle = scheduler.run(JobPriority::Background, [self, i](JobContext&) { self->relist(i); }, token);
+            std::lock_guard lock(mutex);
+            relists.push_back(std::move(handle));
+        }
+    }
+
+    // List one archive again; the last relist job publishes the result
+    void relist(size_t i) {
+        Slot& slot = slots[i];
+        Check& check = checks[i];
+        std::shared_ptr<const VfsArchive> archive;
+        try {
+            ArchiveListing listing = check.tree ? list_archive(*check.tree, slot.source.name) : load_listing(slot.source);
+            check.tree.reset();
+            archive = VfsArchive::index(std::move(listing));
+        } catch (...) {
+        }
+        checked.fetch_add(1, std::memory_order_relaxed);
+
+        std::unique_lock lock(mutex);
+        slot.archive = archive;
+        if (archive) {
+            slot.fingerprint = *check.fingerprint;
+            ++report.reloaded;
+        } else {
+            ++report.failed;
+        }
+        if (--pending == 0) {
+            lock.unlock();
+            finish();
+        }
+    }
+
+    // Publish and cache the corrected load order
+    void finish() {
+        if (token.cancelled() || (report.reloaded == 0 && report.failed == 0)) {
+            return;
+        }
+        vfs.publish(load_order());
+
+        std::vector<CachedArchive> cache;
+        cache.reserve(slots.size());
+        for (const auto& slot : slots) {
+            if (slot.archive) {
+                cache.push_back({slot.fingerprint, slot.archive});
+            }
+        }
+        save_vfs_cache(cache_file, cache);
+    }
+};
+
+CachedVfsStartup::CachedVfsStartup(LiveVfs& vfs, JobScheduler& scheduler, std::filesystem::path cache_file,
+                                   std::vector<ArchiveSource> load_order)
+    : state_(std::make_shared<State>(vfs, std::move(cache_file))) {
+    State& state = *state_;
+    std::vector<CachedArchive> cache = load_vfs_cache(state.cache_file);
+    std::unordered_map<std::string, size_t> cached_by_source;
+    cached_by_source.reserve(cache.size());
+    for (size_t i = 0; i < cache.size(); ++i) {
+        cached_by_source.emplace(cache_key(cache[i].archive->kind(), cache[i].archive->source()), i);
+    }
+
+    // Mount the cached tables of the load order as they are
+    state.slots.resize(load_order.size());
+    for (size_t i = 0; i < load_order.size(); ++i) {
+        auto& slot = state.slots[i];
+        slot.source = std::move(load_order[i]);
+        auto it = cached_by_source.find(cache_key(slot.source.kind, slot.source.source));
+        if (it != cached_by_source.end()) {
+            const CachedArchive& cached = cache[it->second];
+            slot.fingerprint = cached.fingerprint;
+            slot.archive = cached.archive->name() == slot.source.name ? cached.archive
+                                                                      : cached.archive->renamed(slot.source.name);
+            ++state.report.cached;
+            cached_by_source.erase(it); // an archive listed twice is loaded again
+        }
+    }
+    vfs.publish(state.load_order());
+
+    revalidation_ = scheduler.submit(JobPriority::Background, [state = state_, &scheduler](JobContext&) {
+        if (state->checks.size() != state->slots.size()) {
+            state->fingerprint_all(scheduler);
+            return false;
+        }
+        state->fan_out(scheduler, state);
+        return true;
+    }, state.token);
+}
+
+CachedVfsStartup::~CachedVfsStartup() {
+    cancel();
+    try {
+        wait();
+    } catch (...) {
+    }
+}
+
+size_t CachedVfsStartup::cached() const {
+    return state_->report.cached;
+}
+
+JobProgress CachedVfsStartup::progress() const {
+    return {state_->checked.load(std::memory_order_relaxed), state_->slots.size()};
+}
+
+void CachedVfsStartup::cancel() const {
+    state_->token.cancel();
+}
+
+RevalidationReport CachedVfsStartup::wait() const {
+    // The relist jobs are all submitted by the time the first job is done;
+    // the last of them publishes and saves the cache
+    revalidation_.wait();
+    std::vector<JobHandle> relists;
+    {
+        std::lock_guard lock(state_->mutex);
+        relists = state_->relists;
+    }
+    for (const auto& relist : relists) {
+        relist.wait();
+    }
+    std::lock_guard lock(state_->mutex);
+    return state_->report;
+}
+
+} // namespace mo2
@@ -0,0 +1,118 @@
+#include "vfs_diff.h"
+#include "parallel.h"
+#include "path_partitions.h"
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+
+namespace mo2 {
+
+namespace {
+    constexpr ArchiveId NO_ARCHIVE = ~ArchiveId(0);
+
+    std::string archive_key(const ArchiveListing& listing) {
+        std::string key = listing.source.string();
+        key.push_back('\0');
+        key.append(listing.name);
+        return key;
+    }
+
+    // The id in `to` of every archive of `from`, or NO_ARCHIVE
+    std::vector<ArchiveId> match_archives(const ArchiveSet& from, const ArchiveSet& to) {
+        std::unordered_map<std::string, ArchiveId> ids;
+        ids.reserve(to.size());
+        for (size_t i = 0; i < to.size(); ++i) {
+            ids[archive_key(to[static_cast<ArchiveId>(i)])] = static_cast<ArchiveId>(i);
+        }
+
+        std::vector<ArchiveId> matches(from.size(), NO_ARCHIVE);
+        for (size_t i = 0; i < from.size(); ++i) {
+            auto it = ids.find(archive_key(from[static_cast<ArchiveId>(i)]));
+            if (it != ids.end()) {
+                matches[i] = it->second;
+            }
+        }
+        return matches;
+    }
+
+    // Entries of one hash range
+    std::span<const VfsEntry> range_of(std::span<const VfsEntry> entries, size_t partition) {
+        auto by_partition = [](const VfsEntry& entry, size_t p) { return detail::partition_of(entry.hash) < p; };
+        auto begin = std::lower_bound(entries.begin(), entries.end(), partition, by_partition);
+        auto end = std::lower_bound(begin, entries.end(), partition + 1, by_partition);
+        return {begin, end};
+    }
+}
+
+VfsDiff diff(const MergedVfs& from, const MergedVfs& to) {
+    using detail::PARTITION_COUNT;
+    std::vector<ArchiveId> matches = match_archives(from.archives(), to.archives());
+
+    // Entries are sorted by hash and then path, so one merge per range
+    // lines up every path present on both sides
+    std::vector<VfsDiff> partitions(PARTITION_COUNT);
+    file_formats::parallel_for(PARTITION_COUNT, [&](size_t p) {
+        auto before = range_of(from.entries(), p);
+        auto after = range_of(to.entries(), p);
+        auto& result = partitions[p];
+
+        size_t b = 0;
+        size_t a = 0;
+        while (b < before.size() || a < after.size()) {
+            if (a == after.size()) {
+                result.removed.push_back(before[b++]);
+                continue;
+            }
+            if (b == before.size()) {
+                result.added.push_back(after[a++]);
+                continue;
+            }
+
+            const VfsEntry& old_entry = before[b];
+            const VfsEntry& new_entry = after[a];
+            if (old_entry.hash != new_entry.hash) {
+                if (old_entry.hash < new_entry.hash) {
+                    result.removed.push_back(before[b++]);
+                } else {
+                    result.added.push_back(after[a++]);
+                }
+                continue;
+            }
+
+            int order = from.path(old_entry).compare(to.path(new_entry));
+            if (order < 0) {
+                result.removed.push_back(before[b++]);
+            } else if (order > 0) {
+                result.added.push_back(after[a++]);
+            } else {
+                if (matches[old_entry.archive] != new_entry.archive) {
+                    result.changed.emplace_back(old_entry, new_entry);
+                }
+                ++b;
+                ++a;
+            }
+        }
+    });
+
+    VfsDiff result;
+    size_t added = 0;
+    size_t removed = 0;
+    size_t changed = 0;
+    for (const auto& partition : partitions) {
+        added += partition.added.size();
+        removed += partition.removed.size();
+        changed += partition.changed.size();
+    }
+    result.added.reserve(added);
+    result.removed.reserve(removed);
+    result.changed.reserve(changed);
+    for (const auto& partition : partitions) {
+        result.added.insert(result.added.end(), partition.added.begin(), partition.added.end());
+        result.removed.insert(result.removed.end(), partition.removed.begin(), partition.removed.end());
+        result.changed.insert(result.changed.end(), partition.changed.begin(), partition.changed.end());
+    }
+    return result;
+}
+
+} // namespace mo2
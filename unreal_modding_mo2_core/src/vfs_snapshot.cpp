@@ -0,0 +1,273 @@
+#include "vfs_snapshot.h"
+#include "normalized_path.h"
+#include "parallel.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace mo2 {
+
+namespace {
+    // Tables built by VfsArchive::index()
+    struct OwnedTables {
+        std::vector<uint64_t> hashes;
+        std::vector<uint32_t> entries;
+        std::vector<uint32_t> leaf_starts;
+        std::vector<uint64_t> path_offsets;
+        std::string path_chars;
+        std::vector<uint64_t> source_path_offsets;
+        std::string source_path_chars;
+    };
+
+    void flatten(const std::vector<std::string>& strings, std::vector<uint64_t>& offsets, std::string& chars) {
+        if (strings.empty()) {
+            return;
+        }
+        size_t total = 0;
+        for (const auto& text : strings) {
+            total += text.size();
+        }
+        chars.reserve(total);
+        offsets.reserve(strings.size() + 1);
+        offsets.push_back(0);
+        for (const auto& text : strings) {
+            chars.append(text);
+            offsets.push_back(chars.size());
+        }
+    }
+
+    // Offsets start at 0, never decrease and end at the end of the characters
+    bool valid_strings(std::span<const uint64_t> offsets, std::span<const char> chars, size_t count) {
+        if (offsets.size() != count + 1 || offsets.front() != 0 || offsets.back() != chars.size()) {
+            return false;
+        }
+        for (size_t i = 1; i < offsets.size(); ++i) {
+            if (offsets[i] < offsets[i - 1]) {
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+std::shared_ptr<const VfsArchive> VfsArchive::index(ArchiveListing listing) {
+    auto owned = std::make_shared<OwnedTables>();
+    const size_t count = listing.paths.size();
+
+    std::vector<std::pair<uint64_t, uint32_t>> hashed(count);
+    for (size_t i = 0; i < count; ++i) {
+        hashed[i] = {hash_path(listing.paths[i]), static_cast<uint32_t>(i)};
+    }
+    std::sort(hashed.begin(), hashed.end());
+
+    owned->hashes.resize(count);
+    owned->entries.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        owned->hashes[i] = hashed[i].first;
+        owned->entries[i] = hashed[i].second;
+    }
+
+    owned->leaf_starts.assign(VfsSnapshot::LEAF_COUNT + 1, 0);
+    for (uint64_t hash : owned->hashes) {
+        ++owned->leaf_starts[VfsSnapshot::leaf_of(hash) + 1];
+    }
+    std::partial_sum(owned->leaf_starts.begin(), owned->leaf_starts.end(), owned->leaf_starts.begin());
+
+    // An empty listing still has the closing offset
+    flatten(listing.paths, owned->path_offsets, owned->path_chars);
+    if (owned->path_offsets.empty()) {
+        owned->path_offsets.push_back(0);
+    }
+    flatten(listing.source_paths, owned->source_path_offsets, owned->source_path_chars);
+
+    auto archive = std::make_shared<VfsArchive>();
+    archive->name_ = std::move(listing.name);
+    archive->kind_ = listing.kind;
+    archive->source_ = std::move(listing.source);
+    archive->tables_ = {owned->hashes, owned->entries, owned->leaf_starts, owned->path_offsets, owned->path_chars,
+                        owned->source_path_offsets, owned->source_path_chars};
+    archive->storage_ = std::move(owned);
+    return archive;
+}
+
+std::shared_ptr<const VfsArchive> VfsArchive::adopt(std::string name, ArchiveKind kind, std::filesystem::path source,
+                                                    const Tables& tables, std::shared_ptr<const void> storage) {
+    // Everything a lookup or a snapshot build indexes with is checked, so
+    // a damaged cache can't send either out of bounds
+    const size_t count = tables.hashes.size();
+    if (count > UINT32_MAX || tables.entries.size() != count ||
+        tables.leaf_starts.size() != VfsSnapshot::LEAF_COUNT + 1 || tables.leaf_starts.front() != 0 ||
+        tables.leaf_starts.back() != count || !valid_strings(tables.path_offsets, tables.path_chars, count)) {
+        return nullptr;
+    }
+    if (!tables.source_path_offsets.empty() &&
+        !valid_strings(tables.source_path_offsets, tables.source_path_chars, count)) {
+        return nullptr;
+    }
+    for (size_t leaf = 0; leaf < VfsSnapshot::LEAF_COUNT; ++leaf) {
+        if (tables.leaf_starts[leaf + 1] < tables.leaf_starts[leaf]) {
+            return nullptr;
+        }
+        for (uint32_t i = tables.leaf_starts[leaf]; i < tables.leaf_starts[leaf + 1]; ++i) {
+            if (VfsSnapshot::leaf_of(tables.hashes[i]) != leaf || (i > 0 && tables.hashes[i] < tables.hashes[i - 1])) {
+                return nullptr;
+            }
+        }
+    }
+    for (uint32_t entry : tables.entries) {
+        if (entry >= count) {
+            return nullptr;
+        }
+    }
+
+    auto archive = std::make_shared<VfsArchive>();
+    archive->name_ = std::move(name);
+    archive->kind_ = kind;
+    archive->source_ = std::move(source);
+    archive->tables_ = tables;
+    archive->storage_ = std::move(storage);
+    return archive;
+}
+
+std::shared_ptr<const VfsArchive> VfsArchive::renamed(std::string name) const {
+    auto archive = std::make_shared<VfsArchive>(*this);
+    archive->name_ = std::move(name);
+    return archive;
+}
+
+ArchiveListing VfsArchive::listing() const {
+    ArchiveListing listing;
+    listing.name = name_;
+    listing.kind = kind_;
+    listing.source = source_;
+    listing.paths.reserve(size());
+    for (uint32_t i = 0; i < size(); ++i) {
+        listing.paths.emplace_back(path(i));
+    }
+    if (!tables_.source_path_offsets.empty()) {
+        listing.source_paths.reserve(size());
+        for (uint32_t i = 0; i < size(); ++i) {
+            listing.source_paths.emplace_back(source_path(i));
+        }
+    }
+    return listing;
+}
+
+std::unique_ptr<const VfsSnapshot> VfsSnapshot::build(std::vector<std::shared_ptr<const VfsArchive>> load_order,
+                                                      const VfsSnapshot* previous) {
+    auto snapshot = std::unique_ptr<VfsSnapshot>(new VfsSnapshot());
+    snapshot->archives_ = std::move(load_order);
+    snapshot->leaves_.resize(LEAF_COUNT);
+    snapshot->version_ = previous ? previous->version_ + 1 : 0;
+
+    // A leaf's winners depend only on which archives have paths in it and
+    // in what order, so a leaf with the same contributors is shared as is
+    std::vector<uint8_t> rebuilt(LEAF_COUNT, 0);
+    file_formats::parallel_for(LEAF_COUNT / 64, [&](size_t chunk) {
+        std::vector<const VfsArchive*> contributors;
+        for (size_t leaf = chunk * 64; leaf < (chunk + 1) * 64; ++leaf) {
+            contributors.clear();
+            for (const auto& archive : snapshot->archives_) {
+                const auto& starts = archive->tables_.leaf_starts;
+                if (starts[leaf] != starts[leaf + 1]) {
+                    contributors.push_back(archive.get());
+                }
+            }
+
+            if (previous && previous->leaves_[leaf]->contributors == contributors) {
+                snapshot->leaves_[leaf] = previous->leaves_[leaf];
+            } else {
+                snapshot->leaves_[leaf] = build_leaf(leaf, contributors);
+                rebuilt[leaf] = 1;
+            }
+        }
+    });
+
+    for (size_t leaf = 0; leaf < LEAF_COUNT; ++leaf) {
+        snapshot->size_ += snapshot->leaves_[leaf]->entries.size();
+        snapshot->rebuilt_leaves_ += rebuilt[leaf];
+    }
+    return snapshot;
+}
+
+std::shared_ptr<const VfsSnapshot::Leaf> VfsSnapshot::build_leaf(size_t leaf,
+                                                                  std::vector<const VfsArchive*> contributors) {
+    struct Occurrence {
+        uint64_t hash;
+        uint32_t order; // position among the contributors
+        uint32_t entry;
+    };
+
+    std::vector<Occurrence> occurrences;
+    for (uint32_t order = 0; order < contributors.size(); ++order) {
+        const VfsArchive::Tables& tables = contributors[order]->tables_;
+        for (uint32_t i = tables.leaf_starts[leaf]; i < tables.leaf_starts[leaf + 1]; ++i) {
+            occurrences.push_back({tables.hashes[i], order, tables.entries[i]});
+        }
+    }
+
+    auto path_of = [&](const Occurrence& occurrence) {
+        return contributors[occurrence.order]->path(occurrence.entry);
+    };
+
+    // Sort by hash, then path, then load order, so the last occurrence of
+    // each path is its winner
+    std::sort(occurrences.begin(), occurrences.end(), [&](const Occurrence& a, const Occurrence& b) {
+        if (a.hash != b.hash) {
+            return a.hash < b.hash;
+        }
+        if (int order = path_of(a).compare(path_of(b)); order != 0) {
+            return order < 0;
+        }
+        return a.order < b.order;
+    });
+
+    auto result = std::make_shared<Leaf>();
+    for (size_t i = 0; i < occurrences.size(); ++i) {
+        const auto& occurrence = occurrences[i];
+        bool last = i + 1 == occurrences.size() || occurrences[i + 1].hash != occurrence.hash ||
+                    path_of(occurrences[i + 1]) != path_of(occurrence);
+        if (last) {
+            result->entries.push_back({occurrence.hash, contributors[occurrence.order], occurrence.entry});
+        }
+    }
+    result->contributors = std::move(contributors);
+    return result;
+}
+
+std::optional<SnapshotEntry> VfsSnapshot::find(std::string_view normalized_path) const {
+    uint64_t hash = hash_path(normalized_path);
+    const auto& entries = leaves_[leaf_of(hash)]->entries;
+    auto it = std::lower_bound(entries.begin(), entries.end(), hash,
+                               [](const SnapshotEntry& entry, uint64_t value) { return entry.hash < value; });
+    for (; it != entries.end() && it->hash == hash; ++it) {
+        if (path(*it) == normalized_path) {
+            return *it;
+        }
+    }
+    return std::nullopt;
+}
+
+LiveVfs::LiveVfs()
+    : current_(VfsSnapshot::build({}).release()) {}
+
+LiveVfs::~LiveVfs() {
+    delete current_.load();
+}
+
+LiveVfs::View LiveVfs::read() const {
+    EpochDomain::Guard guard = epochs_.pin();
+    return View(std::move(guard), current_.load(std::memory_order_seq_cst));
+}
+
+void LiveVfs::publish(std::vector<std::shared_ptr<const VfsArchive>> load_order) {
+    std::lock_guard lock(writer_mutex_);
+    const VfsSnapshot* previous = current_.load(std::memory_order_relaxed);
+    const VfsSnapshot* next = VfsSnapshot::build(std::move(load_order), previous).release();
+
+    // Unpublish the old snapshot before retiring it
+    current_.store(next, std::memory_order_seq_cst);
+    epochs_.retire([previous]() { delete previous; });
+}
+
+} // namespace mo2
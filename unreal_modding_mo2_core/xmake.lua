@@ -2,3 +2,4 @@ target("unreal_modding_mo2_core")
     set_kind("static")
     add_files("src/*.cpp")
     add_includedirs("include", { public = true })
+    add_deps("unreal_modding_file_formats", "pak_reader_prototype", "utoc_reader_prototype")
@@ -1,17 +1,28 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <unordered_map>
 #include <filesystem>
 #include <optional>
 
+namespace file_formats {
+class MappedFile;
+}
+
 namespace utoc {
 
 // Forward declarations
 class UtocReader;
+struct FUcasMappings;
+struct FLazySections;
+struct FPathIndex;
+struct FPackageIndex;
 
 // Enumerations
 enum class EIoStoreTocVersion : uint8_t {
@@ -106,6 +117,26 @@ struct FIoStoreTocCompressedBlockEntry {
     uint8_t GetCompressionMethodIndex() const;
 };
 
+// The chunk offsets and lengths unpacked into native-width columns
+struct FIoOffsetAndLengthColumns {
+    std::vector<uint64_t> offsets;
+    std::vector<uint64_t> lengths;
+};
+
+// The compression blocks unpacked into native-width columns
+struct FIoCompressedBlockColumns {
+    std::vector<uint64_t> offsets;
+    std::vector<uint32_t> compressed_sizes;
+    std::vector<uint32_t> uncompressed_sizes;
+    std::vector<uint8_t> compression_methods;
+};
+
+// Unpack a range of packed records into columns, two records per SSSE3
+// shuffle when the CPU has it. Every output must have room for in.size() values.
+void UnpackOffsetAndLengths(std::span<const FIoOffsetAndLength> in, uint64_t* offsets, uint64_t* lengths);
+void UnpackCompressedBlocks(std::span<const FIoStoreTocCompressedBlockEntry> in, uint64_t* offsets,
+                            uint32_t* compressedSizes, uint32_t* uncompressedSizes, uint8_t* compressionMethods);
+
 struct FIoDirectoryIndexEntry {
     std::optional<uint32_t> name;
     std::optional<uint32_t> first_child_entry;
@@ -127,6 +158,9 @@ struct FIoDirectoryIndexResource {
 
     // Helper function to get all file paths
     std::vector<std::string> GetAllFilePaths() const;
+
+    // Visit every file with its full path and user data (the chunk index)
+    void ForEachFile(const std::function<void(const std::string&, uint32_t)>& visitor) const;
 };
 
 struct FIoStoreTocHeader {
@@ -163,6 +197,12 @@ struct FIoStoreTocHeader {
     bool IsCompressed() const { return (container_flags & EIoContainerFlags::Compressed) != EIoContainerFlags::None; }
 };
 
+// Decompresses one compression block; returns false on failure
+using FDecompressFunction = std::function<bool(std::string_view method, std::span<const uint8_t> compressed, std::span<uint8_t> uncompressed)>;
+
+// Receives one extracted chunk; returns false to stop the extraction
+using FChunkSink = std::function<bool(uint32_t chunkIndex, std::span<const uint8_t> data)>;
+
 // Main UTOC reader class
 class UtocReader {
 public:
@@ -177,7 +217,10 @@ public:
     UtocReader(UtocReader&&) = default;
     UtocReader& operator=(UtocReader&&) = default;
 
-    // Open a UTOC file
+    // Open a UTOC file. The file is memory-mapped and only the header and the
+    // directory index are parsed; every other section is decoded in place or
+    // on first use, so listing a container touches a fraction of its bytes.
+    // The path and package lookup tables are built on the first lookup.
     bool Open(const std::filesystem::path& path);
 
     // Get the directory index
@@ -189,27 +232,106 @@ public:
     // Get the TOC header
     const FIoStoreTocHeader& GetHeader() const { return header_; }
 
+    // Get the chunk ids, indexed by chunk index
+    std::span<const FIoChunkId> GetChunkIds() const { return chunk_ids_; }
+
+    // Get the chunk offsets and lengths, indexed by chunk index
+    std::span<const FIoOffsetAndLength> GetChunkOffsetLengths() const { return chunk_offset_lengths_; }
+
+    // Get the compression blocks
+    std::span<const FIoStoreTocCompressedBlockEntry> GetCompressionBlocks() const { return compression_blocks_; }
+
+    // Get the chunk offsets and lengths as columns, indexed by chunk index.
+    // Unpacked on first call; the chunk reads below look chunks up here.
+    const FIoOffsetAndLengthColumns& GetChunkOffsetLengthColumns() const;
+
+    // Get the compression blocks as columns. Unpacked on first call; the
+    // chunk reads below walk their blocks here.
+    const FIoCompressedBlockColumns& GetCompressionBlockColumns() const;
+
+    // Get the chunk metadata, indexed by chunk index. Decoded on first call.
+    const std::vector<FIoStoreTocEntryMeta>& GetChunkMetas() const;
+
+    // Look up a file by its path, as returned by GetAllFilePaths(), and get its chunk index
+    std::optional<uint32_t> FindChunkIndex(std::string_view path) const;
+
+    // Look up many paths at once. Cache misses for different paths overlap,
+    // so this is much faster than calling FindChunkIndex() in a loop.
+    std::vector<std::optional<uint32_t>> FindMany(std::span<const std::string_view> paths) const;
+
+    // Get the FPackageId of a package (.uasset or .umap) by its path, as returned by GetAllFilePaths()
+    std::optional<uint64_t> GetPackageId(std::string_view path) const;
+
+    // Find the path of the package (.uasset or .umap) with the given FPackageId
+    std::optional<std::string_view> FindPackagePath(uint64_t packageId) const;
+
+    // Set the function used to decompress compressed blocks. The method is the
+    // name from the TOC ("Zlib", "Oodle", ...); the output span is exactly the
+    // block's uncompressed size. Without one, reading compressed blocks fails.
+    void SetDecompressor(FDecompressFunction decompressor) { decompressor_ = std::move(decompressor); }
+
+    // Read `length` bytes at `offset` into a chunk. Only the compression blocks
+    // that overlap the range are read and decompressed, and adjacent blocks
+    // are fetched from the .ucas in a single read.
+    bool ReadChunkRange(uint32_t chunkIndex, uint64_t offset, uint64_t length, std::vector<uint8_t>& out) const;
+
+    // Read a whole chunk
+    bool ReadChunk(uint32_t chunkIndex, std::vector<uint8_t>& out) const;
+
+    // View a chunk in place in the memory-mapped .ucas, without copying. Only
+    // possible when every block of the chunk is stored raw (uncompressed and
+    // unencrypted) and the blocks are contiguous; nullopt otherwise. The span
+    // stays valid for the lifetime of the reader.
+    std::optional<std::span<const uint8_t>> GetChunkView(uint32_t chunkIndex) const;
+
+    // Extract chunks in the order they are stored in the .ucas partitions, so
+    // a whole container is read in one forward sweep. Blocks are fetched in
+    // large coalesced reads and decompressed on every core, so the
+    // decompressor must be thread-safe; the sink is called on the calling
+    // thread, in .ucas order. No selection extracts every chunk. Returns
+    // false if a read or decompression fails or the sink returns false.
+    bool ExtractChunks(std::span<const uint32_t> chunkIndices, const FChunkSink& sink) const;
+
+    // Extract files under `outputDirectory`, named by their paths in the
+    // directory index. No selection extracts every file.
+    bool ExtractFiles(const std::filesystem::path& outputDirectory, std::span<const std::string_view> paths = {}) const;
+
 private:
-    // Parse the directory index
-    bool ParseDirectoryIndex(const std::vector<uint8_t>& data);
+    // The path lookup table over the directory index. Built on first call.
+    const FPathIndex& GetPathIndex() const;
+
+    // The package id of every package path. Computed on first call.
+    const FPackageIndex& GetPackageIndex() const;
+
+    // Find a path in the lookup table and get its position in the path index
+    std::optional<uint32_t> FindFile(std::string_view path) const;
 
-    // Read optional value
-    template<typename T>
-    std::optional<T> ReadOptional(const uint8_t* data, size_t& offset);
+    // Path of the .ucas partition that holds a container offset
+    std::filesystem::path GetPartitionPath(uint64_t partition) const;
 
-    // Read string
-    std::string ReadString(const uint8_t* data, size_t& offset);
+    // Map a .ucas partition on first use; nullptr if it can't be mapped
+    const file_formats::MappedFile* MapPartition(uint64_t partition) const;
 
+    // Parse the directory index; fails if it is truncated or links out of range
+    bool ParseDirectoryIndex(std::span<const uint8_t> data);
+
+    std::filesystem::path path_;
+    std::shared_ptr<const file_formats::MappedFile> toc_file_;
     FIoStoreTocHeader header_;
-    std::vector<FIoChunkId> chunk_ids_;
-    std::vector<FIoOffsetAndLength> chunk_offset_lengths_;
-    std::vector<int32_t> chunk_perfect_hash_seeds_;
-    std::vector<int32_t> chunk_indices_without_perfect_hash_;
-    std::vector<FIoStoreTocCompressedBlockEntry> compression_blocks_;
+    
+    // Views into the mapped TOC; they stay valid while toc_file_ is held
+    std::span<const FIoChunkId> chunk_ids_;
+    std::span<const FIoOffsetAndLength> chunk_offset_lengths_;
+    std::span<const uint8_t> chunk_perfect_hash_seeds_;           // raw int32 array
+    std::span<const uint8_t> chunk_indices_without_perfect_hash_; // raw int32 array
+    std::span<const FIoStoreTocCompressedBlockEntry> compression_blocks_;
+    std::span<const uint8_t> chunk_metas_data_;
+    
     std::vector<std::string> compression_methods_;
-    std::vector<FIoStoreTocEntryMeta> chunk_metas_;
+    std::shared_ptr<FLazySections> lazy_sections_;
     FIoDirectoryIndexResource directory_index_;
-    std::unordered_map<uint32_t, std::string> file_map_;
+    FDecompressFunction decompressor_;
+    std::shared_ptr<FUcasMappings> ucas_mappings_;
 };
 
 } // namespace utoc
@@ -1,12 +1,87 @@
 #include "utoc_reader.h"
+#include "cpu_features.h"
+#include "flat_path_map.h"
+#include "io_throttle.h"
+#include "mapped_file.h"
+#include "package_id.h"
+#include "parallel.h"
+#include "path_hash.h"
+#include "prefetch.h"
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <atomic>
 #include <stack>
 #include <functional>
+#include <mutex>
+
+#if defined(_M_X64) || defined(__x86_64__)
+#define UTOC_UNPACK_X86 1
+#include <tmmintrin.h>
+#endif
+
+// The SSSE3 kernels are compiled for SSSE3 regardless of the target's
+// baseline flags, and only called after a runtime CPU check
+#if defined(__clang__)
+#define UTOC_TARGET_SSSE3 _Pragma("clang attribute push(__attribute__((target(\"ssse3\"))), apply_to = function)")
+#define UTOC_TARGET_END _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define UTOC_TARGET_SSSE3 _Pragma("GCC push_options") _Pragma("GCC target(\"ssse3\")")
+#define UTOC_TARGET_END _Pragma("GCC pop_options")
+#else
+#define UTOC_TARGET_SSSE3
+#define UTOC_TARGET_END
+#endif
 
 namespace utoc {
 
+// The .ucas partitions mapped so far. Views hand out pointers into these,
+// so they live as long as the reader.
+struct FUcasMappings {
+    std::mutex mutex;
+    std::unordered_map<uint64_t, std::unique_ptr<file_formats::MappedFile>> partitions;
+};
+
+// Path lookup table over the directory index
+struct FPathIndex {
+    std::vector<std::string> paths;
+    std::vector<uint32_t> chunk_indices;
+    file_formats::FlatPathMap<uint32_t> files; // path hash to position in paths
+};
+
+// Package ids of the package paths, by position in the path index
+struct FPackageIndex {
+    std::vector<uint64_t> file_package_ids;                   // per file, 0 if not a package
+    std::vector<std::pair<uint64_t, uint32_t>> package_files; // (package id, file), sorted
+};
+
+// TOC sections and lookup tables that are built on first use
+struct FLazySections {
+    std::once_flag metas_once;
+    std::vector<FIoStoreTocEntryMeta> metas;
+    std::once_flag offset_lengths_once;
+    FIoOffsetAndLengthColumns offset_lengths;
+    std::once_flag blocks_once;
+    FIoCompressedBlockColumns blocks;
+    std::once_flag paths_once;
+    FPathIndex paths;
+    std::once_flag packages_once;
+    FPackageIndex packages;
+};
+
+namespace {
+    // How many keys ahead FindMany() issues its prefetches
+    constexpr size_t PREFETCH_DISTANCE = 8;
+
+    // Blocks are merged into one read when at most this many bytes of
+    // padding or unrelated data lie between them
+    constexpr uint64_t COALESCE_GAP = 4096;
+
+    // ExtractChunks() reads about this many compressed bytes per batch
+    constexpr uint64_t EXTRACT_BATCH_SIZE = 64 * 1024 * 1024;
+}
+
 // FIoChunkId methods
 uint64_t FIoChunkId::GetChunkId() const {
     uint64_t result = 0;
@@ -28,16 +103,20 @@ bool FIoChunkId::HasVersionInfo() const {
     return (id[11] & (1 << 6)) != 0;
 }
 
-// FIoOffsetAndLength methods
+// FIoOffsetAndLength methods (both fields are stored big-endian)
 uint64_t FIoOffsetAndLength::GetOffset() const {
     uint64_t result = 0;
-    std::memcpy(&result, data, 5);
+    for (int i = 0; i < 5; ++i) {
+        result = (result << 8) | data[i];
+    }
     return result;
 }
 
 uint64_t FIoOffsetAndLength::GetLength() const {
     uint64_t result = 0;
-    std::memcpy(&result, data + 5, 5);
+    for (int i = 5; i < 10; ++i) {
+        result = (result << 8) | data[i];
+    }
     return result;
 }
 
@@ -64,6 +143,77 @@ uint8_t FIoStoreTocCompressedBlockEntry::GetCompressionMethodIndex() const {
     return data[11];
 }
 
+namespace {
+#ifdef UTOC_UNPACK_X86
+UTOC_TARGET_SSSE3
+    // Unpacks [begin, end) two records at a time. Each record is read with a
+    // 16-byte load, so the caller leaves the last records to the scalar loop.
+    size_t UnpackOffsetAndLengthsSsse3(const FIoOffsetAndLength* in, size_t count, uint64_t* offsets, uint64_t* lengths) {
+        // Both fields are 40-bit big-endian: reverse each into a zero-extended lane
+        const __m128i reverse = _mm_setr_epi8(4, 3, 2, 1, 0, -1, -1, -1, 9, 8, 7, 6, 5, -1, -1, -1);
+        size_t i = 0;
+        for (; i + 3 <= count; i += 2) {
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in[i].data)), reverse);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in[i + 1].data)), reverse);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(offsets + i), _mm_unpacklo_epi64(a, b));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(lengths + i), _mm_unpackhi_epi64(a, b));
+        }
+        return i;
+    }
+
+    size_t UnpackCompressedBlocksSsse3(const FIoStoreTocCompressedBlockEntry* in, size_t count, uint64_t* offsets,
+                                       uint32_t* compressedSizes, uint32_t* uncompressedSizes) {
+        // Little-endian 40-bit offset into the low lane, the two 24-bit sizes
+        // into the high lane
+        const __m128i spread = _mm_setr_epi8(0, 1, 2, 3, 4, -1, -1, -1, 5, 6, 7, -1, 8, 9, 10, -1);
+        size_t i = 0;
+        for (; i + 3 <= count; i += 2) {
+            __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in[i].data)), spread);
+            __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in[i + 1].data)), spread);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(offsets + i), _mm_unpacklo_epi64(a, b));
+            
+            // [ca, ua, cb, ub] -> [ca, cb, ua, ub]
+            __m128i sizes = _mm_shuffle_epi32(_mm_unpackhi_epi64(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(compressedSizes + i), sizes);
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(uncompressedSizes + i), _mm_srli_si128(sizes, 8));
+        }
+        return i;
+    }
+UTOC_TARGET_END
+#endif
+}
+
+void UnpackOffsetAndLengths(std::span<const FIoOffsetAndLength> in, uint64_t* offsets, uint64_t* lengths) {
+    size_t i = 0;
+#ifdef UTOC_UNPACK_X86
+    if (file_formats::cpu_features().ssse3) {
+        i = UnpackOffsetAndLengthsSsse3(in.data(), in.size(), offsets, lengths);
+    }
+#endif
+    for (; i < in.size(); ++i) {
+        offsets[i] = in[i].GetOffset();
+        lengths[i] = in[i].GetLength();
+    }
+}
+
+void UnpackCompressedBlocks(std::span<const FIoStoreTocCompressedBlockEntry> in, uint64_t* offsets,
+                            uint32_t* compressedSizes, uint32_t* uncompressedSizes, uint8_t* compressionMethods) {
+    size_t i = 0;
+#ifdef UTOC_UNPACK_X86
+    if (file_formats::cpu_features().ssse3) {
+        i = UnpackCompressedBlocksSsse3(in.data(), in.size(), offsets, compressedSizes, uncompressedSizes);
+    }
+#endif
+    for (; i < in.size(); ++i) {
+        offsets[i] = in[i].GetOffset();
+        compressedSizes[i] = in[i].GetCompressedSize();
+        uncompressedSizes[i] = in[i].GetUncompressedSize();
+    }
+    for (size_t j = 0; j < in.size(); ++j) {
+        compressionMethods[j] = in[j].GetCompressionMethodIndex();
+    }
+}
+
 // FIoStoreTocHeader methods
 bool FIoStoreTocHeader::IsValid() const {
     return std::memcmp(toc_magic, MAGIC, sizeof(MAGIC)) == 0;
@@ -78,90 +228,112 @@ T ReadValue(const uint8_t* data, size_t& offset) {
     return value;
 }
 
-// Read optional value
-template<typename T>
-std::optional<T> UtocReader::ReadOptional(const uint8_t* data, size_t& offset) {
-    uint32_t value = ReadValue<uint32_t>(data, offset);
-    if (value == UINT32_MAX) {
-        return std::nullopt;
-    }
-    return static_cast<T>(value);
-}
+namespace {
+    // Reads values from a section, failing instead of reading past its end
+    class FByteReader {
+    public:
+        explicit FByteReader(std::span<const uint8_t> data) : data_(data) {}
 
-// Read string
-std::string UtocReader::ReadString(const uint8_t* data, size_t& offset) {
-    int32_t length = ReadValue<int32_t>(data, offset);
-    
-    if (length == 0) {
-        return "";
-    }
-    
-    std::string result;
-    if (length < 0) {
-        // UTF-16 string
-        length = -length;
-        std::u16string utf16;
-        utf16.reserve(length);
-        
-        for (int32_t i = 0; i < length; ++i) {
-            char16_t c = ReadValue<char16_t>(data, offset);
-            if (c == 0) break;
-            utf16.push_back(c);
-        }
-        
-        // Skip null terminator if we didn't read it
-        if (utf16.size() < static_cast<size_t>(length)) {
-            offset += (length - utf16.size()) * sizeof(char16_t);
+        template<typename T>
+        bool Read(T& value) {
+            if (sizeof(T) > data_.size() - offset_) {
+                return false;
+            }
+            std::memcpy(&value, data_.data() + offset_, sizeof(T));
+            offset_ += sizeof(T);
+            return true;
         }
-        
-        // Convert UTF-16 to UTF-8 (simplified)
-        for (char16_t c : utf16) {
-            if (c < 0x80) {
-                result.push_back(static_cast<char>(c));
-            } else if (c < 0x800) {
-                result.push_back(static_cast<char>(0xC0 | (c >> 6)));
-                result.push_back(static_cast<char>(0x80 | (c & 0x3F)));
-            } else {
-                result.push_back(static_cast<char>(0xE0 | (c >> 12)));
-                result.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
-                result.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+
+        // An index where UINT32_MAX means none
+        bool ReadOptional(std::optional<uint32_t>& value) {
+            uint32_t raw = 0;
+            if (!Read(raw)) {
+                return false;
             }
+            value = raw == UINT32_MAX ? std::nullopt : std::optional<uint32_t>(raw);
+            return true;
         }
-    } else {
-        // ASCII string
-        result.resize(length);
-        std::memcpy(result.data(), data + offset, length);
-        offset += length;
-        
-        // Remove null terminator if present
-        size_t nullPos = result.find('\0');
-        if (nullPos != std::string::npos) {
-            result.resize(nullPos);
+
+        // An element count, rejected if that many elements of at least
+        // `elementSize` bytes can't fit in what is left
+        bool ReadCount(uint32_t& count, size_t elementSize) {
+            return Read(count) && size_t(count) <= (data_.size() - offset_) / elementSize;
         }
-    }
-    
-    return result;
+
+        // An FString: positive lengths are ANSI, negative ones UTF-16, both
+        // counting the null terminator. UTF-16 is converted to UTF-8.
+        bool ReadString(std::string& value) {
+            int32_t length = 0;
+            if (!Read(length)) {
+                return false;
+            }
+            value.clear();
+            if (length == 0) {
+                return true;
+            }
+            
+            if (length > 0) {
+                if (size_t(length) > data_.size() - offset_) {
+                    return false;
+                }
+                const char* chars = reinterpret_cast<const char*>(data_.data() + offset_);
+                value.assign(chars, strnlen(chars, size_t(length)));
+                offset_ += size_t(length);
+                return true;
+            }
+            
+            if (length == INT32_MIN || size_t(-int64_t(length)) * sizeof(char16_t) > data_.size() - offset_) {
+                return false;
+            }
+            size_t count = size_t(-int64_t(length));
+            for (size_t i = 0; i < count; ++i) {
+                char16_t c = 0;
+                std::memcpy(&c, data_.data() + offset_ + i * sizeof(char16_t), sizeof(char16_t));
+                if (c == 0) {
+                    break;
+                }
+                if (c < 0x80) {
+                    value.push_back(static_cast<char>(c));
+                } else if (c < 0x800) {
+                    value.push_back(static_cast<char>(0xC0 | (c >> 6)));
+                    value.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+                } else {
+                    value.push_back(static_cast<char>(0xE0 | (c >> 12)));
+                    value.push_back(static_cast<char>(0x80 | ((c >> 6) & 0x3F)));
+                    value.push_back(static_cast<char>(0x80 | (c & 0x3F)));
+                }
+            }
+            offset_ += count * sizeof(char16_t);
+            return true;
+        }
+
+    private:
+        std::span<const uint8_t> data_;
+        size_t offset_ = 0;
+    };
 }
 
 bool UtocReader::Open(const std::filesystem::path& path) {
-    std::ifstream file(path, std::ios::binary);
-    if (!file) {
+    auto file = std::make_shared<file_formats::MappedFile>();
+    if (!file->open(path)) {
         std::cerr << "Failed to open file: " << path.string() << std::endl;
         return false;
     }
+    if (file->size() < sizeof(FIoStoreTocHeader)) {
+        std::cerr << "Invalid TOC header" << std::endl;
+        return false;
+    }
     
-    // Get file size
-    file.seekg(0, std::ios::end);
-    size_t fileSize = file.tellg();
-    file.seekg(0, std::ios::beg);
-    
-    // Read the entire file
-    std::vector<uint8_t> fileData(fileSize);
-    file.read(reinterpret_cast<char*>(fileData.data()), fileSize);
+    path_ = path;
+    toc_file_ = file;
+    ucas_mappings_ = std::make_shared<FUcasMappings>();
+    lazy_sections_ = std::make_shared<FLazySections>();
+    const uint8_t* fileData = file->data();
+    const size_t fileSize = file->size();
     
     // Parse the header
     size_t offset = 0;
-    std::memcpy(&header_, fileData.data(), sizeof(FIoStoreTocHeader));
+    std::memcpy(&header_, fileData, sizeof(FIoStoreTocHeader));
     offset += sizeof(FIoStoreTocHeader);
     
     if (!header_.IsValid()) {
@@ -169,124 +341,232 @@ bool UtocReader::Open(const std::filesystem::path& path) {
         return false;
     }
     
-    // Read chunk IDs
-    chunk_ids_.resize(header_.toc_entry_count);
-    std::memcpy(chunk_ids_.data(), fileData.data() + offset, header_.toc_entry_count * sizeof(FIoChunkId));
-    offset += header_.toc_entry_count * sizeof(FIoChunkId);
+    if (header_.IsEncrypted()) {
+        std::cerr << "Encrypted TOC files are not supported" << std::endl;
+        return false;
+    }
+    
+    // The fixed-size sections are only located here. They are viewed in place
+    // in the mapped file, so their pages aren't even read until first use.
+    bool truncated = false;
+    auto takeSection = [&](size_t size) {
+        if (truncated || offset > fileSize || size > fileSize - offset) {
+            truncated = true;
+            return std::span<const uint8_t>();
+        }
+        std::span<const uint8_t> section(fileData + offset, size);
+        offset += size;
+        return section;
+    };
+    
+    // Chunk IDs
+    auto chunkIds = takeSection(size_t(header_.toc_entry_count) * sizeof(FIoChunkId));
+    chunk_ids_ = {reinterpret_cast<const FIoChunkId*>(chunkIds.data()), chunkIds.size() / sizeof(FIoChunkId)};
     
-    // Read chunk offsets and lengths
-    chunk_offset_lengths_.resize(header_.toc_entry_count);
-    std::memcpy(chunk_offset_lengths_.data(), fileData.data() + offset, header_.toc_entry_count * sizeof(FIoOffsetAndLength));
-    offset += header_.toc_entry_count * sizeof(FIoOffsetAndLength);
+    // Chunk offsets and lengths
+    auto offsetLengths = takeSection(size_t(header_.toc_entry_count) * sizeof(FIoOffsetAndLength));
+    chunk_offset_lengths_ = {reinterpret_cast<const FIoOffsetAndLength*>(offsetLengths.data()), offsetLengths.size() / sizeof(FIoOffsetAndLength)};
     
-    // Read hash map
+    // Hash map
     if (header_.version >= EIoStoreTocVersion::PerfectHashWithOverflow) {
-        chunk_perfect_hash_seeds_.resize(header_.toc_chunk_perfect_hash_seeds_count);
-        std::memcpy(chunk_perfect_hash_seeds_.data(), fileData.data() + offset, header_.toc_chunk_perfect_hash_seeds_count * sizeof(int32_t));
-        offset += header_.toc_chunk_perfect_hash_seeds_count * sizeof(int32_t);
-        
-        chunk_indices_without_perfect_hash_.resize(header_.toc_chunks_without_perfect_hash_count);
-        std::memcpy(chunk_indices_without_perfect_hash_.data(), fileData.data() + offset, header_.toc_chunks_without_perfect_hash_count * sizeof(int32_t));
-        offset += header_.toc_chunks_without_perfect_hash_count * sizeof(int32_t);
+        chunk_perfect_hash_seeds_ = takeSection(size_t(header_.toc_chunk_perfect_hash_seeds_count) * sizeof(int32_t));
+        chunk_indices_without_perfect_hash_ = takeSection(size_t(header_.toc_chunks_without_perfect_hash_count) * sizeof(int32_t));
     } else if (header_.version >= EIoStoreTocVersion::PerfectHash) {
-        chunk_perfect_hash_seeds_.resize(header_.toc_chunk_perfect_hash_seeds_count);
-        std::memcpy(chunk_perfect_hash_seeds_.data(), fileData.data() + offset, header_.toc_chunk_perfect_hash_seeds_count * sizeof(int32_t));
-        offset += header_.toc_chunk_perfect_hash_seeds_count * sizeof(int32_t);
+        chunk_perfect_hash_seeds_ = takeSection(size_t(header_.toc_chunk_perfect_hash_seeds_count) * sizeof(int32_t));
     }
     
-    // Read compression blocks
-    compression_blocks_.resize(header_.toc_compressed_block_entry_count);
-    std::memcpy(compression_blocks_.data(), fileData.data() + offset, header_.toc_compressed_block_entry_count * sizeof(FIoStoreTocCompressedBlockEntry));
-    offset += header_.toc_compressed_block_entry_count * sizeof(FIoStoreTocCompressedBlockEntry);
+    // Compression blocks
+    auto blocks = takeSection(size_t(header_.toc_compressed_block_entry_count) * sizeof(FIoStoreTocCompressedBlockEntry));
+    compression_blocks_ = {reinterpret_cast<const FIoStoreTocCompressedBlockEntry*>(blocks.data()), blocks.size() / sizeof(FIoStoreTocCompressedBlockEntry)};
     
-    // Read compression methods
-    compression_methods_.resize(header_.compression_method_name_count);
-    for (uint32_t i = 0; i < header_.compression_method_name_count; ++i) {
-        char methodName[32] = {0};
-        std::memcpy(reinterpret_cast<void*>(methodName), fileData.data() + offset, header_.compression_method_name_length);
-        compression_methods_[i] = methodName;
-        offset += header_.compression_method_name_length;
+    // Compression methods are a handful of short names, so decode them now
+    auto methods = takeSection(size_t(header_.compression_method_name_count) * header_.compression_method_name_length);
+    compression_methods_.clear();
+    for (size_t i = 0; !truncated && i < header_.compression_method_name_count; ++i) {
+        const char* name = reinterpret_cast<const char*>(methods.data()) + i * header_.compression_method_name_length;
+        compression_methods_.emplace_back(name, strnlen(name, header_.compression_method_name_length));
     }
     
     // Skip signatures if present
-    if (header_.IsEncrypted()) {
-        std::cerr << "Encrypted TOC files are not supported" << std::endl;
+    if (header_.IsSigned()) {
+        auto sizeField = takeSection(sizeof(uint32_t));
+        uint32_t signatureSize = 0;
+        if (!truncated) {
+            std::memcpy(&signatureSize, sizeField.data(), sizeof(uint32_t));
+        }
+        takeSection(size_t(signatureSize) * 2); // TOC and block signatures
+        takeSection(size_t(header_.toc_compressed_block_entry_count) * 20); // Chunk block signatures (SHA1 hashes)
+    }
+    
+    // Directory index, which every listing needs, is the only section parsed up front
+    std::span<const uint8_t> directoryData;
+    if (header_.IsIndexed() && header_.directory_index_size > 0) {
+        directoryData = takeSection(header_.directory_index_size);
+    }
+    
+    // Chunk metadata, decoded on first use
+    size_t metaSize = header_.version >= EIoStoreTocVersion::ReplaceIoChunkHashWithIoHash ? 24 : sizeof(FIoChunkHash) + 1;
+    chunk_metas_data_ = takeSection(size_t(header_.toc_entry_count) * metaSize);
+    
+    if (truncated) {
+        std::cerr << "Truncated TOC file" << std::endl;
         return false;
     }
     
-    if (header_.IsSigned()) {
-        uint32_t signatureSize = ReadValue<uint32_t>(fileData.data(), offset);
-        offset += signatureSize * 2 + 4; // Skip TOC signature, block signature, and size
-        offset += header_.toc_compressed_block_entry_count * 20; // Skip chunk block signatures (SHA1 hashes)
+    directory_index_ = {};
+    if (!directoryData.empty() && !ParseDirectoryIndex(directoryData)) {
+        std::cerr << "Failed to parse directory index" << std::endl;
+        return false;
     }
     
-    // Read directory index
-    if (header_.IsIndexed() && header_.directory_index_size > 0) {
-        std::vector<uint8_t> directoryData(header_.directory_index_size);
-        std::memcpy(directoryData.data(), fileData.data() + offset, header_.directory_index_size);
-        offset += header_.directory_index_size;
-        
-        if (!ParseDirectoryIndex(directoryData)) {
-            std::cerr << "Failed to parse directory index" << std::endl;
-            return false;
-        }
+    return true;
+}
+
+const std::vector<FIoStoreTocEntryMeta>& UtocReader::GetChunkMetas() const {
+    static const std::vector<FIoStoreTocEntryMeta> empty;
+    if (!lazy_sections_) {
+        return empty;
     }
     
-    // Read chunk metadata
-    chunk_metas_.resize(header_.toc_entry_count);
-    for (uint32_t i = 0; i < header_.toc_entry_count; ++i) {
-        if (header_.version >= EIoStoreTocVersion::ReplaceIoChunkHashWithIoHash) {
-            std::memcpy(chunk_metas_[i].chunk_hash.hash, fileData.data() + offset, 20);
-            offset += 20;
-            chunk_metas_[i].flags = ReadValue<uint8_t>(fileData.data(), offset);
-            offset += 4; // 1 byte flags + 3 bytes padding
-        } else {
-            std::memcpy(&chunk_metas_[i].chunk_hash, fileData.data() + offset, sizeof(FIoChunkHash));
-            offset += sizeof(FIoChunkHash);
-            chunk_metas_[i].flags = ReadValue<uint8_t>(fileData.data(), offset);
-            offset += 1;
+    std::call_once(lazy_sections_->metas_once, [this]() {
+        auto& metas = lazy_sections_->metas;
+        const uint8_t* data = chunk_metas_data_.data();
+        size_t offset = 0;
+        metas.resize(header_.toc_entry_count);
+        for (uint32_t i = 0; i < header_.toc_entry_count; ++i) {
+            if (header_.version >= EIoStoreTocVersion::ReplaceIoChunkHashWithIoHash) {
+                std::memcpy(metas[i].chunk_hash.hash, data + offset, 20);
+                offset += 20;
+                metas[i].flags = ReadValue<uint8_t>(data, offset);
+                offset += 3; // padding
+            } else {
+                std::memcpy(&metas[i].chunk_hash, data + offset, sizeof(FIoChunkHash));
+                offset += sizeof(FIoChunkHash);
+                metas[i].flags = ReadValue<uint8_t>(data, offset);
+            }
         }
+    });
+    return lazy_sections_->metas;
+}
+
+const FIoOffsetAndLengthColumns& UtocReader::GetChunkOffsetLengthColumns() const {
+    static const FIoOffsetAndLengthColumns empty;
+    if (!lazy_sections_) {
+        return empty;
     }
     
-    return true;
+    std::call_once(lazy_sections_->offset_lengths_once, [this]() {
+        auto& columns = lazy_sections_->offset_lengths;
+        columns.offsets.resize(chunk_offset_lengths_.size());
+        columns.lengths.resize(chunk_offset_lengths_.size());
+        UnpackOffsetAndLengths(chunk_offset_lengths_, columns.offsets.data(), columns.lengths.data());
+    });
+    return lazy_sections_->offset_lengths;
 }
 
-bool UtocReader::ParseDirectoryIndex(const std::vector<uint8_t>& data) {
-    size_t offset = 0;
+const FIoCompressedBlockColumns& UtocReader::GetCompressionBlockColumns() const {
+    static const FIoCompressedBlockColumns empty;
+    if (!lazy_sections_) {
+        return empty;
+    }
+    
+    std::call_once(lazy_sections_->blocks_once, [this]() {
+        auto& columns = lazy_sections_->blocks;
+        columns.offsets.resize(compression_blocks_.size());
+        columns.compressed_sizes.resize(compression_blocks_.size());
+        columns.uncompressed_sizes.resize(compression_blocks_.size());
+        columns.compression_methods.resize(compression_blocks_.size());
+        UnpackCompressedBlocks(compression_blocks_, columns.offsets.data(), columns.compressed_sizes.data(),
+                               columns.uncompressed_sizes.data(), columns.compression_methods.data());
+    });
+    return lazy_sections_->blocks;
+}
+
+bool UtocReader::ParseDirectoryIndex(std::span<const uint8_t> data) {
+    FByteReader reader(data);
+    FIoDirectoryIndexResource& index = directory_index_;
     
     // Read mount point
-    directory_index_.mount_point = ReadString(data.data(), offset);
+    if (!reader.ReadString(index.mount_point)) {
+        return false;
+    }
     
     // Read directory entries
-    uint32_t directoryEntryCount = ReadValue<uint32_t>(data.data(), offset);
-    directory_index_.directory_entries.resize(directoryEntryCount);
-    
-    for (uint32_t i = 0; i < directoryEntryCount; ++i) {
-        directory_index_.directory_entries[i].name = ReadOptional<uint32_t>(data.data(), offset);
-        directory_index_.directory_entries[i].first_child_entry = ReadOptional<uint32_t>(data.data(), offset);
-        directory_index_.directory_entries[i].next_sibling_entry = ReadOptional<uint32_t>(data.data(), offset);
-        directory_index_.directory_entries[i].first_file_entry = ReadOptional<uint32_t>(data.data(), offset);
+    uint32_t directoryEntryCount = 0;
+    if (!reader.ReadCount(directoryEntryCount, 4 * sizeof(uint32_t))) {
+        return false;
+    }
+    index.directory_entries.resize(directoryEntryCount);
+    for (auto& entry : index.directory_entries) {
+        if (!reader.ReadOptional(entry.name) || !reader.ReadOptional(entry.first_child_entry) ||
+            !reader.ReadOptional(entry.next_sibling_entry) || !reader.ReadOptional(entry.first_file_entry)) {
+            return false;
+        }
     }
     
     // Read file entries
-    uint32_t fileEntryCount = ReadValue<uint32_t>(data.data(), offset);
-    directory_index_.file_entries.resize(fileEntryCount);
-    
-    for (uint32_t i = 0; i < fileEntryCount; ++i) {
-        directory_index_.file_entries[i].name = ReadValue<uint32_t>(data.data(), offset);
-        directory_index_.file_entries[i].next_file_entry = ReadOptional<uint32_t>(data.data(), offset);
-        directory_index_.file_entries[i].user_data = ReadValue<uint32_t>(data.data(), offset);
-        
-        // Map user_data (chunk index) to file path for quick lookup
-        file_map_[directory_index_.file_entries[i].user_data] = "";
+    uint32_t fileEntryCount = 0;
+    if (!reader.ReadCount(fileEntryCount, 3 * sizeof(uint32_t))) {
+        return false;
+    }
+    index.file_entries.resize(fileEntryCount);
+    for (auto& entry : index.file_entries) {
+        if (!reader.Read(entry.name) || !reader.ReadOptional(entry.next_file_entry) || !reader.Read(entry.user_data)) {
+            return false;
+        }
     }
     
     // Read string table
-    uint32_t stringCount = ReadValue<uint32_t>(data.data(), offset);
-    directory_index_.string_table.resize(stringCount);
+    uint32_t stringCount = 0;
+    if (!reader.ReadCount(stringCount, sizeof(int32_t))) {
+        return false;
+    }
+    index.string_table.resize(stringCount);
+    for (auto& string : index.string_table) {
+        if (!reader.ReadString(string)) {
+            return false;
+        }
+    }
+    
+    // Every link must stay inside its table, since walking the index trusts them
+    auto within = [](const std::optional<uint32_t>& link, size_t size) { return !link || *link < size; };
+    for (const auto& entry : index.directory_entries) {
+        if (!within(entry.name, stringCount) || !within(entry.first_child_entry, directoryEntryCount) ||
+            !within(entry.next_sibling_entry, directoryEntryCount) || !within(entry.first_file_entry, fileEntryCount)) {
+            return false;
+        }
+    }
+    for (const auto& entry : index.file_entries) {
+        if (entry.name >= stringCount || !within(entry.next_file_entry, fileEntryCount)) {
+            return false;
+        }
+    }
     
-    for (uint32_t i = 0; i < stringCount; ++i) {
-        directory_index_.string_table[i] = ReadString(data.data(), offset);
+    // A walk from the root must also reach every entry at most once, or it
+    // would never end
+    std::vector<bool> seenDirectories(directoryEntryCount);
+    std::vector<bool> seenFiles(fileEntryCount);
+    std::vector<uint32_t> pending;
+    if (directoryEntryCount > 0) {
+        pending.push_back(0);
+        seenDirectories[0] = true;
+    }
+    while (!pending.empty()) {
+        const FIoDirectoryIndexEntry& directory = index.directory_entries[pending.back()];
+        pending.pop_back();
+        for (auto file = directory.first_file_entry; file; file = index.file_entries[*file].next_file_entry) {
+            if (seenFiles[*file]) {
+                return false;
+            }
+            seenFiles[*file] = true;
+        }
+        for (auto child = directory.first_child_entry; child; child = index.directory_entries[*child].next_sibling_entry) {
+            if (seenDirectories[*child]) {
+                return false;
+            }
+            seenDirectories[*child] = true;
+            pending.push_back(*child);
+        }
     }
     
     return true;
@@ -294,10 +574,16 @@ bool UtocReader::ParseDirectoryIndex(const std::vector<uint8_t>& data) {
 
 std::vector<std::string> FIoDirectoryIndexResource::GetAllFilePaths() const {
     std::vector<std::string> result;
-    
+    ForEachFile([&result](const std::string& path, uint32_t) {
+        result.push_back(path);
+    });
+    return result;
+}
+
+void FIoDirectoryIndexResource::ForEachFile(const std::function<void(const std::string&, uint32_t)>& visitor) const {
     // Helper function to recursively traverse the directory structure
     std::function<void(uint32_t, std::vector<std::string>&)> traverseDirectory = 
-        [this, &traverseDirectory, &result](uint32_t dirIndex, std::vector<std::string>& path) {
+        [this, &traverseDirectory, &visitor](uint32_t dirIndex, std::vector<std::string>& path) {
             const auto& dir = directory_entries[dirIndex];
             
             // Add directory name to path if it has one
@@ -322,7 +608,7 @@ std::vector<std::string> FIoDirectoryIndexResource::GetAllFilePaths() const {
                     fullPath += segment;
                 }
                 
-                result.push_back(fullPath);
+                visitor(fullPath, file.user_data);
                 
                 // Remove file name from path
                 path.pop_back();
@@ -348,12 +634,565 @@ std::vector<std::string> FIoDirectoryIndexResource::GetAllFilePaths() const {
     if (!directory_entries.empty()) {
         traverseDirectory(0, path);
     }
-    
-    return result;
 }
 
 std::vector<std::string> UtocReader::GetAllFilePaths() const {
     return directory_index_.GetAllFilePaths();
 }
 
+const FPathIndex& UtocReader::GetPathIndex() const {
+    static const FPathIndex empty;
+    if (!lazy_sections_) {
+        return empty;
+    }
+    
+    std::call_once(lazy_sections_->paths_once, [this]() {
+        FPathIndex& index = lazy_sections_->paths;
+        directory_index_.ForEachFile([&index](const std::string& path, uint32_t chunkIndex) {
+            index.paths.push_back(path);
+            index.chunk_indices.push_back(chunkIndex);
+        });
+        
+        index.files.reserve(index.paths.size());
+        for (size_t i = 0; i < index.paths.size(); ++i) {
+            index.files.insert(file_formats::hash_path(index.paths[i]), static_cast<uint32_t>(i));
+        }
+    });
+    return lazy_sections_->paths;
+}
+
+std::optional<uint32_t> UtocReader::FindFile(std::string_view path) const {
+    const FPathIndex& index = GetPathIndex();
+    return index.files.find(file_formats::hash_path(path), [&](uint32_t file) { return index.paths[file] == path; });
+}
+
+std::optional<uint32_t> UtocReader::FindChunkIndex(std::string_view path) const {
+    auto file = FindFile(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    return GetPathIndex().chunk_indices[*file];
+}
+
+std::vector<std::optional<uint32_t>> UtocReader::FindMany(std::span<const std::string_view> paths) const {
+    std::vector<std::optional<uint32_t>> result(paths.size());
+    const FPathIndex& index = GetPathIndex();
+    if (index.files.empty() || paths.empty()) {
+        return result;
+    }
+    
+    // Hash every key up front so the probe loop below only waits on memory
+    std::vector<uint64_t> hashes(paths.size());
+    for (size_t i = 0; i < paths.size(); ++i) {
+        hashes[i] = file_formats::hash_path(paths[i]);
+    }
+    
+    // Software pipeline over the keys: the home group of one key is
+    // prefetched, the path of the first slot whose hash matches for a key
+    // `distance` behind it is prefetched, and a key another `distance`
+    // behind that is resolved.
+    const size_t count = paths.size();
+    for (size_t i = 0; i < count + 2 * PREFETCH_DISTANCE; ++i) {
+        if (i < count) {
+            index.files.prefetch(hashes[i]);
+        }
+        if (i >= PREFETCH_DISTANCE && i - PREFETCH_DISTANCE < count) {
+            auto candidate = index.files.find(hashes[i - PREFETCH_DISTANCE], [](uint32_t) { return true; });
+            if (candidate) {
+                file_formats::prefetch(&index.paths[*candidate]);
+            }
+        }
+        if (i >= 2 * PREFETCH_DISTANCE) {
+            size_t key = i - 2 * PREFETCH_DISTANCE;
+            auto file = index.files.find(hashes[key], [&](uint32_t file) { return index.paths[file] == paths[key]; });
+            if (file) {
+                result[key] = index.chunk_indices[*file];
+            }
+        }
+    }
+    
+    return result;
+}
+
+const FPackageIndex& UtocReader::GetPackageIndex() const {
+    static const FPackageIndex empty;
+    if (!lazy_sections_) {
+        return empty;
+    }
+    
+    std::call_once(lazy_sections_->packages_once, [this]() {
+        const FPathIndex& paths = GetPathIndex();
+        FPackageIndex& index = lazy_sections_->packages;
+        index.file_package_ids.assign(paths.paths.size(), file_formats::package_id::INVALID);
+        
+        // Gather the package names first so they can be hashed in one batch
+        std::vector<std::string> names;
+        std::vector<uint32_t> files;
+        for (size_t i = 0; i < paths.paths.size(); ++i) {
+            std::string_view path = paths.paths[i];
+            if (!path.ends_with(".uasset") && !path.ends_with(".umap")) {
+                continue;
+            }
+            auto name = file_formats::package_id::package_name_from_path(path);
+            if (name) {
+                names.push_back(std::move(*name));
+                files.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        
+        std::vector<std::string_view> views(names.begin(), names.end());
+        std::vector<uint64_t> ids(names.size());
+        file_formats::package_id::from_names(views, ids);
+        
+        index.package_files.reserve(ids.size());
+        for (size_t i = 0; i < ids.size(); ++i) {
+            index.file_package_ids[files[i]] = ids[i];
+            index.package_files.emplace_back(ids[i], files[i]);
+        }
+        std::sort(index.package_files.begin(), index.package_files.end());
+    });
+    return lazy_sections_->packages;
+}
+
+std::optional<uint64_t> UtocReader::GetPackageId(std::string_view path) const {
+    auto file = FindFile(path);
+    if (!file) {
+        return std::nullopt;
+    }
+    uint64_t id = GetPackageIndex().file_package_ids[*file];
+    if (id == file_formats::package_id::INVALID) {
+        return std::nullopt;
+    }
+    return id;
+}
+
+std::optional<std::string_view> UtocReader::FindPackagePath(uint64_t packageId) const {
+    const auto& packageFiles = GetPackageIndex().package_files;
+    auto it = std::lower_bound(packageFiles.begin(), packageFiles.end(), std::make_pair(packageId, uint32_t(0)));
+    if (it == packageFiles.end() || it->first != packageId) {
+        return std::nullopt;
+    }
+    return std::string_view(GetPathIndex().paths[it->second]);
+}
+
+std::filesystem::path UtocReader::GetPartitionPath(uint64_t partition) const {
+    std::filesystem::path result = path_;
+    if (partition == 0) {
+        return result.replace_extension(".ucas");
+    }
+    return result.replace_filename(path_.stem().string() + "_s" + std::to_string(partition) + ".ucas");
+}
+
+bool UtocReader::ReadChunk(uint32_t chunkIndex, std::vector<uint8_t>& out) const {
+    if (chunkIndex >= chunk_offset_lengths_.size()) {
+        std::cerr << "Invalid chunk index: " << chunkIndex << std::endl;
+        return false;
+    }
+    return ReadChunkRange(chunkIndex, 0, chunk_offset_lengths_[chunkIndex].GetLength(), out);
+}
+
+bool UtocReader::ReadChunkRange(uint32_t chunkIndex, uint64_t offset, uint64_t length, std::vector<uint8_t>& out) const {
+    out.clear();
+    const FIoOffsetAndLengthColumns& chunks = GetChunkOffsetLengthColumns();
+    const FIoCompressedBlockColumns& blocks = GetCompressionBlockColumns();
+    if (chunkIndex >= chunks.offsets.size()) {
+        std::cerr << "Invalid chunk index: " << chunkIndex << std::endl;
+        return false;
+    }
+    
+    const uint64_t chunkLength = chunks.lengths[chunkIndex];
+    if (offset > chunkLength || length > chunkLength - offset) {
+        std::cerr << "Range is outside chunk " << chunkIndex << std::endl;
+        return false;
+    }
+    if (length == 0) {
+        return true;
+    }
+    
+    // Chunks are laid out back to back in one uncompressed address space cut
+    // into fixed-size blocks, so the blocks covering the range follow directly
+    const uint64_t blockSize = header_.compression_block_size;
+    const uint64_t begin = chunks.offsets[chunkIndex] + offset;
+    const uint64_t end = begin + length;
+    const size_t firstBlock = blockSize == 0 ? 0 : static_cast<size_t>(begin / blockSize);
+    const size_t lastBlock = blockSize == 0 ? 0 : static_cast<size_t>((end - 1) / blockSize);
+    if (blockSize == 0 || lastBlock >= blocks.offsets.size()) {
+        std::cerr << "Chunk " << chunkIndex << " points past the compression blocks" << std::endl;
+        return false;
+    }
+    
+    const uint64_t partitionSize = header_.partition_size == 0 ? UINT64_MAX : header_.partition_size;
+    std::unordered_map<uint64_t, std::ifstream> partitions;
+    std::vector<uint8_t> raw;
+    std::vector<uint8_t> decompressed;
+    out.resize(length);
+    
+    for (size_t block = firstBlock; block <= lastBlock;) {
+        // Extend the read over following blocks that sit close behind in the same partition
+        const uint64_t runStart = blocks.offsets[block];
+        const uint64_t partition = runStart / partitionSize;
+        uint64_t runStop = runStart + blocks.compressed_sizes[block];
+        size_t runEnd = block + 1;
+        while (runEnd <= lastBlock) {
+            uint64_t next = blocks.offsets[runEnd];
+            if (next < runStop || next - runStop > COALESCE_GAP || next / partitionSize != partition) {
+                break;
+            }
+            runStop = next + blocks.compressed_sizes[runEnd];
+            ++runEnd;
+        }
+        
+        auto [it, inserted] = partitions.try_emplace(partition);
+        std::ifstream& ucas = it->second;
+        if (inserted) {
+            ucas.open(GetPartitionPath(partition), std::ios::binary);
+        }
+        raw.resize(runStop - runStart);
+        auto ticket = file_formats::IoThrottle::global().acquire(raw.size());
+        ucas.seekg(static_cast<std::streamoff>(runStart % partitionSize));
+        ucas.read(reinterpret_cast<char*>(raw.data()), raw.size());
+        if (!ucas) {
+            std::cerr << "Failed to read " << GetPartitionPath(partition).string() << std::endl;
+            return false;
+        }
+        
+        for (; block < runEnd; ++block) {
+            const uint8_t* source = raw.data() + (blocks.offsets[block] - runStart);
+            const uint64_t blockBegin = block * blockSize;
+            const uint64_t copyBegin = std::max(begin, blockBegin);
+            const uint64_t copyEnd = std::min(end, blockBegin + blocks.uncompressed_sizes[block]);
+            if (copyEnd <= copyBegin) {
+                continue;
+            }
+            
+            uint8_t methodIndex = blocks.compression_methods[block];
+            if (methodIndex != 0) {
+                if (methodIndex > compression_methods_.size() || !decompressor_) {
+                    std::cerr << "No decompressor for block " << block << std::endl;
+                    return false;
+                }
+                decompressed.resize(blocks.uncompressed_sizes[block]);
+                if (!decompressor_(compression_methods_[methodIndex - 1], {source, blocks.compressed_sizes[block]}, decompressed)) {
+                    std::cerr << "Failed to decompress block " << block << std::endl;
+                    return false;
+                }
+                source = decompressed.data();
+            }
+            std::memcpy(out.data() + (copyBegin - begin), source + (copyBegin - blockBegin), copyEnd - copyBegin);
+        }
+    }
+    
+    return true;
+}
+
+bool UtocReader::ExtractChunks(std::span<const uint32_t> chunkIndices, const FChunkSink& sink) const {
+    struct FPlannedChunk {
+        uint32_t chunk;
+        size_t firstBlock;
+        size_t lastBlock;
+        uint64_t diskOffset; // container offset of the first block
+    };
+    
+    // Planning walks every selected chunk and block, so work on the unpacked columns
+    const FIoOffsetAndLengthColumns& chunks = GetChunkOffsetLengthColumns();
+    const FIoCompressedBlockColumns& columns = GetCompressionBlockColumns();
+    
+    std::vector<uint32_t> selected(chunkIndices.begin(), chunkIndices.end());
+    if (chunkIndices.empty()) {
+        selected.resize(chunks.offsets.size());
+        for (uint32_t i = 0; i < selected.size(); ++i) {
+            selected[i] = i;
+        }
+    }
+    
+    // Find the blocks of every chunk; empty chunks need no reads
+    const uint64_t blockSize = header_.compression_block_size;
+    std::vector<FPlannedChunk> planned;
+    planned.reserve(selected.size());
+    for (uint32_t chunkIndex : selected) {
+        if (chunkIndex >= chunks.offsets.size()) {
+            std::cerr << "Invalid chunk index: " << chunkIndex << std::endl;
+            return false;
+        }
+        const uint64_t chunkOffset = chunks.offsets[chunkIndex];
+        const uint64_t chunkLength = chunks.lengths[chunkIndex];
+        if (chunkLength == 0) {
+            if (!sink(chunkIndex, {})) {
+                return false;
+            }
+            continue;
+        }
+        
+        const size_t firstBlock = blockSize == 0 ? 0 : static_cast<size_t>(chunkOffset / blockSize);
+        const size_t lastBlock = blockSize == 0 ? 0 : static_cast<size_t>((chunkOffset + chunkLength - 1) / blockSize);
+        if (blockSize == 0 || lastBlock >= columns.offsets.size()) {
+            std::cerr << "Chunk " << chunkIndex << " points past the compression blocks" << std::endl;
+            return false;
+        }
+        planned.push_back({chunkIndex, firstBlock, lastBlock, columns.offsets[firstBlock]});
+    }
+    
+    // Container offsets grow with the partition, so this is partition order,
+    // then file order within each partition
+    std::stable_sort(planned.begin(), planned.end(), [](const FPlannedChunk& a, const FPlannedChunk& b) {
+        return a.diskOffset < b.diskOffset;
+    });
+    
+    const uint64_t partitionSize = header_.partition_size == 0 ? UINT64_MAX : header_.partition_size;
+    std::unordered_map<uint64_t, std::ifstream> partitions;
+    std::vector<size_t> blocks;                  // blocks of the batch, by disk offset
+    std::vector<const uint8_t*> blockData;       // where each of them ended up
+    std::vector<std::vector<uint8_t>> runs;      // coalesced raw reads
+    std::vector<std::vector<uint8_t>> decompressed;
+    std::vector<uint8_t> out;
+    
+    for (size_t next = 0; next < planned.size();) {
+        // Take chunks until the batch holds enough compressed bytes
+        const size_t batchBegin = next;
+        uint64_t batchBytes = 0;
+        blocks.clear();
+        while (next < planned.size() && (next == batchBegin || batchBytes < EXTRACT_BATCH_SIZE)) {
+            for (size_t block = planned[next].firstBlock; block <= planned[next].lastBlock; ++block) {
+                blocks.push_back(block);
+                batchBytes += columns.compressed_sizes[block];
+            }
+            ++next;
+        }
+        
+        // Chunks may share a block; read each once, in disk order
+        std::sort(blocks.begin(), blocks.end(), [&columns](size_t a, size_t b) {
+            uint64_t offsetA = columns.offsets[a];
+            uint64_t offsetB = columns.offsets[b];
+            return offsetA != offsetB ? offsetA < offsetB : a < b;
+        });
+        blocks.erase(std::unique(blocks.begin(), blocks.end()), blocks.end());
+        
+        // Read the blocks in runs that sit close together in one partition
+        runs.clear();
+        blockData.assign(blocks.size(), nullptr);
+        for (size_t first = 0; first < blocks.size();) {
+            const uint64_t runStart = columns.offsets[blocks[first]];
+            const uint64_t partition = runStart / partitionSize;
+            uint64_t runStop = runStart + columns.compressed_sizes[blocks[first]];
+            size_t last = first + 1;
+            while (last < blocks.size()) {
+                const uint64_t blockOffset = columns.offsets[blocks[last]];
+                if ((blockOffset > runStop && blockOffset - runStop > COALESCE_GAP) ||
+                    blockOffset / partitionSize != partition) {
+                    break;
+                }
+                runStop = std::max(runStop, blockOffset + columns.compressed_sizes[blocks[last]]);
+                ++last;
+            }
+            
+            auto [it, inserted] = partitions.try_emplace(partition);
+            std::ifstream& ucas = it->second;
+            if (inserted) {
+                ucas.open(GetPartitionPath(partition), std::ios::binary);
+            }
+            std::vector<uint8_t>& raw = runs.emplace_back(runStop - runStart);
+            auto ticket = file_formats::IoThrottle::global().acquire(raw.size());
+            ucas.seekg(static_cast<std::streamoff>(runStart % partitionSize));
+            ucas.read(reinterpret_cast<char*>(raw.data()), raw.size());
+            if (!ucas) {
+                std::cerr << "Failed to read " << GetPartitionPath(partition).string() << std::endl;
+                return false;
+            }
+            for (size_t i = first; i < last; ++i) {
+                blockData[i] = raw.data() + (columns.offsets[blocks[i]] - runStart);
+            }
+            first = last;
+        }
+        
+        // Decompress the batch on every core; stored blocks are used in place
+        decompressed.resize(blocks.size());
+        std::atomic<bool> failed{false};
+        file_formats::parallel_for(blocks.size(), [&](size_t i) {
+            const size_t block = blocks[i];
+            uint8_t methodIndex = columns.compression_methods[block];
+            if (methodIndex == 0 || failed.load(std::memory_order_relaxed)) {
+                return;
+            }
+            if (methodIndex > compression_methods_.size() || !decompressor_) {
+                failed.store(true);
+                return;
+            }
+            decompressed[i].resize(columns.uncompressed_sizes[block]);
+            if (!decompressor_(compression_methods_[methodIndex - 1], {blockData[i], columns.compressed_sizes[block]}, decompressed[i])) {
+                failed.store(true);
+                return;
+            }
+            blockData[i] = decompressed[i].data();
+        });
+        if (failed.load()) {
+            std::cerr << "Failed to decompress a block of " << path_.string() << std::endl;
+            return false;
+        }
+        
+        // Assemble the chunks in disk order and hand them over
+        std::vector<size_t> slotOfBlock(blocks.size());
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            slotOfBlock[i] = i;
+        }
+        std::sort(slotOfBlock.begin(), slotOfBlock.end(), [&](size_t a, size_t b) { return blocks[a] < blocks[b]; });
+        auto findSlot = [&](size_t block) {
+            return *std::lower_bound(slotOfBlock.begin(), slotOfBlock.end(), block,
+                                     [&](size_t slot, size_t value) { return blocks[slot] < value; });
+        };
+        
+        for (size_t i = batchBegin; i < next; ++i) {
+            const FPlannedChunk& plan = planned[i];
+            const uint64_t begin = chunks.offsets[plan.chunk];
+            const uint64_t end = begin + chunks.lengths[plan.chunk];
+            out.resize(end - begin);
+            for (size_t block = plan.firstBlock; block <= plan.lastBlock; ++block) {
+                const uint64_t blockBegin = block * blockSize;
+                const uint64_t copyBegin = std::max(begin, blockBegin);
+                const uint64_t copyEnd = std::min(end, blockBegin + columns.uncompressed_sizes[block]);
+                if (copyEnd > copyBegin) {
+                    std::memcpy(out.data() + (copyBegin - begin), blockData[findSlot(block)] + (copyBegin - blockBegin),
+                                copyEnd - copyBegin);
+                }
+            }
+            if (!sink(plan.chunk, out)) {
+                return false;
+            }
+        }
+        
+        // Keep the buffers' capacity for the next batch
+        for (auto& buffer : decompressed) {
+            buffer.clear();
+        }
+    }
+    
+    return true;
+}
+
+bool UtocReader::ExtractFiles(const std::filesystem::path& outputDirectory, std::span<const std::string_view> paths) const {
+    // Chunks to extract, and the file names each is written to
+    std::unordered_map<uint32_t, std::vector<std::string_view>> names;
+    std::vector<uint32_t> chunks;
+    const FPathIndex& index = GetPathIndex();
+    auto select = [&](std::string_view path, uint32_t chunkIndex) {
+        auto& chunkNames = names[chunkIndex];
+        if (chunkNames.empty()) {
+            chunks.push_back(chunkIndex);
+        }
+        chunkNames.push_back(path);
+    };
+    
+    if (paths.empty()) {
+        for (size_t i = 0; i < index.paths.size(); ++i) {
+            select(index.paths[i], index.chunk_indices[i]);
+        }
+    } else {
+        for (std::string_view path : paths) {
+            auto file = FindFile(path);
+            if (!file) {
+                std::cerr << "File not found: " << path << std::endl;
+                return false;
+            }
+            select(index.paths[*file], index.chunk_indices[*file]);
+        }
+    }
+    if (chunks.empty()) {
+        return true;
+    }
+    
+    return ExtractChunks(chunks, [&](uint32_t chunkIndex, std::span<const uint8_t> data) {
+        for (std::string_view name : names[chunkIndex]) {
+            // Drop the "../../../" of the usual mount point, and never write
+            // outside the output directory, whatever the index says
+            std::filesystem::path relative;
+            bool leading = true;
+            for (const auto& part : std::filesystem::path(name).lexically_normal().relative_path()) {
+                if (leading && part == "..") {
+                    continue;
+                }
+                leading = false;
+                relative /= part;
+            }
+            relative = relative.lexically_normal();
+            if (relative.empty() || *relative.begin() == "..") {
+                std::cerr << "Refusing to extract " << name << std::endl;
+                return false;
+            }
+            
+            std::filesystem::path target = outputDirectory / relative;
+            std::error_code error;
+            std::filesystem::create_directories(target.parent_path(), error);
+            std::ofstream file(target, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            if (!file) {
+                std::cerr << "Failed to write " << target.string() << std::endl;
+                return false;
+            }
+        }
+        return true;
+    });
+}
+
+const file_formats::MappedFile* UtocReader::MapPartition(uint64_t partition) const {
+    if (!ucas_mappings_) {
+        return nullptr;
+    }
+    
+    std::lock_guard lock(ucas_mappings_->mutex);
+    auto& mapping = ucas_mappings_->partitions[partition];
+    if (!mapping) {
+        auto file = std::make_unique<file_formats::MappedFile>();
+        if (!file->open(GetPartitionPath(partition))) {
+            std::cerr << "Failed to map " << GetPartitionPath(partition).string() << std::endl;
+            return nullptr;
+        }
+        mapping = std::move(file);
+    }
+    return mapping.get();
+}
+
+std::optional<std::span<const uint8_t>> UtocReader::GetChunkView(uint32_t chunkIndex) const {
+    const FIoOffsetAndLengthColumns& chunks = GetChunkOffsetLengthColumns();
+    const FIoCompressedBlockColumns& blocks = GetCompressionBlockColumns();
+    if (chunkIndex >= chunks.offsets.size() || header_.IsEncrypted()) {
+        return std::nullopt;
+    }
+    
+    const uint64_t length = chunks.lengths[chunkIndex];
+    if (length == 0) {
+        return std::span<const uint8_t>();
+    }
+    
+    const uint64_t blockSize = header_.compression_block_size;
+    const uint64_t begin = chunks.offsets[chunkIndex];
+    const size_t firstBlock = blockSize == 0 ? 0 : static_cast<size_t>(begin / blockSize);
+    const size_t lastBlock = blockSize == 0 ? 0 : static_cast<size_t>((begin + length - 1) / blockSize);
+    if (blockSize == 0 || lastBlock >= blocks.offsets.size()) {
+        return std::nullopt;
+    }
+    
+    // Every block must be raw and directly follow the previous one
+    const uint64_t partitionSize = header_.partition_size == 0 ? UINT64_MAX : header_.partition_size;
+    const uint64_t start = blocks.offsets[firstBlock];
+    uint64_t expected = start;
+    for (size_t block = firstBlock; block <= lastBlock; ++block) {
+        if (blocks.compression_methods[block] != 0 || blocks.compressed_sizes[block] != blocks.uncompressed_sizes[block] ||
+            blocks.offsets[block] != expected) {
+            return std::nullopt;
+        }
+        expected += blocks.compressed_sizes[block];
+    }
+    
+    const uint64_t partition = start / partitionSize;
+    const uint64_t viewBegin = start % partitionSize + (begin - firstBlock * blockSize);
+    if ((expected - 1) / partitionSize != partition) {
+        return std::nullopt;
+    }
+    
+    const file_formats::MappedFile* ucas = MapPartition(partition);
+    if (!ucas || viewBegin > ucas->size() || length > ucas->size() - viewBegin) {
+        return std::nullopt;
+    }
+    return ucas->bytes().subspan(viewBegin, length);
+}
+
 } // namespace utoc
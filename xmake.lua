@@ -2,5 +2,8 @@ add_rules("mode.debug", "mode.release")
 
 set_languages("c++23")
 
+includes("unreal_modding_file_formats/xmake.lua")
 includes("pak_*/xmake.lua")
--- includes("test/pak_*/xmake.lua")
+includes("utoc_*/xmake.lua")
+includes("unreal_modding_mo2_core/xmake.lua")
+includes("test/*/xmake.lua")